@@ -1,19 +1,50 @@
 HEADERS = src/network.h \
+          src/log_sink.h \
+          src/perf_log_client.h \
+          src/heartbeat_service.h \
           src/timers.h \
           src/qtdynamic.h \
           src/qtlua.h \
           src/qdatetime.h \
+          src/ford_protocol.h \
+          src/atf_log.h \
+          src/web_socket_receiver.h \
+          src/lua_json.h \
+          src/spsc_queue.h \
+          src/io_thread_socket.h \
+          src/socket_stats.h \
+          src/virtual_clock.h \
           src/marshal.h \
-          src/lua_interpreter.h
+          src/lua_interpreter.h \
+          src/interp_server.h \
+          src/epoll_event_dispatcher.h \
+          src/lua_profiler.h \
+          src/lua_allocator.h \
+          src/lua_bytecode_cache.h
           
 SOURCES = src/network.cc \
+          src/log_sink.cc \
+          src/perf_log_client.cc \
+          src/heartbeat_service.cc \
           src/timers.cc \
           src/qtdynamic.cc \
           src/qtlua.cc \
           src/qdatetime.cc \
+          src/ford_protocol.cc \
+          src/atf_log.cc \
+          src/web_socket_receiver.cc \
+          src/lua_json.cc \
+          src/io_thread_socket.cc \
+          src/socket_stats.cc \
+          src/virtual_clock.cc \
           src/marshal.cc \
           src/main.cc \
-          src/lua_interpreter.cc
+          src/epoll_event_dispatcher.cc \
+          src/lua_interpreter.cc \
+          src/interp_server.cc \
+          src/lua_profiler.cc \
+          src/lua_allocator.cc \
+          src/lua_bytecode_cache.cc
           
 TARGET  = bin/interp
 QT = core network websockets
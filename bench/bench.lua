@@ -0,0 +1,104 @@
+--- Module which provides a minimal harness for ATF micro- and macro-benchmarks
+--
+-- Synchronous benchmarks are repeated with a doubling iteration count until
+-- they run for at least `Bench.min_time` milliseconds. Asynchronous benchmarks
+-- get a fixed iteration count and report back through a `done` callback once
+-- the event loop has delivered all of their work.
+--
+-- Every result is printed to stdout and, if `BENCH_RESULTS` environment variable
+-- is set, appended to that file as a tab separated line:
+-- `<benchmark> <iterations> <ns_per_op>`
+--
+-- *Dependencies:* none
+--
+-- *Globals:* `timestamp`, `quit`
+-- @module bench
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local Bench = {
+  queue = { }
+}
+
+--- Minimal measurement time of synchronous benchmark in milliseconds
+Bench.min_time = tonumber(os.getenv("BENCH_MIN_TIME")) or 200
+--- Multiplier for iteration count of asynchronous benchmarks
+Bench.scale = tonumber(os.getenv("BENCH_SCALE")) or 1
+
+--- Store result of benchmark
+-- @tparam string name Benchmark name
+-- @tparam number iterations Number of performed iterations
+-- @tparam number elapsed Elapsed time in milliseconds
+local function report(name, iterations, elapsed)
+  local ns_per_op = elapsed * 1000000 / iterations
+  print(string.format("%-40s %10d iterations %14.1f ns/op", name, iterations, ns_per_op))
+  local results = os.getenv("BENCH_RESULTS")
+  if results and results ~= "" then
+    local f = io.open(results, "a")
+    f:write(string.format("%s\t%d\t%.1f\n", name, iterations, ns_per_op))
+    f:close()
+  end
+end
+
+--- Register synchronous benchmark
+-- @tparam string name Benchmark name
+-- @tparam function func Function which performs one iteration
+function Bench.add(name, func)
+  table.insert(Bench.queue, { name = name, func = func })
+end
+
+--- Register asynchronous benchmark
+-- @tparam string name Benchmark name
+-- @tparam number iterations Number of iterations (scaled by `BENCH_SCALE`)
+-- @tparam function func Function with signature func(iterations, done) which starts
+-- all iterations and calls done() when the last one is finished
+function Bench.add_async(name, iterations, func)
+  table.insert(Bench.queue, {
+      name = name,
+      iterations = math.max(1, math.floor(iterations * Bench.scale)),
+      async = func
+    })
+end
+
+--- Measure synchronous benchmark
+local function measure(name, func)
+  local n = 1
+  while true do
+    local start = timestamp()
+    for _ = 1, n do func() end
+    local elapsed = timestamp() - start
+    if elapsed >= Bench.min_time then
+      report(name, n, elapsed)
+      return
+    end
+    -- aim a bit above min_time, but never grow slower than doubling
+    local estimate = math.ceil(n * Bench.min_time * 1.2 / math.max(elapsed, 1))
+    n = math.max(n * 2, estimate)
+  end
+end
+
+--- Run all registered benchmarks in order of registration and quit
+function Bench.run()
+  local index = 0
+  local function next_bench()
+    index = index + 1
+    local b = Bench.queue[index]
+    if not b then
+      quit()
+      return
+    end
+    if b.async then
+      local start = timestamp()
+      b.async(b.iterations, function()
+          report(b.name, b.iterations, timestamp() - start)
+          next_bench()
+        end)
+    else
+      measure(b.name, b.func)
+      next_bench()
+    end
+  end
+  next_bench()
+end
+
+return Bench
@@ -0,0 +1,60 @@
+--- Compare benchmark results against stored baseline
+--
+-- Usage: interp bench/compare.lua <results.tsv> <baseline.tsv> [tolerance]
+--
+-- tolerance is allowed slowdown ratio, e.g. 0.2 means 20% (default value)
+-- Quits with code 1 if some benchmark is slower than baseline more than tolerance
+
+local function load(filename)
+  local res = { }
+  local f = io.open(filename, "r")
+  if not f then return nil end
+  for line in f:lines() do
+    local name, iterations, ns_per_op = line:match("^([^#\t][^\t]*)\t(%d+)\t([%d%.]+)$")
+    if name then
+      res[name] = tonumber(ns_per_op)
+      table.insert(res, name)
+    end
+  end
+  f:close()
+  return res
+end
+
+local results_file, baseline_file, tolerance = argv[2], argv[3], tonumber(argv[4]) or 0.2
+local results = load(results_file)
+if not results then
+  print("Cannot open results file " .. tostring(results_file))
+  quit(1)
+  return
+end
+local baseline = load(baseline_file)
+if not baseline then
+  print("No baseline " .. tostring(baseline_file) .. ", run `make bench-baseline` to store one")
+  quit()
+  return
+end
+
+local regressions = 0
+print(string.format("%-44s %14s %14s %8s", "benchmark", "baseline ns", "current ns", "ratio"))
+for _, name in ipairs(results) do
+  local current, base = results[name], baseline[name]
+  if base then
+    local ratio = current / base
+    local mark = ""
+    if ratio > 1 + tolerance then
+      mark = " REGRESSION"
+      regressions = regressions + 1
+    elseif ratio < 1 - tolerance then
+      mark = " improved"
+    end
+    print(string.format("%-44s %14.1f %14.1f %8.2f%s", name, base, current, ratio, mark))
+  else
+    print(string.format("%-44s %14s %14.1f %8s", name, "-", current, "new"))
+  end
+end
+if regressions > 0 then
+  print(string.format("%d benchmark(s) regressed more than %d%%", regressions, tolerance * 100))
+  quit(1)
+  return
+end
+quit()
@@ -0,0 +1,76 @@
+--- Benchmarks of ProtocolHandler:Parse/Compose and json encode/decode
+package.path = "./bench/?.lua;" .. package.path
+local bench = require("bench")
+local json = require("json")
+local ph = require("protocol_handler/protocol_handler")
+local constants = require("protocol_handler/ford_protocol_constants")
+
+local register_app =
+{
+  syncMsgVersion = { majorVersion = 4, minorVersion = 2 },
+  appName = "Test Application",
+  ttsName = { { text = "SyncProxyTester", type = "TEXT" } },
+  ngnMediaScreenAppName = "SPT",
+  vrSynonyms = { "VRSyncProxyTester" },
+  isMediaApplication = true,
+  languageDesired = "EN-US",
+  hmiDisplayLanguageDesired = "EN-US",
+  appHMIType = { "NAVIGATION" },
+  appID = "8675308",
+  deviceInfo =
+  {
+    os = "Android",
+    carrier = "Megafon",
+    firmwareRev = "Name: Linux, Version: 3.4.0-perf",
+    osVersion = "4.4.2",
+    maxNumberRFCOMMPorts = 1
+  }
+}
+local register_app_json = json.encode(register_app)
+
+local function rpc_message(payload, binaryData)
+  return {
+    version = 3,
+    encryption = false,
+    frameType = constants.FRAME_TYPE.SINGLE_FRAME,
+    serviceType = constants.SERVICE_TYPE.RPC,
+    frameInfo = 0,
+    sessionId = 1,
+    messageId = 1,
+    rpcType = 0,
+    rpcFunctionId = 1,
+    rpcCorrelationId = 1,
+    payload = payload,
+    binaryData = binaryData
+  }
+end
+
+local single_message = rpc_message(register_app_json)
+local multi_message = rpc_message(register_app_json, string.rep("b", 64 * 1024))
+
+local composer = ph.ProtocolHandler()
+local single_frames = table.concat(composer:Compose(single_message))
+local multi_frames = table.concat(composer:Compose(multi_message))
+local stream_100 = string.rep(single_frames, 100)
+
+bench.add("json.encode", function() json.encode(register_app) end)
+bench.add("json.decode", function() json.decode(register_app_json) end)
+bench.add("protocol.compose.single", function() composer:Compose(single_message) end)
+bench.add("protocol.compose.multi_64k", function() composer:Compose(multi_message) end)
+bench.add("protocol.parse.single", function() ph.ProtocolHandler():Parse(single_frames) end)
+bench.add("protocol.parse.multi_64k", function() ph.ProtocolHandler():Parse(multi_frames) end)
+bench.add("protocol.parse.stream_100", function() ph.ProtocolHandler():Parse(stream_100) end)
+
+-- Native message objects, payload is not accessed
+config = config or { }
+local function lazy(func)
+  return function()
+    config.lazyMessages = true
+    func()
+    config.lazyMessages = false
+  end
+end
+bench.add("protocol.parse_lazy.single", lazy(function() ph.ProtocolHandler():Parse(single_frames) end))
+bench.add("protocol.parse_lazy.stream_100", lazy(function() ph.ProtocolHandler():Parse(stream_100) end))
+
+bench.run()
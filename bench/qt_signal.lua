@@ -0,0 +1,32 @@
+--- Benchmarks of qt.dynamic signal emission: Marshaller marshal/unmarshal and
+-- qtlua_emit_signal -> DynamicSlot::call round trip through the event loop
+package.path = "./bench/?.lua;" .. package.path
+local bench = require("bench")
+
+local payload_4k = string.rep("x", 4096)
+
+--- Register round trip benchmark for one argument type
+local function emit_bench(name, signature, value)
+  bench.add_async("qt.emit_slot." .. name, 20000, function(iterations, done)
+      local sender = qt.dynamic()
+      local receiver = qt.dynamic()
+      local received = 0
+      function sender:signal() end
+      function receiver:slot()
+        received = received + 1
+        if received == iterations then done() end
+      end
+      qt.connect(sender, "signal(" .. signature .. ")", receiver, "slot(" .. signature .. ")")
+      for _ = 1, iterations do
+        sender:signal(value)
+      end
+    end)
+end
+
+emit_bench("void", "", nil)
+emit_bench("int", "int", 42)
+emit_bench("bool", "bool", true)
+emit_bench("QString", "QString", "RegisterAppInterface")
+emit_bench("QByteArray_4k", "QByteArray", payload_4k)
+
+bench.run()
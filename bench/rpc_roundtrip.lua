@@ -0,0 +1,85 @@
+--- Macro-benchmark of end-to-end RPC round trip through
+-- TcpConnection -> MobileConnection against a local echo server
+package.path = "./bench/?.lua;" .. package.path
+local bench = require("bench")
+local json = require("json")
+local tcp = require("tcp_connection")
+local mobile = require("mobile_connection")
+local constants = require("protocol_handler/ford_protocol_constants")
+
+-- connection modules report into these globals, benchmarks do not need them
+xmlReporter = { AddMessage = function() end }
+atf_logger = { LOG = function() end }
+config = config or { }
+
+local port = tonumber(os.getenv("BENCH_PORT")) or 5209
+
+local server = network.TcpServer()
+local echo = qt.dynamic()
+if not server:listen("127.0.0.1", port) then
+  print("Listen failed on port " .. port)
+  quit(1)
+end
+qt.connect(server, "newConnection()", echo, "newConnection()")
+function echo.newConnection()
+  echo.socket = server:get_connection()
+  qt.connect(echo.socket, "readyRead()", echo, "dataReady()")
+end
+function echo.dataReady()
+  echo.socket:write(echo.socket:read_all())
+end
+
+local payload = json.encode({
+    cmdID = 1,
+    menuParams = { position = 0, menuName = "Command" },
+    vrCommands = { "VRCommandonepositive", "VRCommandonepositivedouble" }
+  })
+
+local function rpc(correlation_id, binaryData)
+  return {
+    version = 3,
+    encryption = false,
+    frameType = constants.FRAME_TYPE.SINGLE_FRAME,
+    serviceType = constants.SERVICE_TYPE.RPC,
+    frameInfo = 0,
+    sessionId = 1,
+    messageId = correlation_id,
+    rpcType = 0,
+    rpcFunctionId = 5,
+    rpcCorrelationId = correlation_id,
+    payload = payload,
+    binaryData = binaryData
+  }
+end
+
+--- Register round trip benchmark: every request is sent only after
+-- the echo of the previous one is parsed
+local function roundtrip_bench(name, iterations, binaryData, threaded)
+  bench.add_async(name, iterations, function(n, done)
+      config.networkThread = threaded
+      local connection = mobile.MobileConnection(tcp.Connection("127.0.0.1", port))
+      local sent = 0
+      connection:OnInputData(function(_, msg)
+          if msg.rpcCorrelationId ~= sent then return end
+          if sent == n then
+            connection:Close()
+            done()
+            return
+          end
+          sent = sent + 1
+          connection:Send({ rpc(sent, binaryData) })
+        end)
+      connection:OnConnected(function()
+          sent = 1
+          connection:Send({ rpc(sent, binaryData) })
+        end)
+      connection:Connect()
+    end)
+end
+
+roundtrip_bench("rpc.roundtrip.tcp", 2000)
+roundtrip_bench("rpc.roundtrip.tcp_binary_16k", 500, string.rep("b", 16 * 1024))
+roundtrip_bench("rpc.roundtrip.tcp_thread", 2000, nil, true)
+roundtrip_bench("rpc.roundtrip.tcp_thread_binary_16k", 500, string.rep("b", 16 * 1024), true)
+
+bench.run()
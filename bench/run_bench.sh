@@ -0,0 +1,35 @@
+#! /bin/bash
+
+# Usage: bench/run_bench.sh
+# Results are stored to bench/out/results.tsv and compared with bench/baseline.tsv
+# Environment:
+#   BENCH_TOLERANCE  allowed slowdown ratio against baseline (default 0.2)
+#   BENCH_MIN_TIME   minimal run time of every micro-benchmark in ms (default 200)
+#   BENCH_SCALE      multiplier for iteration count of async benchmarks (default 1)
+
+export BENCH_RESULTS=bench/out/results.tsv
+mkdir -p bench/out
+echo -e "# benchmark\titerations\tns_per_op" > $BENCH_RESULTS
+
+run_bench()
+{
+  # Usage: run_bench <bench name> <timeout>
+  bench_name=$1
+  timeout_delay=$2s
+  echo "Running $bench_name benchmarks..."
+  timeout $timeout_delay ./bin/interp bench/$bench_name.lua 2> bench/out/$bench_name.err
+  RES=$?
+  if [ $RES -ne 0 ]; then
+    echo "FAIL. See bench/out/$bench_name.err for details"
+    FAILED=1
+  fi
+}
+
+FAILED=0
+run_bench qt_signal 60
+run_bench protocol 60
+run_bench schema 120
+run_bench rpc_roundtrip 60
+
+./bin/interp bench/compare.lua $BENCH_RESULTS bench/baseline.tsv ${BENCH_TOLERANCE:-0.2} || FAILED=1
+exit $FAILED
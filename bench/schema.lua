@@ -0,0 +1,49 @@
+--- Benchmarks of SchemaValidation:Compare and lua_xml XPath queries
+package.path = "./bench/?.lua;" .. package.path
+local bench = require("bench")
+local xml = require("xml")
+local load_schema = require("load_schema")
+
+local mob_schema = load_schema.mob_schema
+local hmi_schema = load_schema.hmi_schema
+
+local register_app =
+{
+  syncMsgVersion = { majorVersion = 4, minorVersion = 2 },
+  appName = "Test Application",
+  ttsName = { { text = "SyncProxyTester", type = "TEXT" } },
+  ngnMediaScreenAppName = "SPT",
+  vrSynonyms = { "VRSyncProxyTester" },
+  isMediaApplication = true,
+  languageDesired = "EN-US",
+  hmiDisplayLanguageDesired = "EN-US",
+  appHMIType = { "NAVIGATION" },
+  appID = "8675308"
+}
+
+local slider = { numTicks = 7, position = 6, sliderHeader = "sliderHeader",
+  sliderFooter = { "sliderFooter1", "sliderFooter2", "sliderFooter3" },
+  timeout = 3000, appID = 1 }
+
+bench.add("schema.compare.mobile.RegisterAppInterface", function()
+    mob_schema:Compare("RegisterAppInterface", "request", register_app)
+  end)
+bench.add("schema.compare.mobile.Slider_response", function()
+    mob_schema:Compare("Slider", "response", { success = true, resultCode = "SUCCESS" })
+  end)
+bench.add("schema.compare.hmi.UI.Slider", function()
+    hmi_schema:Compare("UI.Slider", "request", slider)
+  end)
+
+local doc = xml.open("data/HMI_API.xml")
+bench.add("xml.xpath.count_struct", function()
+    doc:xpath("count(//struct)")
+  end)
+bench.add("xml.xpath.function_by_param", function()
+    doc:xpath("//param[@name='appID']/parent::function[count(param) > 2]")
+  end)
+bench.add("xml.xpath.interface_function", function()
+    doc:xpath("//interface[@name='UI']/function[@name='Slider'][@messagetype='request']")
+  end)
+
+bench.run()
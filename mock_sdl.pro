@@ -0,0 +1,15 @@
+HEADERS = src/mock_sdl/api_schema.h \
+          src/mock_sdl/mobile_server.h \
+          src/mock_sdl/hmi_server.h
+
+SOURCES = src/mock_sdl/api_schema.cc \
+          src/mock_sdl/mobile_server.cc \
+          src/mock_sdl/hmi_server.cc \
+          src/mock_sdl/main.cc
+
+TARGET  = bin/mock_sdl
+QT = core network websockets
+CONFIG += c++11 qt debug
+OBJECTS_DIR = bin/.obj/mock_sdl
+MOC_DIR = bin/.obj/mock_sdl
+QMAKE_LFLAGS += -static-libgcc -static-libstdc++
@@ -18,6 +18,9 @@ require('atf.util')
 SDL.buildOptions = {}
 --- The flag responsible for stopping ATF in case of emergency completion of SDL
 SDL.exitOnCrash = true
+--- The flag which is set if SDL and its HMI and log connections are kept from previous script
+-- run in the same ATF process (see `config.reuseSDL`)
+SDL.reused = false
 --- SDL state constant: SDL completed correctly
 SDL.STOPPED = 0
 --- SDL state constant: SDL works
@@ -129,11 +132,29 @@ function SDL:StartSDL(pathToSDL, smartDeviceLinkCore, ExitOnCrash)
   return result, msg
 end
 
+--- Keep SDL running for the next script run in this ATF process
+--
+-- SDL is kept only if it was started by ATF and still runs. Its log connection is kept as well,
+-- SDL log of the next script goes to its own file
+-- @tparam string script_name Path to the next script
+-- @treturn boolean True if SDL is kept
+function SDL:Reuse(script_name)
+  self.reused = self.autoStarted == true and self:CheckStatusSDL() == self.RUNNING
+  if self.reused then
+    if config.storeFullSDLLogs == true then
+      sdl_logger.reopen_log(script_name)
+    end
+    xmlReporter.AddMessage("StopSDL", {["message"] = "SDL kept running for " .. script_name})
+  end
+  return self.reused
+end
+
 --- Stop SDL from ATF (SIGINT is used)
 -- @treturn nil The main result. Always nil.
 -- @treturn string Additional information on the main result of stopping SDL
 function SDL:StopSDL()
   self.autoStarted = false
+  self.reused = false
   local status = self:CheckStatusSDL()
   if status == self.RUNNING then
     local result = os.execute ('./tools/StopSDL.sh')
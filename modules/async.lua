@@ -0,0 +1,363 @@
+---- Coroutine based test steps.
+--
+-- Test step started by `async.step` runs as a coroutine which waits for futures by `async.await`
+-- instead of chaining callbacks, so independent waits (several app registrations, HMI subscriptions,
+-- file uploads) overlap by `async.all`, `async.race` and tasks started by `async.spawn`.
+-- Futures are made from expectations (`async.expect`, `async.rpc`), timers (`async.sleep`)
+-- or created explicitly (`async.Future`).
+--
+-- Coroutines are resumed from Qt event loop in order futures were settled, never from inside
+-- of event handlers, so runs are reproducible. The step has an expectation which stays pending until
+-- the main task of the step finishes, so the step is reported once, with all its expectations.
+-- Error in any task of the step or timeout of the step fails the step and cancels its tasks.
+--
+-- Expectation whose future is cancelled (a loser of `async.race`) or whose error is raised in a task
+-- by `async.await` is removed from expectations of the step and from event dispatcher, so it doesn't
+-- fail the step later: its failure is up to the task which may catch the error.
+--
+-- *Dependencies:* `expectations`
+--
+-- *Globals:* `qt`, `timers`, `event_dispatcher`
+-- @module async
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local expectations = require('expectations')
+
+local Async = {}
+
+--- Default timeout of step in ms
+Async.timeout = 10000
+
+--- Tasks by coroutines
+local tasks = setmetatable({}, { __mode = "k" })
+--- Queue of tasks to be resumed with results of futures
+local ready = {}
+--- Timer resuming ready tasks on the next event loop iteration
+local resumer = nil
+--- Running single shot timers by their proxies
+local active = {}
+
+--- Future
+-- @type Future
+
+local future_mt = { __index = {} }
+
+--- Construct pending future
+-- @treturn Future Constructed instance
+function Async.Future()
+  return setmetatable({ done = false, ok = nil, result = nil, callbacks = {}, cleanup = {} }, future_mt)
+end
+
+--- Settle future and run its callbacks
+-- @tparam Future f Future
+-- @tparam boolean ok True if future is resolved, false if rejected
+-- @tparam table result Packed values or error
+local function settle(f, ok, result)
+  if f.done then return end
+  f.done, f.ok, f.result = true, ok, result
+  local callbacks = f.callbacks
+  f.callbacks = {}
+  for _, callback in ipairs(callbacks) do callback(ok, result) end
+end
+
+--- Resolve future, it is ignored if future is already settled
+-- @param ... Values of future
+function future_mt.__index:resolve(...)
+  settle(self, true, table.pack(...))
+end
+
+--- Reject future, it is ignored if future is already settled
+-- @param err Error
+function future_mt.__index:reject(err)
+  settle(self, false, err)
+end
+
+--- Run cleanup functions of future, each of them is run once
+-- @tparam Future f Future
+local function release(f)
+  local cleanup = f.cleanup
+  f.cleanup = {}
+  for _, func in ipairs(cleanup) do func() end
+end
+
+--- Add function which releases resources of future (e.g. expectation) when it is cancelled
+-- or its error is raised in a task
+-- @tparam function func Function without arguments
+function future_mt.__index:onCancel(func)
+  table.insert(self.cleanup, func)
+end
+
+--- Cancel future: release its resources and reject it if it is still pending
+--
+-- Future of task is rejected, but the task itself keeps running until its step finishes
+function future_mt.__index:cancel()
+  release(self)
+  settle(self, false, "Cancelled")
+end
+
+--- Cancel future unless it is resolved, resolved expectation stays in the step
+-- @tparam Future f Future
+local function cancelUnresolved(f)
+  if not (f.done and f.ok) then f:cancel() end
+end
+
+--- Call function when future is settled, at once if it is already settled
+-- @tparam function callback Function with signature callback(ok, result), result is packed values
+-- or error
+function future_mt.__index:subscribe(callback)
+  if self.done then
+    callback(self.ok, self.result)
+  else
+    table.insert(self.callbacks, callback)
+  end
+end
+
+--- Module functions
+-- @section Async
+
+--- Start single shot timer
+-- @tparam number ms Timeout
+-- @tparam function func Function called on timeout
+-- @treturn Timer Timer
+local function singleShot(ms, func)
+  local proxy = qt.dynamic()
+  local timer = timers.Timer()
+  active[proxy] = timer
+  function proxy.timeout()
+    active[proxy] = nil
+    func()
+  end
+  qt.connect(timer, "timeout()", proxy, "timeout()")
+  timer:setSingleShot(true)
+  timer:start(ms)
+  return timer
+end
+
+--- Resume ready tasks in order they got ready
+local function resumeReady()
+  resumer = nil
+  while #ready > 0 do
+    local entry = table.remove(ready, 1)
+    local task = entry.task
+    if not task.step.finished then
+      local ok, res = coroutine.resume(task.co, entry.ok, entry.result)
+      -- future of task is settled out of coroutine, so finished step may start the next one
+      if not ok then
+        task.future:reject(res)
+        task.step:fail(res)
+      elseif coroutine.status(task.co) == "dead" then
+        task.future:resolve(table.unpack(res, 1, res.n))
+      end
+    end
+  end
+end
+
+--- Put task into queue of ready tasks
+-- @tparam table task Task
+-- @tparam boolean ok Result of awaited future
+-- @param result Packed values or error
+local function makeReady(task, ok, result)
+  table.insert(ready, { task = task, ok = ok, result = result })
+  if not resumer then resumer = singleShot(0, resumeReady) end
+end
+
+--- Create task of step, it starts on the next event loop iteration
+-- @tparam table step Step
+-- @tparam function func Task body
+-- @param ... Arguments of body
+-- @treturn table Task
+local function createTask(step, func, ...)
+  local args = table.pack(...)
+  local task = { step = step, future = Async.Future() }
+  task.co = coroutine.create(function()
+      return table.pack(func(table.unpack(args, 1, args.n)))
+    end)
+  tasks[task.co] = task
+  makeReady(task, true, nil)
+  return task
+end
+
+--- Get task of running coroutine
+-- @tparam string name Name of function for error message
+-- @treturn table Task
+local function currentTask(name)
+  local co = coroutine.running()
+  local task = co and tasks[co]
+  if not task then error("async." .. name .. " must be called from task of async step", 3) end
+  return task
+end
+
+--- Wait for future
+--
+-- Expectation is awaited by `async.expect`. If future is rejected, its expectations are released
+-- before the error is raised, so the task decides whether the step fails
+-- @tparam Future|Expectation f Future
+-- @return Values the future is resolved with, error is raised if it is rejected
+function Async.await(f)
+  if getmetatable(f) ~= future_mt then f = Async.expect(f) end
+  local task = currentTask("await")
+  f:subscribe(function(ok, result) makeReady(task, ok, result) end)
+  local ok, result = coroutine.yield()
+  if not ok then
+    release(f)
+    error(result, 0)
+  end
+  return table.unpack(result, 1, result.n)
+end
+
+--- Make future of expectation
+--
+-- Future is resolved with data of the last occurence when expectation gets successful status
+-- and rejected when it fails (e.g. by timeout). Cancelled future removes expectation from the step
+-- and from event dispatcher
+-- @tparam Expectation exp Expectation
+-- @treturn Future Future
+function Async.expect(exp)
+  if exp.future then return exp.future end
+  local f = Async.Future()
+  exp.future = f
+  local co = coroutine.running()
+  local task = co and tasks[co]
+  f:onCancel(function()
+      if task and task.step.test.RemoveExpectation then task.step.test:RemoveExpectation(exp) end
+      if exp.connection and exp.event and not exp.pinned then
+        event_dispatcher:RemoveEvent(exp.connection, exp.event)
+      end
+    end)
+  local last = nil
+  exp:Do(function(_, data) last = data end)
+  local function check(e)
+    if e.status == expectations.SUCCESS then
+      f:resolve(last)
+    elseif e.status == expectations.FAILED then
+      local messages = {}
+      for k, v in pairs(e.errorMessage) do table.insert(messages, k .. ": " .. tostring(v)) end
+      table.sort(messages)
+      f:reject(tostring(e) .. ": " .. table.concat(messages, "; "))
+    end
+  end
+  local validate = exp.validate
+  exp.validate = function(self)
+    validate(self)
+    check(self)
+  end
+  check(exp)
+  return f
+end
+
+--- Make future resolved after timeout
+-- @tparam number ms Timeout
+-- @treturn Future Future
+function Async.sleep(ms)
+  local f = Async.Future()
+  singleShot(ms, function() f:resolve() end)
+  return f
+end
+
+--- Send RPC of mobile session and make future of its response
+-- @tparam MobileSession session Mobile session
+-- @tparam string func Mobile function name
+-- @tparam table params RPC parameters
+-- @param ... Expected response, see `ExpectResponse` of mobile session
+-- @treturn Future Future resolved with response data
+function Async.rpc(session, func, params, ...)
+  local cid = session:SendRPC(func, params)
+  return Async.expect(session:ExpectResponse(cid, ...))
+end
+
+--- Make future resolved when all futures are resolved
+-- @tparam Future|Expectation ... Futures
+-- @treturn Future Future resolved with array of the first values of futures, rejected with the
+-- first error. Futures which are not resolved are cancelled with it
+function Async.all(...)
+  local list = table.pack(...)
+  local f = Async.Future()
+  local values = {}
+  local left = list.n
+  if left == 0 then f:resolve(values) end
+  for i = 1, list.n do
+    local item = list[i]
+    if getmetatable(item) ~= future_mt then item = Async.expect(item) end
+    f:onCancel(function() cancelUnresolved(item) end)
+    item:subscribe(function(ok, result)
+        if not ok then return f:reject(result) end
+        values[i] = result[1]
+        left = left - 1
+        if left == 0 then f:resolve(values) end
+      end)
+  end
+  return f
+end
+
+--- Make future settled as the first of futures
+--
+-- When race is settled, the other futures which are not resolved are cancelled, so expectations
+-- which lost the race don't stay in the step
+-- @tparam Future|Expectation ... Futures
+-- @treturn Future Future resolved with the first value and index of the first resolved future,
+-- or rejected with its error
+function Async.race(...)
+  local list = table.pack(...)
+  local f = Async.Future()
+  local items = {}
+  for i = 1, list.n do
+    local item = list[i]
+    if getmetatable(item) ~= future_mt then item = Async.expect(item) end
+    items[i] = item
+    f:onCancel(function() cancelUnresolved(item) end)
+  end
+  for i = 1, list.n do
+    items[i]:subscribe(function(ok, result)
+        if f.done then return end
+        if ok then f:resolve(result[1], i) else f:reject(result) end
+        for j = 1, list.n do
+          if j ~= i then cancelUnresolved(items[j]) end
+        end
+      end)
+  end
+  return f
+end
+
+--- Start task in the same step, it runs concurrently with the calling task
+-- @tparam function func Task body
+-- @param ... Arguments of body
+-- @treturn Future Future resolved with values returned by body
+function Async.spawn(func, ...)
+  return createTask(currentTask("spawn").step, func, ...).future
+end
+
+--- Run test step as a coroutine
+--
+-- Step is finished when `func` returns, tasks spawned by it and not awaited are cancelled
+-- @tparam table test Test (`self` of test step)
+-- @tparam function func Body of step with signature func(test)
+-- @tparam ?number timeout Timeout of step in ms, `async.timeout` by default
+-- @treturn Expectation Expectation of step
+function Async.step(test, func, timeout)
+  local guard = expectations.Expectation("async step")
+  test:AddExpectation(guard)
+  local step = { finished = false, test = test }
+  --- Finish step with result and check status of test step
+  function step:finish(status, err)
+    if self.finished then return end
+    self.finished = true
+    if self.timer then self.timer:stop() end
+    guard.status = status
+    if err then guard.errorMessage["Error"] = tostring(err) end
+    if test.CheckStatus then test.CheckStatus() end
+  end
+  function step:fail(err)
+    self:finish(expectations.FAILED, err)
+  end
+  local main = createTask(step, func, test)
+  main.future:subscribe(function(ok, result)
+      if ok then step:finish(expectations.SUCCESS) else step:fail(result) end
+    end)
+  step.timer = singleShot(timeout or Async.timeout, function()
+      step:fail("Timeout expired")
+    end)
+  return guard
+end
+
+return Async
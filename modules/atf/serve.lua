@@ -0,0 +1,51 @@
+--- Warm-up script of persistent interpreter server (`interp --serve=<socket>`)
+--
+-- Modules required here stay loaded in server process and every script run
+-- inherits them in forked child, so only modules which don't depend on command
+-- line options at load time are listed. `function_id` is not among them, it copies
+-- interfaces of `config.pathToSDLInterfaces` on load.
+--
+-- *Dependencies:* `atf.util`, `json`, `xml`, `api_loader`, `schema_validation`, `load_schema`,
+-- `protocol_handler.protocol_handler`
+--
+-- *Globals:* `config`, `xmlReporter`
+-- @script atf.serve
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+require("atf.util")
+require("json")
+require("xml")
+require("api_loader")
+require("schema_validation")
+require("load_schema")
+require("protocol_handler/protocol_handler")
+
+--- Find files of loaded modules and of this script
+-- @treturn table Array of paths
+local function loadedFiles()
+  local files = { "data/MOBILE_API.xml", "data/HMI_API.xml" }
+  local source = debug.getinfo(1, "S").source
+  if source:sub(1, 1) == "@" then table.insert(files, source:sub(2)) end
+  local names = { }
+  for name in pairs(package.loaded) do
+    if type(name) == "string" then table.insert(names, name) end
+  end
+  table.sort(names)
+  for _, name in ipairs(names) do
+    local path = package.searchpath(name, package.path) or package.searchpath(name, package.cpath)
+    if path then table.insert(files, path) end
+  end
+  return files
+end
+
+return {
+  --- Server reloads this script when any of files is modified: API schemas and every module
+  -- loaded during warm-up, e.g. `config`
+  files = loadedFiles(),
+  --- Path of xml report of finished script, sent back to client
+  report = function()
+    if config.excludeReport or type(xmlReporter.curr_report_name) ~= "string" then return nil end
+    return xmlReporter.curr_report_name
+  end
+}
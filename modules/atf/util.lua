@@ -9,7 +9,7 @@
   *Globals:* `config`, `xmlReporter`, `atf_logger`, `RequiredArgument`, `OptionalArgument`, `NoArgument`,
   `table2str()`, `print_table()`, `is_file_exists()`, `print_startscript()`, `print_stopscript()`,
   `compareValues()`, `parse_cmdl()`, `PrintUsage()`, `declare_opt()`, `declare_long_opt()`,
-  `declare_short_opt()`, `script_execute()`
+  `declare_short_opt()`, `script_execute()`, `queue_scripts()`, `next_queued_script()`
   @module atf.util
   @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
   @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -23,6 +23,10 @@ local AtfUtil = {
   script_file_name = ""
 }
 local script_files = {}
+--- Scripts which run one by one in this process (see `queue_scripts`)
+local queued_scripts = {}
+--- Copy of configuration taken before the first of queued scripts
+local initial_config = nil
 
 RequiredArgument = utils.RequiredArgument
 OptionalArgument = utils.OptionalArgument
@@ -282,6 +286,84 @@ function AtfUtil.sdl_core(str)
   config.pathToSDL = str
 end
 
+--- Enable reuse of running SDL (property reuseSDL in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.reuse_sdl(str)
+  config.reuseSDL = true
+end
+
+--- Enable attribution of Lua allocations to subsystems (property memoryTags in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.memory_tags(str)
+  config.memoryTags = true
+end
+
+--- Enable accounting of resources used by test steps (property caseResources in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.case_resources(str)
+  config.caseResources = true
+end
+
+--- Enable parsing of mobile messages to native objects (property lazyMessages in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.lazy_messages(str)
+  config.lazyMessages = true
+end
+
+--- Enable binary ATF log (property binaryATFLogs in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.binary_atf_logs(str)
+  config.binaryATFLogs = true
+end
+
+--- Enable native decoding of messages from SDL to HMI (property nativeHmiJson in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.native_hmi_json(str)
+  config.nativeHmiJson = true
+end
+
+--- Enable native I/O thread of mobile connections (property networkThread in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.network_thread(str)
+  config.networkThread = true
+end
+
+--- Enable batched delivery of messages (property batchDelivery in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.batch_delivery(str)
+  config.batchDelivery = true
+end
+
+--- Enable virtual time (property virtualTime in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.virtual_time(str)
+  config.virtualTime = true
+end
+
+--- Enable traffic counters of connections (property connectionMetrics in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.connection_metrics(str)
+  config.connectionMetrics = true
+end
+
+--- Overwrite property connectionMetricsFile in configuration of ATF
+-- @tparam string str Value
+function AtfUtil.connection_metrics_file(str)
+  config.connectionMetricsFile = str
+end
+
+--- Enable latency statistics of SDL responses (property latencyStats in configuration of ATF)
+-- @tparam string str Value
+function AtfUtil.latency_stats(str)
+  config.latencyStats = true
+end
+
+--- Overwrite property latencyStatsFile in configuration of ATF
+-- @tparam string str Value
+function AtfUtil.latency_stats_file(str)
+  config.latencyStatsFile = str
+end
+
 function parse_cmdl()
   arguments = utils.getopt(argv, opts)
   if (arguments) then
@@ -318,6 +400,40 @@ function declare_short_opt(...)
   utils.declare_short_opt(...)
 end
 
+--- Deep copy of configuration table
+-- @tparam table t Table to copy
+-- @treturn table Copy
+local function copy_config(t)
+  local res = {}
+  for k, v in pairs(t) do
+    if type(v) == 'table' then v = copy_config(v) end
+    res[k] = v
+  end
+  return res
+end
+
+--- Queue scripts which run one by one in this process and share SDL (see `config.reuseSDL`)
+-- @param scripts array of paths to script files
+function queue_scripts(scripts)
+  initial_config = copy_config(config)
+  for _, script in ipairs(scripts) do
+    table.insert(queued_scripts, script)
+  end
+end
+
+--- Take the next queued script
+--
+-- Configuration changed by previous script is restored to the one queued scripts started with
+-- @return path to the script file or nil if queue is empty
+function next_queued_script()
+  local script = table.remove(queued_scripts, 1)
+  if script and initial_config then
+    for k in pairs(config) do config[k] = nil end
+    for k, v in pairs(copy_config(initial_config)) do config[k] = v end
+  end
+  return script
+end
+
 --- Test script execution
 -- @param script_name path to the script file with a tests
 function script_execute(script_name)
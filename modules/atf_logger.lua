@@ -2,7 +2,7 @@
 --
 -- *Dependencies:* `json`, `config`, `atf.stdlib.std.io`, `protocol_handler.ford_protocol_constants`
 --
--- *Globals:* `qdatetime`, `timestamp`
+-- *Globals:* `qdatetime`, `timestamp`, `atf_log`
 -- @module atf_logger
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -23,6 +23,7 @@ local rpc_function_id = require('function_id')
 -- @tfield string mobile_log_format Format template for mobile communication log record
 -- @tfield string hmi_log_format Format template for HMI communication log record
 -- @tfield number start_file_timestamp Date + time (timestamp) of start to write log file
+-- @tfield userdata binary_log Writer of binary ATF log (`config.binaryATFLogs`), text log files are not created if set
 local Logger =
 {
   is_open = true,
@@ -33,6 +34,7 @@ local Logger =
   mobile_log_format = '',
   hmi_log_format = '',
   start_file_timestamp = 0,
+  binary_log = nil,
   mt = {
     __index = {}
   }
@@ -42,16 +44,20 @@ Logger.mobile_log_format = "%s (%s) [rpcFunction: %s, sessionId: %s, version: %s
       .. "encryption: %s, serviceType: %s, frameInfo: %s, messageId: %s] : %s \n"
 Logger.hmi_log_format = "%s (%s) : %s \n"
 
+--- Function names by identifiers, built on the first lookup
+local function_names = nil
+
 --- Get function name from Mobile API
 -- @tparam number function_id Function identifier
 -- @treturn string Function name
 local function get_function_name(function_id)
-  for name, id in pairs(rpc_function_id) do
-    if id == function_id then
-      return name
+  if not function_names then
+    function_names = { }
+    for name, id in pairs(rpc_function_id) do
+      function_names[id] = name
     end
   end
-  return "nil"
+  return function_names[function_id] or "nil"
 end
 
 --- Create string representation of current time in set format
@@ -84,6 +90,10 @@ end
 -- @tparam string tract Tract information
 -- @tparam string message String representation of message from mobile application to SDL
 function Logger:MOBtoSDL(tract, message)
+  if self.binary_log then
+    self.binary_log:mobile(atf_log.MOB_TO_SDL, message, message.payload)
+    return
+  end
   local log_str = string.format(Logger.mobile_log_format,"MOB->SDL ", Logger.formated_time(),
     get_function_name(message.rpcFunctionId), message.sessionId, message.version, message.frameType,
     message.encryption, message.serviceType, message.frameInfo, message.messageId, message.payload)
@@ -98,6 +108,10 @@ end
 --- Store auxiliary message about start of new test step for test scenario into ATF log file
 -- @tparam string test_case_name Test step name
 function Logger:StartTestCase(test_case_name)
+  if self.binary_log then
+    self.binary_log:test_case(test_case_name)
+    return
+  end
   self.atf_log_file:write(string.format("\n\n===== %s : \n", test_case_name))
   if config.storeFullATFLogs then
     self.full_atf_log_file:write(string.format("\n\n===== %s : \n", test_case_name))
@@ -108,10 +122,15 @@ end
 -- @tparam string tract Tract information
 -- @tparam string message String representation of message from SDL to mobile application
 function Logger:SDLtoMOB(tract, message)
-  local payload = message.payload
+  -- JSON text received from SDL is logged as is, without encoding decoded payload
+  local payload = message.rawPayload or message.payload
   if type(payload) == "table" then
     payload = json.encode(payload)
   end
+  if self.binary_log then
+    self.binary_log:mobile(atf_log.SDL_TO_MOB, message, payload)
+    return
+  end
   local log_str = string.format(Logger.mobile_log_format,"SDL->MOB", Logger.formated_time(),
     get_function_name(message.rpcFunctionId), message.sessionId, message.version, message.frameType,
     message.encryption, message.serviceType, message.frameInfo, message.messageId, payload)
@@ -127,6 +146,10 @@ end
 -- @tparam string tract Tract information
 -- @tparam string message String representation of message from HMI to SDL
 function Logger:HMItoSDL(tract, message)
+  if self.binary_log then
+    self.binary_log:hmi(atf_log.HMI_TO_SDL, message)
+    return
+  end
   local log_str = string.format(Logger.hmi_log_format, "HMI->SDL", Logger.formated_time(), message)
   if is_hmi_tract(tract, message) then
     self.atf_log_file:write(log_str)
@@ -140,6 +163,10 @@ end
 -- @tparam string tract Tract information
 -- @tparam string message String representation of message from SDL to HMI
 function Logger:SDLtoHMI(tract, message)
+  if self.binary_log then
+    self.binary_log:hmi(atf_log.SDL_TO_HMI, message)
+    return
+  end
   local log_str = string.format(Logger.hmi_log_format, "SDL->HMI", Logger.formated_time(), message)
   if is_hmi_tract(tract, message) then
     self.atf_log_file:write(log_str)
@@ -182,6 +209,24 @@ function Logger.init_log(script_name)
 
   local timestamp = tostring(os.date('%Y%m%d%H%M%S', os.time()))
   local log_file_name = get_log_file_name(timestamp, "ATFLogs")
+  if Logger.binary_log then
+    Logger.binary_log:close()
+    Logger.binary_log = nil
+  end
+  if config.binaryATFLogs and atf_log then
+    local err
+    Logger.binary_log, err = atf_log.open(log_file_name .. ".atflog", script_name)
+    if Logger.binary_log then
+      setmetatable(Logger, Logger.mt)
+      Logger.is_open = true
+      return Logger
+    end
+    print("atf_logger: " .. tostring(err) .. ", text log is used")
+  end
+  -- Logs of previous script run in this process (see `config.reuseSDL`)
+  for _, f in ipairs({ Logger.atf_log_file, Logger.full_atf_log_file }) do
+    if io.type(f) == "file" then f:close() end
+  end
   local atf_log_file_name = log_file_name ..".txt"
   Logger.atf_log_file = io.open(atf_log_file_name, "r")
   if Logger.atf_log_file ~= nil then
@@ -221,6 +266,11 @@ end
 --- Store auxiliary message about finish of test scenario into ATF log file
 -- @tparam number count Test scenario executing time in seconds
 function Logger.LOGTestFinish(count)
+  if Logger.binary_log then
+    Logger.binary_log:finish(count)
+    Logger.binary_log:flush()
+    return
+  end
   Logger.atf_log_file:write(string.format("\n\n===== Total executing time is %s =====\n", count))
   if config.storeFullATFLogs then
     Logger.full_atf_log_file:write(string.format("\n\n===== Total executing time is %s =====\n", count))
@@ -0,0 +1,191 @@
+---- Resource accounting of test steps.
+--
+-- Connections count messages and bytes they send and receive, test base takes
+-- snapshot of counters, Lua heap, GC cycles, CPU time of ATF and SDL process
+-- on start of each test step and reports differences on its finish.
+-- SDL process is found by `sdl.pid` file, its CPU time and RSS are read from `/proc`.
+--
+-- *Dependencies:* `memory`, `json`
+--
+-- *Globals:* `config`, `xmlReporter`
+-- @module case_resources
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local memory = require("memory")
+local json = require("json")
+
+local CaseResources = {}
+
+--- Counters of connections by names
+local connections = {}
+--- Names of connections in order of creation
+local connection_names = {}
+--- Number of garbage collection cycles
+local gc_cycles = 0
+--- Snapshot taken on start of test step
+local snapshot = nil
+--- Clock ticks per second of /proc/<pid>/stat times
+local clock_ticks = nil
+--- Opened summary file and its path
+local summary = nil
+local summary_path = nil
+
+-- Sentinel object is resurrected by its finalizer, so finalizer runs once per GC cycle
+local function gc_sentinel()
+  setmetatable({}, { __gc = function()
+        gc_cycles = gc_cycles + 1
+        gc_sentinel()
+      end })
+end
+gc_sentinel()
+
+--- Get counters of connection, counters are created on the first call
+-- @tparam string name Connection name
+-- @treturn table Counters: `messages_sent`, `bytes_sent`, `messages_received`, `bytes_received`
+function CaseResources.connection(name)
+  local counters = connections[name]
+  if not counters then
+    counters = { messages_sent = 0, bytes_sent = 0, messages_received = 0, bytes_received = 0 }
+    connections[name] = counters
+    table.insert(connection_names, name)
+  end
+  return counters
+end
+
+--- Get unique connection name with given prefix
+-- @tparam string prefix Prefix of name, e.g. "mobile"
+-- @treturn string Name which has no counters yet
+function CaseResources.unique_name(prefix)
+  local n = 1
+  while connections[prefix .. n] do n = n + 1 end
+  return prefix .. n
+end
+
+local function read_file(path)
+  local f = io.open(path, "r")
+  if not f then return nil end
+  local content = f:read("*a")
+  f:close()
+  return content
+end
+
+--- Read CPU time (ms) and RSS (kB) of SDL process
+-- @treturn number CPU time, nil if SDL is not running
+-- @treturn number RSS
+local function sdl_usage()
+  local pid = read_file("sdl.pid")
+  pid = pid and pid:match("%d+")
+  if not pid then return nil end
+  local stat = read_file("/proc/" .. pid .. "/stat")
+  local status = read_file("/proc/" .. pid .. "/status")
+  if not stat or not status then return nil end
+  -- Process name may contain spaces and parentheses, fields are counted after the last ") "
+  local fields = {}
+  for field in stat:match(".*%) (.*)"):gmatch("%S+") do table.insert(fields, field) end
+  if not clock_ticks then
+    local p = io.popen("getconf CLK_TCK")
+    clock_ticks = tonumber(p and p:read("*l")) or 100
+    if p then p:close() end
+  end
+  -- utime and stime are fields 14 and 15 of stat, i.e. 12th and 13th after name
+  local cpu_ms = (tonumber(fields[12]) + tonumber(fields[13])) * 1000 / clock_ticks
+  local rss_kb = tonumber(status:match("VmRSS:%s*(%d+)")) or 0
+  return cpu_ms, rss_kb
+end
+
+local function copy(t)
+  local res = {}
+  for k, v in pairs(t) do res[k] = v end
+  return res
+end
+
+--- Take snapshot of counters on start of test step
+function CaseResources.start()
+  snapshot = {
+    connections = {},
+    heap = memory.stats().live_bytes,
+    gc_cycles = gc_cycles,
+    cpu = os.clock()
+  }
+  for name, counters in pairs(connections) do
+    snapshot.connections[name] = copy(counters)
+  end
+  snapshot.sdl_cpu_ms, snapshot.sdl_rss_kb = sdl_usage()
+end
+
+--- Calculate resources used by test step since `start`
+-- @treturn table Resources: `cpu_ms`, `heap_delta`, `gc_cycles`, `sdl_cpu_ms`, `sdl_rss_kb`,
+-- `sdl_rss_delta_kb` and `connections` table of counters by connection names
+function CaseResources.finish()
+  if not snapshot then return nil end
+  local res = {
+    cpu_ms = math.floor((os.clock() - snapshot.cpu) * 1000 + 0.5),
+    heap_delta = memory.stats().live_bytes - snapshot.heap,
+    gc_cycles = gc_cycles - snapshot.gc_cycles,
+    connections = {}
+  }
+  for _, name in ipairs(connection_names) do
+    local before = snapshot.connections[name] or {}
+    local diff = {}
+    for k, v in pairs(connections[name]) do
+      diff[k] = v - (before[k] or 0)
+    end
+    res.connections[name] = diff
+  end
+  local sdl_cpu_ms, sdl_rss_kb = sdl_usage()
+  if sdl_cpu_ms then
+    res.sdl_cpu_ms = math.floor(sdl_cpu_ms - (snapshot.sdl_cpu_ms or sdl_cpu_ms) + 0.5)
+    res.sdl_rss_kb = sdl_rss_kb
+    res.sdl_rss_delta_kb = sdl_rss_kb - (snapshot.sdl_rss_kb or sdl_rss_kb)
+  end
+  snapshot = nil
+  return res
+end
+
+--- Flatten resources into attributes of test step in xml report
+-- @tparam table resources Result of `finish`
+-- @tparam table attributes Attributes to be extended
+-- @treturn table Extended attributes
+function CaseResources.attributes(resources, attributes)
+  for k, v in pairs(resources) do
+    if k ~= "connections" then attributes[k] = v end
+  end
+  for name, counters in pairs(resources.connections) do
+    for k, v in pairs(counters) do
+      attributes[name .. "_" .. k] = v
+    end
+  end
+  return attributes
+end
+
+--- Append summary line of test step to JSON lines file
+--
+-- File is placed next to xml report (`<report>_resources.jsonl`)
+-- unless `config.caseResourcesFile` is set
+-- @tparam string case_name Test step name
+-- @tparam boolean result Test step result
+-- @tparam number duration Test step duration in ms
+-- @tparam table resources Result of `finish`
+function CaseResources.write_summary(case_name, result, duration, resources)
+  local path = config.caseResourcesFile
+  if not path or path == "" then
+    if config.excludeReport or type(xmlReporter.curr_report_name) ~= "string" then return end
+    path = xmlReporter.curr_report_name:gsub("%.xml$", "") .. "_resources.jsonl"
+  end
+  if path ~= summary_path then
+    if summary then summary:close() end
+    summary = io.open(path, "a")
+    summary_path = path
+  end
+  if not summary then return end
+  local line = copy(resources)
+  line.script = xmlReporter.script_file_name
+  line.case = case_name
+  line.result = result
+  line.duration_ms = duration
+  summary:write(json.encode(line), "\n")
+  summary:flush()
+end
+
+return CaseResources
@@ -19,6 +19,12 @@ config.mobileHost = "localhost"
 config.mobilePort = 12345
 --- Define timeout for Heartbeat in msec
 config.heartbeatTimeout = 7000
+--- Flag which defines whether heartbeat of mobile sessions is handled by native service.
+-- Heartbeat flags of mobile session are passed to the service on heartbeat start and whenever a script changes them
+config.nativeHeartbeat = false
+--- Define maximal payload size of single frame for each version of Ford protocol.
+-- Bigger messages are split into First and Consecutive frames
+config.maxProtocolPayloadSize = { [1] = 1488, [2] = 1488, [3] = 1488, [4] = 1488 }
 --- Define default version of Ford protocol
 --
 -- 1 - basic
@@ -43,16 +49,72 @@ config.SDL = "smartDeviceLinkCore"
 config.sdl_logs_host = "localhost"
 --- Define port for SDL logs
 config.sdl_logs_port = 6676
+--- Flag which defines whether SDL logs are captured by native sink (separate thread, kernel-side copy)
+-- instead of Lua handler of socket data
+config.sdlLogsNativeSink = false
+--- Define host and port of SDL performance log, timing records of SDL are matched with mobile RPCs
+-- and time of every RPC is split into transport, SDL processing and HMI round trip in xml report.
+-- Performance log is not used if host is empty
+config.perflogConnection = ""
+config.perflogConnectionPort = ""
 --- Flag which defines behavior of ATF on SDL crash
 config.ExitOnCrash = true
 --- Flag which defines whether ATF starts SDL on startup
 config.autorunSDL = true
+--- Flag which defines whether scripts passed to one ATF run share SDL.
+-- Scripts run one by one in the same process, SDL with its HMI and log connections is kept between them
+-- and reset by closing mobile connections of previous script instead of restart
+config.reuseSDL = false
+--- Flag which defines whether Lua allocations are counted by ATF subsystems (protocol handler, json, reporter).
+-- Heap statistics and allocations by subsystems are printed on finish of script
+config.memoryTags = false
+--- Flag which defines whether resources used by each test step are accounted: messages and bytes of connections,
+-- Lua heap delta, GC cycles, CPU time of ATF, CPU time and RSS of SDL process.
+-- They are added to xml report and written to `<report>_resources.jsonl` (or to `config.caseResourcesFile` if set)
+config.caseResources = false
+config.caseResourcesFile = ""
+--- Flag which defines whether messages from SDL to mobile are parsed to native objects instead of tables.
+-- Header fields are read from frame bytes on access, JSON payload is decoded on the first access to `payload`
+config.lazyMessages = false
+--- Flag which defines whether ATF log is written in compact binary form (`<log>.atflog`) instead of text.
+-- Full log is written, `tools/atf_logcat.lua` renders it to text or JSON and filters records
+config.binaryATFLogs = false
+--- Flag which defines whether frames from SDL to HMI are taken by native receiver as UTF-8 bytes
+-- and JSON is decoded in native code instead of Lua decoder
+config.nativeHmiJson = false
+--- Flag which defines whether mobile TCP connections are served by native I/O thread.
+-- The thread reads socket and splits it to frames independently of Lua load, frames are handed over in batches
+config.networkThread = false
+--- Flag which defines whether messages received during one event loop iteration are dispatched as a batch.
+-- Messages keep their order, expectations are validated after messages they matched and once per batch
+config.batchDelivery = false
+--- Flag which defines whether timers and `timestamp()` run on virtual clock.
+-- When nothing happens during `config.virtualTimeIdle` ms the clock jumps to the next timer deadline,
+-- so timeouts and delays take no real time. Intended for mock SDL or peers which are not expected to answer
+config.virtualTime = false
+config.virtualTimeIdle = 10
+--- Flag which defines whether native traffic counters of connections are added to xml report for every test step:
+-- bytes and frames in/out, write queue, read-to-dispatch latency, time mobile messages waited for write credit.
+-- If `config.connectionMetricsFile` is set all counters are also written there (JSON lines) every
+-- `config.connectionMetricsInterval` ms and on finish of every test step
+config.connectionMetrics = false
+config.connectionMetricsFile = ""
+config.connectionMetricsInterval = 1000
+--- Flag which defines whether latency of SDL responses to mobile RPCs and HMI requests is measured.
+-- p50/p90/p99/max of every test step are added to xml report by connections, summary of the whole run
+-- by connections and function names is added to the end of xml report and written to
+-- `config.latencyStatsFile` (JSON) or next to xml report if it is empty
+config.latencyStats = false
+config.latencyStatsFile = ""
 --- Flag which defines whether ATF displays time of test step run
 config.ShowTimeInConsole = true
 --- Flag which defines whether ATF performs validation of Mobile and HMI messages by API
 config.ValidateSchema = true
 --- Flag which defines whether ATF ignores collecting of reports
 config.excludeReport = false
+--- Flag which defines whether ATF writes xml report to disk incrementally instead of keeping it in memory.
+-- Results of test steps are written as `CaseResult` child elements of test step
+config.reportStreaming = false
 --- Flag which defines whether ATF creates full ATF logs (with json files and service messages)
 config.storeFullATFLogs = true
 --- Flag which defines whether ATF stores full SDLCore logs
@@ -0,0 +1,136 @@
+---- Native traffic counters of connections.
+--
+-- Connections register their sockets, `socket:stats()` of network module gives bytes and frames
+-- received and sent, bytes waiting in write queue, read-to-dispatch latency (time between data
+-- arrival and its read by Lua) and age of data not read yet (`pending_ms`).
+-- Mobile connections add time messages waited for bytesWritten credit of message dispatcher.
+-- Growing `pending_ms` or latency means ATF is backlogged, growing `write_queue` or credit wait
+-- means SDL doesn't read fast enough.
+--
+-- *Dependencies:* `json`, `timers`, `qt`
+--
+-- *Globals:* `config`, `timestamp()`
+-- @module connection_metrics
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local json = require("json")
+
+local ConnectionMetrics = {}
+
+--- Counters which are accumulated, the rest of fields are current values
+local accumulated = {
+  bytes_in = true, bytes_out = true, frames_in = true, frames_out = true,
+  latency_count = true, latency_total_ms = true, credit_blocked = true, credit_blocked_ms = true
+}
+--- Registered connections by names, socket is referenced weakly, so closed connections are collected
+local sources = {}
+--- Functions returning additional counters by sockets, they live as long as their sockets
+local extras = setmetatable({}, { __mode = "k" })
+--- Names of connections in order of registration
+local source_names = {}
+--- Counters taken on start of test step
+local snapshot = nil
+--- Periodic export: opened file and timer
+local export = nil
+
+--- Register socket of connection
+-- @tparam string name Connection name, e.g. "mobile1"
+-- @param socket Socket of network module
+-- @tparam function extra Optional function returning table of additional counters
+function ConnectionMetrics.register(name, socket, extra)
+  if not socket or not socket.stats then return end
+  if not sources[name] then table.insert(source_names, name) end
+  sources[name] = setmetatable({ socket = socket }, { __mode = "v" })
+  extras[socket] = extra
+end
+
+--- Collect current counters of all registered connections
+-- @treturn table Counters by connection names
+function ConnectionMetrics.collect()
+  local res = {}
+  for _, name in ipairs(source_names) do
+    local source = sources[name]
+    if source.socket then
+      local stats = source.socket:stats()
+      local extra = extras[source.socket]
+      if extra then
+        for k, v in pairs(extra()) do stats[k] = v end
+      end
+      res[name] = stats
+    end
+  end
+  return res
+end
+
+--- Take snapshot of counters on start of test step
+function ConnectionMetrics.start()
+  snapshot = ConnectionMetrics.collect()
+end
+
+--- Calculate counters of test step since `start`
+-- @treturn table Counters by connection names, accumulated counters are differences,
+-- `latency_avg_ms` is average latency of the step
+function ConnectionMetrics.finish()
+  if not snapshot then return nil end
+  local res = {}
+  for name, stats in pairs(ConnectionMetrics.collect()) do
+    local before = snapshot[name] or {}
+    local diff = {}
+    for k, v in pairs(stats) do
+      diff[k] = accumulated[k] and v - (before[k] or 0) or v
+    end
+    if diff.latency_count > 0 then
+      diff.latency_avg_ms = diff.latency_total_ms / diff.latency_count
+    end
+    res[name] = diff
+  end
+  snapshot = nil
+  return res
+end
+
+--- Flatten counters into attributes of test step in xml report
+-- @tparam table metrics Result of `finish`
+-- @tparam table attributes Attributes to be extended
+-- @treturn table Extended attributes
+function ConnectionMetrics.attributes(metrics, attributes)
+  for name, stats in pairs(metrics) do
+    for k, v in pairs(stats) do
+      attributes[name .. "_" .. k] = math.floor(v * 1000 + 0.5) / 1000
+    end
+  end
+  return attributes
+end
+
+--- Write snapshot of all counters to export file
+-- @tparam string case_name Name of finished test step, nil for periodic snapshot
+function ConnectionMetrics.write(case_name)
+  if not export then return end
+  local line = { time = timestamp(), connections = ConnectionMetrics.collect() }
+  line.case = case_name
+  export.file:write(json.encode(line), "\n")
+  export.file:flush()
+end
+
+--- Start periodic export of counters
+-- @tparam string path JSON lines file
+-- @tparam number interval Interval in ms
+function ConnectionMetrics.start_export(path, interval)
+  ConnectionMetrics.stop_export()
+  local file = io.open(path, "w")
+  if not file then return end
+  export = { file = file, timer = timers.Timer(), proxy = qt.dynamic() }
+  function export.proxy.timeout() ConnectionMetrics.write() end
+  qt.connect(export.timer, "timeout()", export.proxy, "timeout()")
+  export.timer:start(interval)
+end
+
+--- Stop periodic export of counters
+function ConnectionMetrics.stop_export()
+  if not export then return end
+  export.timer:stop()
+  export.file:close()
+  export = nil
+end
+
+return ConnectionMetrics
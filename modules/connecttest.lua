@@ -25,6 +25,7 @@ local functionId = require('function_id')
 local SDL = require('SDL')
 local exit_codes = require('exit_codes')
 local load_schema = require('load_schema')
+local heartbeat_monitor = require('services/heartbeat_monitor')
 
 local mob_schema = load_schema.mob_schema
 local hmi_schema = load_schema.hmi_schema
@@ -119,36 +120,81 @@ end
 
 
 
---- Add test step with start SDL
-function Test:RunSDL()
-  self:runSDL()
-end
+--- Expectations pinned by HMI initialization, kept while SDL is reused
+local hmiInitExpectations = { }
+--- Mobile connections of previous script to be closed by SDL reset
+local previousConnections = { }
 
---- Add critical test step with initialize
--- HMI with base checks
-function Test:InitHMI()
-  critical(true)
-  self:initHMI()
-end
+--- Add test steps of preconditions
+--
+-- SDL kept from previous script (`SDL.reused`) has HMI initialized already,
+-- so its state is reset instead of start and HMI initialization
+local function addPreconditions()
+  if SDL.reused then
+    --- Add critical test step with reset of reused SDL
+    function Test:ResetSDL()
+      critical(true)
+      self:resetSDL()
+    end
+  else
+    --- Add test step with start SDL
+    function Test:RunSDL()
+      self:runSDL()
+    end
 
---- Add critical test step with performing of onReady communications with base checks
-function Test:InitHMI_onReady()
-  critical(true)
-  self:initHMI_onReady()
-end
+    --- Add critical test step with initialize
+    -- HMI with base checks
+    function Test:InitHMI()
+      critical(true)
+      self:initHMI()
+    end
 
---- Add critical test step with open
--- default mobile connection
-function Test:ConnectMobile()
-  critical(true)
-  self:connectMobile()
+    --- Add critical test step with performing of onReady communications with base checks
+    function Test:InitHMI_onReady()
+      critical(true)
+      self:initHMI_onReady()
+    end
+  end
+
+  --- Add critical test step with open
+  -- default mobile connection
+  function Test:ConnectMobile()
+    critical(true)
+    self:connectMobile()
+  end
+
+  --- Add critical test step with start
+  -- default mobile session on default mobile connection
+  function Test:StartSession()
+    critical(true)
+    self:startSession()
+  end
 end
 
---- Add critical test step with start
--- default mobile session on default mobile connection
-function Test:StartSession()
-  critical(true)
-  self:startSession()
+addPreconditions()
+
+--- Prepare connections and test steps for the next script run in this process (see `config.reuseSDL`)
+--
+-- Events and expectations of finished script are dropped. While SDL is reused, HMI connection is kept
+-- with expectations pinned by HMI initialization, other connections are closed by `resetSDL` step
+function Test:prepareNextScript()
+  event_dispatcher:ClearEvents()
+  if SDL.reused then
+    for _, e in ipairs(hmiInitExpectations) do
+      event_dispatcher:AddEvent(e.connection, e.event, e)
+    end
+  else
+    hmiInitExpectations = { }
+  end
+  self.expectations_list = expectations.ExpectationsList()
+  for timer in pairs(self.timers) do timer:stop() end
+  self.timers = { }
+  previousConnections = { }
+  for _, connection in ipairs(event_dispatcher:Connections()) do
+    if connection ~= self.hmiConnection then table.insert(previousConnections, connection) end
+  end
+  if not SDL.reused then self:resetSDL() end
+  addPreconditions()
 end
 
 --- Start SDL
@@ -164,6 +210,24 @@ function Test:runSDL()
   SDL.autoStarted = true
 end
 
+--- Reset state of SDL kept from previous script
+--
+-- Mobile connections of previous script are closed, so SDL unregisters their applications.
+-- Step finishes when SDL notifies HMI about unregistration of every application it reported
+function Test:resetSDL()
+  heartbeat_monitor.StopAll()
+  if SDL.reused then
+    xmlReporter.AddMessage("StartSDL", {["message"] = "SDL reused"})
+    for _, appID in pairs(self.applications or { }) do
+      EXPECT_HMINOTIFICATION("BasicCommunication.OnAppUnregistered", { appID = appID })
+    end
+  end
+  for _, connection in ipairs(previousConnections) do
+    connection:Close()
+  end
+  previousConnections = { }
+end
+
 --- Initialize HMI with base checks
 function Test:initHMI()
   local function registerComponent(name, subscriptions)
@@ -475,7 +539,7 @@ function Test:initHMI_onReady()
   ExpectRequest("VehicleInfo.IsReady", true, { available = true })
 
   self.applications = { }
-  ExpectRequest("BasicCommunication.UpdateAppList", false, { })
+  local updateAppList = ExpectRequest("BasicCommunication.UpdateAppList", false, { })
   :Pin()
   :Do(function(_, data)
       self.hmiConnection:SendResponse(data.id, data.method, "SUCCESS", { })
@@ -484,6 +548,7 @@ function Test:initHMI_onReady()
         self.applications[app.appName] = app.appID
       end
     end)
+  table.insert(hmiInitExpectations, updateAppList)
 
   self.hmiConnection:SendNotification("BasicCommunication.OnReady")
 end
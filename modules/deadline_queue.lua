@@ -0,0 +1,102 @@
+--- Module which provides priority queue of items ordered by deadline
+--
+-- Queue is a binary min-heap. Items are never removed from the middle of the queue:
+-- owner of the queue is expected to skip outdated entries when they are popped (lazy deletion)
+--
+-- *Dependencies:* none
+--
+-- *Globals:* none
+-- @module deadline_queue
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local DQ = { }
+local mt = { __index = { } }
+
+--- Type which represents deadline queue
+-- @type DeadlineQueue
+
+--- Construct instance of DeadlineQueue type
+-- @treturn DeadlineQueue Constructed instance
+function DQ.DeadlineQueue()
+  local res =
+  {
+    --- Deadlines of entries in heap order
+    deadlines = { },
+    --- Items of entries in heap order
+    items = { },
+    --- Number of entries
+    size = 0
+  }
+  setmetatable(res, mt)
+  return res
+end
+
+--- Add item to queue
+-- @tparam number deadline Deadline of item
+-- @tparam ? item Item
+-- @treturn boolean True if item became the earliest one in queue
+function mt.__index:push(deadline, item)
+  local d, it = self.deadlines, self.items
+  local i = self.size + 1
+  self.size = i
+  -- sift up
+  while i > 1 do
+    local parent = math.floor(i / 2)
+    if d[parent] <= deadline then break end
+    d[i], it[i] = d[parent], it[parent]
+    i = parent
+  end
+  d[i], it[i] = deadline, item
+  return i == 1
+end
+
+--- Get the earliest entry of queue without removing it
+-- @treturn number Deadline of the earliest entry or nil if queue is empty
+-- @treturn ? Item of the earliest entry
+function mt.__index:peek()
+  return self.deadlines[1], self.items[1]
+end
+
+--- Remove the earliest entry from queue
+-- @treturn number Deadline of removed entry or nil if queue is empty
+-- @treturn ? Item of removed entry
+function mt.__index:pop()
+  local n = self.size
+  if n == 0 then return nil end
+  local d, it = self.deadlines, self.items
+  local top_deadline, top_item = d[1], it[1]
+  local last_deadline, last_item = d[n], it[n]
+  d[n], it[n] = nil, nil
+  n = n - 1
+  self.size = n
+  if n > 0 then
+    -- sift down
+    local i = 1
+    while true do
+      local child = i * 2
+      if child > n then break end
+      if child < n and d[child + 1] < d[child] then child = child + 1 end
+      if last_deadline <= d[child] then break end
+      d[i], it[i] = d[child], it[child]
+      i = child
+    end
+    d[i], it[i] = last_deadline, last_item
+  end
+  return top_deadline, top_item
+end
+
+--- Check whether queue is empty
+-- @treturn boolean True if queue is empty
+function mt.__index:empty()
+  return self.size == 0
+end
+
+--- Remove all entries from queue
+function mt.__index:clear()
+  self.deadlines = { }
+  self.items = { }
+  self.size = 0
+end
+
+return DQ
@@ -1,13 +1,20 @@
 --- Module which is responsible for dispatching events with expectations
 --
--- *Dependencies:* `expectations`, `events`
+-- Expectations are validated incrementally: only expectations which got new occurences
+-- (or changed their settings) and expectations with passed deadline are re-evaluated
 --
--- *Globals:* `expectations`, `events`, `res`, `c`, `e`, `exp`, `pool`
+-- With batches enabled connections which support `OnInputBatch` deliver all messages
+-- received during event loop iteration by one call, see `RaiseEvents`
+--
+-- *Dependencies:* `expectations`, `events`, `deadline_queue`
+--
+-- *Globals:* `expectations`, `events`, `res`, `c`, `e`, `exp`, `pool`, `timestamp()`
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
 
 expectations = require('expectations')
 events = require('events')
+local dq = require('deadline_queue')
 
 --- Type which is responsible for dispatching events with expectations
 -- @type EventDispatcher
@@ -28,7 +35,21 @@ function Dispatcher.EventDispatcher()
     --- Pre event handler
     preEventHandler = nil,
     --- Post event handler
-    postEventHandler = nil
+    postEventHandler = nil,
+    --- Handler of change of the earliest deadline
+    deadlineHandler = nil,
+    --- Function which tells whether current test step still waits for events
+    pendingCheck = nil,
+    --- Expectations registered in pools (weak keys)
+    _registered = setmetatable({ }, { __mode = "k" }),
+    --- Expectations to be validated
+    _dirty = { },
+    --- Deadlines of pending expectations
+    _deadlines = dq.DeadlineQueue(),
+    --- The earliest deadline reported to deadline handler
+    _armed = nil,
+    --- Whether connections deliver messages in batches
+    _batches = false
   }
   setmetatable(res, mt)
   return res
@@ -78,18 +99,99 @@ function mt.__index:OnPostEvent(func)
   self.postEventHandler = func
 end
 
---- Validate all expectations
-function mt.__index:validateAll()
+--- Set handler for change of the earliest expectation deadline
+-- @tparam function func Handler with signature func(deadline), deadline is `timestamp()` value
+function mt.__index:OnDeadline(func)
+  self.deadlineHandler = func
+end
+
+--- Set function which tells whether current test step still waits for events
+--
+-- In a batch post event handler is called after a message only if the function returns false,
+-- i.e. the message may have finished the step
+-- @tparam function func Function without arguments which returns boolean
+function mt.__index:SetPendingCheck(func)
+  self.pendingCheck = func
+end
 
-  local function iter(pool)
-    for e, exp in pairs(pool) do
-      exp:validate()
+--- Enable delivery of messages in batches for connections added afterwards
+-- @tparam boolean enable True to enable batches
+function mt.__index:EnableBatches(enable)
+  self._batches = enable and true or false
+end
+
+--- Get the earliest deadline of pending expectations
+-- @treturn number Deadline (`timestamp()` value) or nil if there are no pending expectations
+function mt.__index:NextDeadline()
+  return (self._deadlines:peek())
+end
+
+--- Report change of the earliest deadline to deadline handler
+-- @tparam EventDispatcher self Event dispatcher
+local function notifyDeadline(self)
+  local deadline = self._deadlines:peek()
+  if deadline ~= self._armed then
+    self._armed = deadline
+    if deadline and self.deadlineHandler then
+      self.deadlineHandler(deadline)
     end
   end
+end
 
-  for c, pool in pairs(self._pool3) do iter(pool) end
-  for c, pool in pairs(self._pool2) do iter(pool) end
-  for c, pool in pairs(self._pool1) do iter(pool) end
+--- Put expectation into deadline queue if it is still pending
+-- @tparam EventDispatcher self Event dispatcher
+-- @tparam Expectation e Expectation
+local function schedule(self, e)
+  if e.status then return end
+  local deadline = e.ts + e.timeout
+  if e.deadline ~= deadline then
+    e.deadline = deadline
+    self._deadlines:push(deadline, e)
+  end
+end
+
+--- Mark expectation as changed, so it is validated on next `validateAll`
+-- @tparam Expectation e Expectation
+function mt.__index:Invalidate(e)
+  if not self._registered[e] then return end
+  self._dirty[e] = true
+  schedule(self, e)
+  notifyDeadline(self)
+end
+
+--- Validate changed expectations
+-- @tparam EventDispatcher self Event dispatcher
+local function validateDirty(self)
+  local dirty = self._dirty
+  if next(dirty) then
+    self._dirty = { }
+    for e in pairs(dirty) do
+      if self._registered[e] then
+        e:validate()
+        schedule(self, e)
+      end
+    end
+  end
+end
+
+--- Validate changed expectations and expectations with passed deadline
+function mt.__index:validateAll()
+  validateDirty(self)
+
+  local now = timestamp()
+  local queue = self._deadlines
+  while true do
+    local deadline, e = queue:peek()
+    if not deadline or deadline >= now then break end
+    queue:pop()
+    -- skip outdated entries
+    if e.deadline == deadline and self._registered[e] then
+      e.deadline = nil
+      e:validate()
+      schedule(self, e)
+    end
+  end
+  notifyDeadline(self)
 end
 
 --- Subscribe on connection's [[OnInputData]] signal
@@ -106,6 +208,7 @@ function mt.__index:AddConnection(connection)
       exp = this:GetHandler(self, events.connectedEvent)
       if exp then
         exp.occurences = exp.occurences + 1
+        this._dirty[exp] = true
         exp:Action()
         this:validateAll()
       end
@@ -120,6 +223,7 @@ function mt.__index:AddConnection(connection)
       exp = this:GetHandler(self, events.disconnectedEvent)
       if exp then
         exp.occurences = exp.occurences + 1
+        this._dirty[exp] = true
         exp:Action()
         this:validateAll()
       end
@@ -127,9 +231,43 @@ function mt.__index:AddConnection(connection)
         this.postEventHandler(events.disconnectedEvent)
       end
     end)
-  connection:OnInputData(function (self, data)
-      this:RaiseEvent(self, data)
-    end)
+  if self._batches and connection.OnInputBatch then
+    connection:OnInputBatch(function (self, list)
+        this:RaiseEvents(self, list)
+      end)
+  else
+    connection:OnInputData(function (self, data)
+        this:RaiseEvent(self, data)
+      end)
+  end
+end
+
+--- Get connections added to dispatcher
+-- @treturn table Array of connections
+function mt.__index:Connections()
+  local res = { }
+  for connection in pairs(self._pool1) do table.insert(res, connection) end
+  return res
+end
+
+--- Count occurence of event and run actions of expectation
+-- @tparam EventDispatcher self Event dispatcher
+-- @tparam Expectation exp Expectation
+-- @tparam table data Data of event
+local function occur(self, exp, data)
+  exp.occurences = exp.occurences + 1
+  self._dirty[exp] = true
+  if data then
+    if exp.verifyData then
+      for k, v in pairs(exp.verifyData) do
+          v(exp, data)
+          if (exp.status == expectations.FAILED) then
+              break
+          end
+      end
+    end
+    exp:Action(data)
+  end
 end
 
 --- Raise event
@@ -141,18 +279,7 @@ function mt.__index:RaiseEvent(connection, data)
   end
   exp = self:FindHandler(connection, data)
   if exp then
-    exp.occurences = exp.occurences + 1
-    if data then
-      if exp.verifyData then
-        for k, v in pairs(exp.verifyData) do
-            v(exp, data)
-            if (exp.status == expectations.FAILED) then
-                break
-            end
-        end
-      end
-      exp:Action(data)
-    end
+    occur(self, exp, data)
     self:validateAll()
   end
   if self.postEventHandler then
@@ -160,24 +287,86 @@ function mt.__index:RaiseEvent(connection, data)
   end
 end
 
+--- Raise events for batch of messages
+--
+-- Messages are dispatched in order of the batch. Matched message validates only expectations it changed.
+-- While pending check (see `SetPendingCheck`) reports that test step still waits for events and no
+-- deadline has passed, the step can't finish, so post event handler is not called. Once a message
+-- may have finished the step, all expectations are validated and post event handler is called right
+-- after it, and the rest of batch is matched against expectations of the next step. Without pending
+-- check every message is followed by post event handler as with `RaiseEvent`. Pre event handler is
+-- called for every message.
+-- @tparam Connection connection Mobile/HMI connection
+-- @tparam table list Array of messages
+function mt.__index:RaiseEvents(connection, list)
+  local now = timestamp()
+  local checked = false
+  for i = 1, #list do
+    local data = list[i]
+    if self.preEventHandler then
+      self.preEventHandler(data)
+    end
+    exp = self:FindHandler(connection, data)
+    if exp then
+      occur(self, exp, data)
+      validateDirty(self)
+    end
+    local deadline = self._deadlines:peek()
+    checked = not (self.pendingCheck and self.pendingCheck()) or (deadline ~= nil and deadline < now)
+    if checked then
+      self:validateAll()
+      if self.postEventHandler then
+        self.postEventHandler(data)
+      end
+    end
+  end
+  if not checked and #list > 0 then
+    self:validateAll()
+    if self.postEventHandler then
+      self.postEventHandler(list[#list])
+    end
+  end
+end
+
+--- Remove expectation from registered ones
+-- @tparam EventDispatcher self Event dispatcher
+-- @tparam Expectation e Expectation
+local function unregister(self, e)
+  if not e then return end
+  self._registered[e] = nil
+  self._dirty[e] = nil
+  e.dispatcher = nil
+  e.deadline = nil
+end
+
 --- Add event with expectation to pools
 -- @tparam Connection connection Mobile/HMI connection
 -- @tparam Event event Event to be addded
 -- @tparam Expectation expectation Expectation for added event
 function mt.__index:AddEvent(connection, event, expectation)
+  local pool
   if event.level == 3 then
-    self._pool3[connection][event] = expectation
+    pool = self._pool3[connection]
   elseif event.level == 2 then
-    self._pool2[connection][event] = expectation
+    pool = self._pool2[connection]
   elseif event.level == 1 then
-    self._pool1[connection][event] = expectation
+    pool = self._pool1[connection]
   end
+  if not pool then return end
+  if pool[event] ~= expectation then unregister(self, pool[event]) end
+  pool[event] = expectation
+  self._registered[expectation] = true
+  expectation.dispatcher = self
+  self:Invalidate(expectation)
 end
 
 --- Remove event with expectation from pools
 -- @tparam Connection connection Mobile/HMI connection
 -- @tparam Event event Event to be removed
 function mt.__index:RemoveEvent(connection, event)
+  unregister(self, self._pool3[connection][event])
+  unregister(self, self._pool2[connection][event])
+  unregister(self, self._pool1[connection][event])
   self._pool3[connection][event] = nil
   self._pool2[connection][event] = nil
   self._pool1[connection][event] = nil
@@ -188,6 +377,14 @@ function mt.__index:ClearEvents()
   for c, pool in pairs(self._pool3) do self._pool3[c] = { } end
   for c, pool in pairs(self._pool2) do self._pool2[c] = { } end
   for c, pool in pairs(self._pool1) do self._pool1[c] = { } end
+  for e in pairs(self._registered) do
+    e.dispatcher = nil
+    e.deadline = nil
+  end
+  self._registered = setmetatable({ }, { __mode = "k" })
+  self._dirty = { }
+  self._deadlines:clear()
+  self._armed = nil
 end
 
 return Dispatcher
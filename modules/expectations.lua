@@ -45,6 +45,7 @@ function Expectations.Expectation(name, connection)
     else
       error("Expectation:Times() must be called with number or Cardinality argument")
     end
+    if self.dispatcher then self.dispatcher:Invalidate(self) end
     return self
   end
 
@@ -90,6 +91,7 @@ function Expectations.Expectation(name, connection)
   -- @treturn Expectation Current expectation
   function mt.__index:Timeout(ms)
     self.timeout = ms
+    if self.dispatcher then self.dispatcher:Invalidate(self) end
     return self
   end
 
@@ -155,7 +157,9 @@ function Expectations.Expectation(name, connection)
     errorMessage = { }, -- If failed, error message to display
     actions = { }, -- Sequence of actions to be executed when complied
     pinned = false, -- True if the expectation is pinned
-    list = nil -- ExpectationsList the expectation belongs to
+    list = nil, -- ExpectationsList the expectation belongs to
+    dispatcher = nil, -- EventDispatcher the expectation is registered in
+    deadline = nil -- Deadline the expectation is scheduled for in EventDispatcher
   }
 
   setmetatable(e, mt)
@@ -185,16 +189,20 @@ function Expectations.ExpectationsList()
         self.pinned[i].index = i
       end
     else
-      table.remove(self.expectations)
-      for i = e.index, #self.expectations do
-        self.expectations[i].index = i
+      for i = #self.expectations, 1, -1 do
+        if self.expectations[i] == e then
+          table.remove(self.expectations, i)
+          break
+        end
       end
+      self.pending = 1
     end
   end
 
   --- Clear list of expectations
   function mt.__index:Clear()
     self.expectations = { }
+    self.pending = 1
   end
 
   --- Check whether list of expectations is empty
@@ -212,6 +220,19 @@ function Expectations.ExpectationsList()
     return false
   end
 
+  --- Check whether list of expectations contains expectation without status
+  --
+  -- Expectation never loses its status, so expectations before the first pending one
+  -- are skipped on subsequent checks
+  -- @treturn boolean True if any of expectations from list of expectations has no status yet
+  function mt.__index:HasPending()
+    local list = self.expectations
+    local i = self.pending
+    while list[i] and list[i].status do i = i + 1 end
+    self.pending = i
+    return list[i] ~= nil
+  end
+
   --- Create iterator for list of expectations
   -- @treturn function Iterator for list of expectations
   function mt.__index:List()
@@ -241,6 +262,7 @@ function Expectations.ExpectationsList()
       if self.expectations[i] == e then
         table.remove(self.expectations, i)
         table.insert(self.pinned, e)
+        self.pending = 1
         break
       end
     end
@@ -257,7 +279,7 @@ function Expectations.ExpectationsList()
       end
     end
   end
-  local res = { pinned = { }, expectations = { } }
+  local res = { pinned = { }, expectations = { }, pending = 1 }
   setmetatable(res, mt)
   return res
 end
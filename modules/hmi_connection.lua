@@ -1,6 +1,6 @@
 --- Module which provides interface for emulate connection with HMI for SDL
 --
--- *Dependencies:* `json`, `api_loader`
+-- *Dependencies:* `json`, `api_loader`, `latency_stats`
 --
 -- *Globals:* `data`, `xmlReporter`
 -- @module hmi_connection
@@ -9,6 +9,7 @@
 
 local json = require("json")
 local api_loader = require("modules/api_loader")
+local latency_stats = require("latency_stats")
 
 local HmiConnection = { mt = { __index = { } } }
 
@@ -29,6 +30,15 @@ end
 
 local resultCodes = getResultCodes()
 
+--- Match received response with sent request for latency statistics
+-- @tparam string name Connection name
+-- @tparam table data Received message
+local function noteResponse(name, data)
+  if type(data) == "table" and data.id and not data.method and (data.result or data.error) then
+    latency_stats.response(name, data.id)
+  end
+end
+
 --- Send message from HMI to SDL
 -- @tparam string text Message
 function HmiConnection.mt.__index:Send(text)
@@ -48,6 +58,7 @@ function HmiConnection.mt.__index:SendRequest(methodName, params)
   data.method = methodName
   data.params = params
   local text = json.encode(data)
+  if latency_stats.tracking then latency_stats.request(self.name, self.requestId, methodName) end
   self:Send(text)
   xmlReporter.AddMessage("hmi_connection",{["RequestId"] = tostring(self.requestId),["Type"] = "SendRequest"},{ ["methodName"] = methodName,["params"]=params } )
   return self.requestId
@@ -112,11 +123,25 @@ end
 --- Set handler for OnInputData
 -- @tparam function func Handler function
 function HmiConnection.mt.__index:OnInputData(func)
+  local name = self.name
   self.connection:OnInputData(function(_, data)
+      if latency_stats.tracking then noteResponse(name, data) end
       func(self, data)
     end)
 end
 
+--- Set handler for batches of messages
+-- @tparam function func Handler function with signature func(connection, messages)
+function HmiConnection.mt.__index:OnInputBatch(func)
+  local name = self.name
+  self.connection:OnInputBatch(function(_, messages)
+      if latency_stats.tracking then
+        for _, data in ipairs(messages) do noteResponse(name, data) end
+      end
+      func(self, messages)
+    end)
+end
+
 --- Set handler for OnConnected
 -- @tparam function func Handler function
 function HmiConnection.mt.__index:OnConnected(func)
@@ -141,6 +166,7 @@ function HmiConnection.Connection(connection)
   local res = { }
   res.connection = connection
   res.requestId = 0
+  res.name = connection.name or "hmi"
   setmetatable(res, HmiConnection.mt)
   return res
 end
@@ -0,0 +1,253 @@
+---- Request/response latency of SDL.
+--
+-- Connections note time of every sent mobile RPC request and HMI request by correlation
+-- (JSON-RPC) id and match responses by the same id. Latencies are collected into histograms
+-- per connection and per function name. Histograms are log-linear like HdrHistogram:
+-- values below 64 ms are exact, bigger ones fall into one of 32 buckets per power of two,
+-- so percentiles have relative error below 1/32 with fixed memory per histogram.
+-- Latency is measured by `timestamp()`, so resolution is 1 ms.
+--
+-- *Dependencies:* `json`
+--
+-- *Globals:* `config`, `xmlReporter`, `timestamp()`
+-- @module latency_stats
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local json = require("json")
+
+local LatencyStats = {}
+
+--- Flag which defines whether connections note requests and responses, set by testbase
+LatencyStats.tracking = false
+
+--- Number of sub-buckets per power of two
+local SUB_BUCKETS = 32
+--- Reported percentiles
+local PERCENTILES = { 50, 90, 99 }
+
+--- Requests waiting for response by connection names and ids
+local pending = {}
+--- Histograms of the whole run: by connection names, then `total` and by function names
+local histograms = {}
+--- Names of connections in order of the first request
+local connection_names = {}
+--- Histograms of current test step by connection names, nil out of step
+local step = nil
+--- Functions called for every matched response
+local listeners = {}
+
+--- Histogram of latencies
+-- @type Histogram
+
+--- Calculate bucket index of value
+-- @tparam number value Non-negative integer
+-- @treturn number Index
+local function bucketIndex(value)
+  if value < 2 * SUB_BUCKETS then return value end
+  local shift = math.floor(math.log(value, 2)) - 5
+  local sub = math.floor(value / 2 ^ shift)
+  -- correct rounding error of logarithm
+  if sub >= 2 * SUB_BUCKETS then
+    shift = shift + 1
+    sub = math.floor(value / 2 ^ shift)
+  elseif sub < SUB_BUCKETS then
+    shift = shift - 1
+    sub = math.floor(value / 2 ^ shift)
+  end
+  return shift * SUB_BUCKETS + sub
+end
+
+--- Calculate the highest value falling into bucket
+-- @tparam number index Bucket index
+-- @treturn number Value
+local function bucketValue(index)
+  if index < 2 * SUB_BUCKETS then return index end
+  local shift = math.floor(index / SUB_BUCKETS) - 1
+  local sub = index - shift * SUB_BUCKETS
+  return (sub + 1) * 2 ^ shift - 1
+end
+
+--- Construct empty histogram
+-- @treturn Histogram Constructed instance
+function LatencyStats.Histogram()
+  return { counts = {}, count = 0, sum = 0, max = 0 }
+end
+
+--- Add value to histogram
+-- @tparam Histogram h Histogram
+-- @tparam number value Latency in ms
+function LatencyStats.record(h, value)
+  value = math.max(math.floor(value + 0.5), 0)
+  local index = bucketIndex(value)
+  h.counts[index] = (h.counts[index] or 0) + 1
+  h.count = h.count + 1
+  h.sum = h.sum + value
+  if value > h.max then h.max = value end
+end
+
+--- Calculate percentile of histogram
+-- @tparam Histogram h Histogram
+-- @tparam number p Percentile, 0..100
+-- @treturn number Value, the highest value equivalent to bucket, nil for empty histogram
+function LatencyStats.percentile(h, p)
+  if h.count == 0 then return nil end
+  local indexes = {}
+  for index in pairs(h.counts) do table.insert(indexes, index) end
+  table.sort(indexes)
+  local target = math.max(math.ceil(h.count * p / 100), 1)
+  local seen = 0
+  for _, index in ipairs(indexes) do
+    seen = seen + h.counts[index]
+    if seen >= target then return math.min(bucketValue(index), h.max) end
+  end
+  return h.max
+end
+
+--- Summarize histogram
+-- @tparam Histogram h Histogram
+-- @treturn table Fields `count`, `p50`, `p90`, `p99`, `max` and `mean`
+function LatencyStats.summary(h)
+  local res = { count = h.count }
+  if h.count > 0 then
+    for _, p in ipairs(PERCENTILES) do
+      res["p" .. p] = LatencyStats.percentile(h, p)
+    end
+    res.max = h.max
+    res.mean = math.floor(h.sum / h.count * 1000 + 0.5) / 1000
+  end
+  return res
+end
+
+--- Module functions
+-- @section LatencyStats
+
+--- Note time of sent request
+-- @tparam string connection Connection name
+-- @param id Correlation id of request, unique for connection
+-- @tparam string func Function name
+function LatencyStats.request(connection, id, func)
+  local requests = pending[connection]
+  if not requests then
+    requests = {}
+    pending[connection] = requests
+    histograms[connection] = { total = LatencyStats.Histogram(), functions = {} }
+    table.insert(connection_names, connection)
+  end
+  requests[id] = { func = func, time = timestamp() }
+end
+
+--- Add function called for every matched response
+-- @tparam function func Function with signature func(connection, id, func_name, sent, received),
+-- `sent` and `received` are `timestamp()` values
+function LatencyStats.on_response(func)
+  table.insert(listeners, func)
+end
+
+--- Match response with request and record latency
+-- @tparam string connection Connection name
+-- @param id Correlation id of response
+-- @treturn number Latency in ms, nil if request is unknown
+function LatencyStats.response(connection, id)
+  local requests = pending[connection]
+  local request = requests and requests[id]
+  if not request then return nil end
+  requests[id] = nil
+  local now = timestamp()
+  local latency = now - request.time
+  local hist = histograms[connection]
+  local func = hist.functions[request.func]
+  if not func then
+    func = LatencyStats.Histogram()
+    hist.functions[request.func] = func
+  end
+  LatencyStats.record(func, latency)
+  LatencyStats.record(hist.total, latency)
+  if step then
+    if not step[connection] then step[connection] = LatencyStats.Histogram() end
+    LatencyStats.record(step[connection], latency)
+  end
+  for _, listener in ipairs(listeners) do
+    listener(connection, id, request.func, request.time, now)
+  end
+  return latency
+end
+
+--- Start collecting latencies of test step
+function LatencyStats.start()
+  step = {}
+end
+
+--- Summarize latencies of test step since `start`
+-- @treturn table Summaries by connection names
+function LatencyStats.finish()
+  if not step then return nil end
+  local res = {}
+  for name, h in pairs(step) do
+    res[name] = LatencyStats.summary(h)
+  end
+  step = nil
+  return res
+end
+
+--- Flatten summaries into attributes of test step in xml report
+-- @tparam table latencies Result of `finish`
+-- @tparam table attributes Attributes to be extended
+-- @treturn table Extended attributes
+function LatencyStats.attributes(latencies, attributes)
+  for name, summary in pairs(latencies) do
+    for k, v in pairs(summary) do
+      attributes["latency_" .. name .. "_" .. k] = v
+    end
+  end
+  return attributes
+end
+
+--- Summarize latencies of the whole run
+-- @treturn table Summaries by connection names, each has `functions` with summaries by
+-- function names and `unanswered` number of requests without response
+function LatencyStats.collect()
+  local res = {}
+  for _, name in ipairs(connection_names) do
+    local hist = histograms[name]
+    local summary = LatencyStats.summary(hist.total)
+    summary.unanswered = 0
+    for _ in pairs(pending[name]) do summary.unanswered = summary.unanswered + 1 end
+    summary.functions = {}
+    for func, h in pairs(hist.functions) do
+      summary.functions[func] = LatencyStats.summary(h)
+    end
+    res[name] = summary
+  end
+  return res
+end
+
+--- Write summaries of the whole run into xml report and JSON file
+--
+-- JSON file is `config.latencyStatsFile` or file next to xml report with `_latency.json` suffix
+function LatencyStats.report()
+  local connections = LatencyStats.collect()
+  xmlReporter.AddCase("LatencyStats")
+  for _, name in ipairs(connection_names) do
+    local summary = connections[name]
+    local funcs = {}
+    for func in pairs(summary.functions) do table.insert(funcs, func) end
+    table.sort(funcs)
+    for _, func in ipairs(funcs) do
+      local attributes = { Connection = name, FunctionName = func }
+      for k, v in pairs(summary.functions[func]) do attributes[k] = tostring(v) end
+      xmlReporter.AddMessage("Latency", attributes)
+    end
+  end
+  local path = config.latencyStatsFile
+  if not path or path == "" then
+    if config.excludeReport or type(xmlReporter.curr_report_name) ~= "string" then return end
+    path = xmlReporter.curr_report_name:gsub("%.xml$", "") .. "_latency.json"
+  end
+  local file = io.open(path, "w")
+  if not file then return end
+  file:write(json.encode({ script = xmlReporter.script_file_name, connections = connections }), "\n")
+  file:close()
+end
+
+return LatencyStats
@@ -23,13 +23,34 @@ declare_short_opt("-p", NoArgument, "Parallel script running mode")
 declare_long_opt("--storeFullSDLLogs", NoArgument, "Store Full SDL Logs enable")
 declare_long_opt("--heartbeat", RequiredArgument, "Hearbeat timeout value")
 declare_long_opt("--sdl-core", RequiredArgument, "Path to folder with SDL binary")
+declare_long_opt("--reuse-sdl", NoArgument, "Run scripts one by one in one process, keep SDL and its HMI connection between them")
+declare_long_opt("--memory-tags", NoArgument, "Count Lua allocations by ATF subsystems and print them on finish")
+declare_long_opt("--case-resources", NoArgument, "Account resources used by each test step")
+declare_long_opt("--lazy-messages", NoArgument, "Parse messages from SDL to native objects with lazy payload decoding")
+declare_long_opt("--binary-atf-logs", NoArgument, "Write ATF log in binary form, use tools/atf_logcat.lua to render it")
+declare_long_opt("--native-hmi-json", NoArgument, "Decode JSON of messages from SDL to HMI in native code")
+declare_long_opt("--network-thread", NoArgument, "Serve mobile connections by native I/O thread")
+declare_long_opt("--batch-delivery", NoArgument, "Dispatch messages received during event loop iteration as a batch")
+declare_long_opt("--virtual-time", NoArgument, "Fast-forward timeouts and delays while nothing happens")
+declare_long_opt("--connection-metrics", NoArgument, "Report traffic counters of connections for every test step")
+declare_long_opt("--connection-metrics-file", RequiredArgument, "File for periodic snapshots of connection counters")
+declare_long_opt("--latency-stats", NoArgument, "Report latency percentiles of SDL responses")
+declare_long_opt("--latency-stats-file", RequiredArgument, "File for JSON summary of response latencies")
 declare_long_opt("--report-mark", RequiredArgument, "Marker of testing report")
 
 local script_files = parse_cmdl()
 
 if (#script_files > 0) then
-  for _,scpt in ipairs(script_files) do
+  if config.reuseSDL then
+    -- testbase starts next script when previous one finishes
+    queue_scripts(script_files)
+    local scpt = next_queued_script()
     print_startscript(scpt)
     script_execute(scpt)
+  else
+    for _,scpt in ipairs(script_files) do
+      print_startscript(scpt)
+      script_execute(scpt)
+    end
   end
 end
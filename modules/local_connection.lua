@@ -0,0 +1,125 @@
+--- Module which provides transport level interface over local (Unix domain) socket
+--
+-- Interface is the same as of `tcp_connection`, so connection can be used by `mobile_connection`
+-- and other wrappers of transport. Socket is addressed by name (path to socket file) instead of host and port
+--
+-- *Dependencies:* `qt`, `network`
+--
+-- *Globals:* `xmlReporter`, `qt`, `network`
+-- @module local_connection
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local Local = { mt = { __index = {} } }
+
+--- Type which provides transport level interface over local socket
+-- @type Connection
+
+--- Construct instance of Connection type
+-- @tparam string name Name of local server (path to socket file)
+-- @tparam userdata socket Already connected socket (e.g. one of `network.socketpair()`), optional
+-- @treturn Connection Constructed instance
+function Local.Connection(name, socket)
+  local res =
+  {
+    name = name
+  }
+  res.socket = socket or network.LocalClient()
+  setmetatable(res, Local.mt)
+  res.qtproxy = qt.dynamic()
+
+  function res:inputData() end
+
+  function res.qtproxy.readyRead()
+    while true do
+      local data = res.socket:read(81920)
+      if data == '' then break end
+      res.qtproxy:inputData(data)
+    end
+  end
+  qt.connect(res.socket, "readyRead()", res.qtproxy, "readyRead()")
+
+  return res
+end
+
+--- Check 'self' argument
+local function checkSelfArg(s)
+  if type(s) ~= "table" or
+  getmetatable(s) ~= Local.mt then
+    error("Invalid argument 'self': must be connection (use ':', not '.')")
+  end
+end
+
+--- Connect to local server
+function Local.mt.__index:Connect()
+  xmlReporter.AddMessage("local_connection","Connect")
+  checkSelfArg(self)
+  if self.name then
+    self.socket:connect(self.name)
+  end
+end
+
+--- Send pack of messages
+-- @tparam table data Data to be sent
+function Local.mt.__index:Send(data)
+  checkSelfArg(self)
+  for _, c in ipairs(data) do
+    self.socket:write(c)
+  end
+end
+
+--- Set handler for OnInputData
+-- @tparam function func Handler function
+function Local.mt.__index:OnInputData(func)
+  checkSelfArg(self)
+  local d = qt.dynamic()
+  local this = self
+  function d:inputData(data)
+    func(this, data)
+  end
+  qt.connect(self.qtproxy, "inputData(QByteArray)", d, "inputData(QByteArray)")
+end
+
+--- Set handler for OnDataSent
+-- @tparam function func Handler function
+function Local.mt.__index:OnDataSent(func)
+  local d = qt.dynamic()
+  local this = self
+  function d:bytesWritten(num)
+    func(this, num)
+  end
+  qt.connect(self.socket, "bytesWritten(qint64)", d, "bytesWritten(qint64)")
+end
+
+--- Set handler for OnConnected
+-- @tparam function func Handler function
+function Local.mt.__index:OnConnected(func)
+  checkSelfArg(self)
+  if self.qtproxy.connected then
+    error("Local connection: connected signal is handled already")
+  end
+  local this = self
+  self.qtproxy.connected = function() func(this) end
+  qt.connect(self.socket, "connected()", self.qtproxy, "connected()")
+end
+
+--- Set handler for OnDisconnected
+-- @tparam function func Handler function
+function Local.mt.__index:OnDisconnected(func)
+  checkSelfArg(self)
+  if self.qtproxy.disconnected then
+    error("Local connection: disconnected signal is handled already")
+  end
+  local this = self
+  self.qtproxy.disconnected = function() func(this) end
+  qt.connect(self.socket, "disconnected()", self.qtproxy, "disconnected()")
+end
+
+--- Close connection
+function Local.mt.__index:Close()
+  xmlReporter.AddMessage("local_connection","Close")
+  checkSelfArg(self)
+  self.socket:close();
+end
+
+return Local
@@ -0,0 +1,62 @@
+---- Attribution of Lua allocations to ATF subsystems.
+--
+-- Wraps functions of protocol handler, JSON codec and reporter so allocations
+-- made inside them are counted against subsystem tag of native `memory` module.
+-- Counters are cumulative (bytes and number of allocations), nested calls are
+-- counted against the innermost tag.
+--
+-- *Dependencies:* `memory`, `json`, `protocol_handler.protocol_handler`, `reporter`
+--
+-- *Globals:* none
+-- @module memory_tags
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local memory = require("memory")
+
+local MemoryTags = {}
+
+local installed = false
+
+--- Replace every function of table by its version running under memory tag
+-- @tparam table tbl Table of functions
+-- @tparam string tag Memory tag
+function MemoryTags.wrap(tbl, tag)
+  for name, func in pairs(tbl) do
+    if type(func) == "function" then
+      tbl[name] = function(...)
+        return memory.tagged(tag, func, ...)
+      end
+    end
+  end
+end
+
+--- Tag allocations of protocol handler, JSON codec and reporter
+function MemoryTags.install()
+  if installed then return end
+  installed = true
+  MemoryTags.wrap(require("json"), "json")
+  local ph = require("protocol_handler/protocol_handler")
+  MemoryTags.wrap(getmetatable(ph.ProtocolHandler()).__index, "protocol_handler")
+  MemoryTags.wrap(require("reporter"), "reporter")
+end
+
+local function mb(bytes)
+  return bytes / (1024 * 1024)
+end
+
+--- Print heap statistics and allocations by tags
+function MemoryTags.print_summary()
+  local stats = memory.stats()
+  print(string.format("Lua heap: live %.1f MB, peak %.1f MB, %d allocations",
+      mb(stats.live_bytes), mb(stats.peak_bytes), stats.allocations))
+  local tags = memory.tags()
+  local names = {}
+  for name in pairs(tags) do table.insert(names, name) end
+  table.sort(names, function(a, b) return tags[a].bytes > tags[b].bytes end)
+  for _, name in ipairs(names) do
+    print(string.format("  %-20s %10.1f MB %12d allocations", name, mb(tags[name].bytes), tags[name].allocations))
+  end
+end
+
+return MemoryTags
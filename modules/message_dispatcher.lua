@@ -170,6 +170,10 @@ function MD.MessageDispatcher(connection)
   res.connection = connection
   res.bufferSize = 8192
   res.mapped = { }
+  -- Times message waited for bytesWritten credit and their total duration
+  res.blocked = 0
+  res.blocked_ms = 0
+  res.blocked_since = nil
   res.timer = timers.Timer()
   res.timer:setSingleShot(true)
   function res._d:timeout()
@@ -197,9 +201,17 @@ function MD.MessageDispatcher(connection)
       if msg and #msg > 0 then
         if res.bufferSize > #msg then
           res.bufferSize = res.bufferSize - #msg
+          if res.blocked_since then
+            res.blocked_ms = res.blocked_ms + timestamp() - res.blocked_since
+            res.blocked_since = nil
+          end
           res.connection:Send({ msg })
           break
         else
+          if not res.blocked_since then
+            res.blocked_since = timestamp()
+            res.blocked = res.blocked + 1
+          end
           res.generators[res.idx]:KeepMessage(msg)
         end
       elseif timeout then
@@ -247,6 +259,14 @@ function MD.mt.__index:UnmapFile(filebuffer)
   end
 end
 
+--- Get counters of waiting for bytesWritten credit
+-- @treturn table Counters: `credit_blocked` (times message waited), `credit_blocked_ms` (total wait time)
+function MD.mt.__index:Stats()
+  local blocked_ms = self.blocked_ms
+  if self.blocked_since then blocked_ms = blocked_ms + timestamp() - self.blocked_since end
+  return { credit_blocked = self.blocked, credit_blocked_ms = blocked_ms }
+end
+
 --- Send pack of messages
 function MD.mt.__index:Pulse()
   self._d:bytesWritten(0)
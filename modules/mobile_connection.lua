@@ -1,6 +1,7 @@
 --- Module which provides interface for emulate connection with mobile for SDL
 --
--- *Dependencies:* `file_connection`, `protocol_handler.protocol_handler`
+-- *Dependencies:* `file_connection`, `protocol_handler.protocol_handler`, `case_resources`,
+-- `connection_metrics`, `latency_stats`, `function_id`, `services.heartbeat_monitor`
 --
 -- *Globals:* `res`, `atf_logger`, `xmlReporter`
 -- @module mobile_connection
@@ -9,11 +10,38 @@
 
 local ph = require('protocol_handler/protocol_handler')
 local file_connection = require("file_connection")
+local case_resources = require("case_resources")
+local connection_metrics = require("connection_metrics")
+local latency_stats = require("latency_stats")
+local heartbeat_monitor = require("services/heartbeat_monitor")
 
 local MobileConnection = {
   mt = { __index = {} }
 }
 
+--- Mobile function names by ids, built on first use
+local function_names = nil
+
+--- Find mobile function name by id
+-- @tparam number id Function id
+-- @treturn string Function name
+local function functionName(id)
+  if not function_names then
+    function_names = { }
+    for name, fid in pairs(require("function_id")) do function_names[fid] = name end
+  end
+  return function_names[id] or tostring(id)
+end
+
+--- Match received response with sent request for latency statistics
+-- @tparam string name Connection name
+-- @tparam table msg Received message
+local function noteResponse(name, msg)
+  if msg.rpcType == 1 and msg.rpcCorrelationId then
+    latency_stats.response(name, msg.sessionId .. ":" .. msg.rpcCorrelationId)
+  end
+end
+
 --- Type which provides interface for emulate connection with mobile for SDL
 -- @type MobileConnection
 
@@ -23,7 +51,17 @@ local MobileConnection = {
 function MobileConnection.MobileConnection(connection)
   res = { }
   res.connection = connection
+  local name = case_resources.unique_name("mobile")
+  res.name = name
+  res.counters = case_resources.connection(name)
+  -- Socket and message dispatcher belong to FileConnection over TCP connection
+  local transport = connection.connection
+  if transport and transport.socket then
+    local fmapper = connection.fmapper
+    connection_metrics.register(name, transport.socket, fmapper and function() return fmapper:Stats() end)
+  end
   setmetatable(res, MobileConnection.mt)
+  heartbeat_monitor.Attach(res)
   return res
 end
 
@@ -37,13 +75,19 @@ end
 function MobileConnection.mt.__index:Send(data)
   local messages = { }
   local protocol_handler = ph.ProtocolHandler()
+  local counters = self.counters
   for _, msg in ipairs(data) do
     atf_logger.LOG("MOBtoSDL", msg)
+    if latency_stats.tracking and msg.rpcType == 0 and msg.rpcCorrelationId then
+      latency_stats.request(self.name, msg.sessionId .. ":" .. msg.rpcCorrelationId, functionName(msg.rpcFunctionId))
+    end
     local msgs = protocol_handler:Compose(msg)
     for _, m in ipairs(msgs) do
       table.insert(messages, m)
+      counters.bytes_sent = counters.bytes_sent + #m
     end
   end
+  counters.messages_sent = counters.messages_sent + #data
   self.connection:Send(messages)
 end
 
@@ -73,18 +117,45 @@ end
 function MobileConnection.mt.__index:OnInputData(func)
   local this = self
   local protocol_handler = ph.ProtocolHandler()
+  local counters = self.counters
+  local name = self.name
   local f =
   function(self, binary)
     local msg = protocol_handler:Parse(binary)
+    counters.bytes_received = counters.bytes_received + #binary
+    counters.messages_received = counters.messages_received + #msg
     for _, v in ipairs(msg) do
       -- After refactoring should be moved in mobile session
       atf_logger.LOG("SDLtoMOB", v)
+      if latency_stats.tracking then noteResponse(name, v) end
       func(this, v)
     end
   end
   self.connection:OnInputData(f)
 end
 
+--- Set handler for batches of messages
+--
+-- Handler is called once per received data with array of all messages parsed from it
+-- @tparam function func Handler function with signature func(connection, messages)
+function MobileConnection.mt.__index:OnInputBatch(func)
+  local this = self
+  local protocol_handler = ph.ProtocolHandler()
+  local counters = self.counters
+  local name = self.name
+  self.connection:OnInputData(function(_, binary)
+      local msg = protocol_handler:Parse(binary)
+      counters.bytes_received = counters.bytes_received + #binary
+      counters.messages_received = counters.messages_received + #msg
+      if #msg == 0 then return end
+      for _, v in ipairs(msg) do
+        atf_logger.LOG("SDLtoMOB", v)
+        if latency_stats.tracking then noteResponse(name, v) end
+      end
+      func(this, msg)
+    end)
+end
+
 --- Set handler for OnDataSent
 -- @tparam function func Handler function
 function MobileConnection.mt.__index:OnDataSent(func)
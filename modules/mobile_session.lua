@@ -146,6 +146,29 @@ function mt.__index:Stop()
   self.mobile_session_impl:Stop()
 end
 
+local methods = mt.__index
+local heartbeat_flags = {
+  sendHeartbeatToSDL = true,
+  answerHeartbeatFromSDL = true,
+  ignoreSDLHeartBeatACK = true
+}
+
+--- Heartbeat flags are not stored in session table, so assignment of flag by script
+-- goes through `__newindex` and is passed to native heartbeat service at once
+function mt.__index(self, key)
+  if heartbeat_flags[key] then return self.heartbeatFlags[key] end
+  return methods[key]
+end
+
+function mt.__newindex(self, key, value)
+  if heartbeat_flags[key] then
+    self.heartbeatFlags[key] = value
+    self.mobile_session_impl.heartbeat_monitor:SyncNativeFlags()
+    return
+  end
+  rawset(self, key, value)
+end
+
 --- Construct instance of MobileSession type
 -- @tparam Test test Test which open mobile session
 -- @tparam MobileConnection connection Base connection for open mobile session
@@ -173,29 +196,33 @@ function MS.MobileSession(test, connection, regAppParams)
   function res.CorrelationId.get()
     return  res.correlationId
   end
-  --- Flag which defines whether mobile session sends heartbeat to SDL
-  res.sendHeartbeatToSDL = true
-  --- Flag which defines whether mobile session answers on heartbeat from SDL
-  res.answerHeartbeatFromSDL = true
-  --- Flag which defines whether mobile session ignore ACK of heartbeat from SDL
-  res.ignoreSDLHeartBeatACK = false
+  --- Heartbeat flags, accessed as `sendHeartbeatToSDL`, `answerHeartbeatFromSDL`
+  -- and `ignoreSDLHeartBeatACK` fields of session
+  res.heartbeatFlags = {
+    --- Flag which defines whether mobile session sends heartbeat to SDL
+    sendHeartbeatToSDL = true,
+    --- Flag which defines whether mobile session answers on heartbeat from SDL
+    answerHeartbeatFromSDL = true,
+    --- Flag which defines whether mobile session ignore ACK of heartbeat from SDL
+    ignoreSDLHeartBeatACK = false
+  }
 
 --- Property which defines whether mobile session sends heartbeat to SDL
   res.SendHeartbeatToSDL = {}
   function res.SendHeartbeatToSDL.get()
-    return res.sendHeartbeatToSDL
+    return res.heartbeatFlags.sendHeartbeatToSDL
   end
 
   --- Property which defines whether mobile session answers on heartbeat from SDL
   res.AnswerHeartbeatFromSDL = {}
   function res.AnswerHeartbeatFromSDL.get()
-    return res.answerHeartbeatFromSDL
+    return res.heartbeatFlags.answerHeartbeatFromSDL
   end
 
   --- Property which defines whether mobile session ignore ACK of heartbeat from SDL
   res.IgnoreSDLHeartBeatAck = {}
   function res.IgnoreSDLHeartBeatAck.get()
-    return res.ignoreSDLHeartBeatACK
+    return res.heartbeatFlags.ignoreSDLHeartBeatACK
   end
 
   res.mobile_session_impl = mobile_session_impl.MobileSessionImpl(
@@ -117,17 +117,17 @@ end
 -- @treturn Expectation Expectation for StartService ACK
 function mt.__index:StartRPC()
   local ret = self:StartService(7)
-  ret:Do(function()
-      -- Heartbeat
-      if self.version > 2 then
-        self.heartbeat_monitor:StartHeartbeat()
-      end
-    end)
   ret:Do(function(s, data)
       if s.status == FAILED then return end
       self.sessionId.set(data.sessionId)
       self.hashCode = data.binaryData
     end)
+  ret:Do(function()
+      -- Heartbeat is started when session identifier is already known
+      if self.version > 2 then
+        self.heartbeat_monitor:StartHeartbeat()
+      end
+    end)
   return ret
 end
 
@@ -0,0 +1,252 @@
+---- Breakdown of mobile RPC time by SDL performance log.
+--
+-- Native client (`network.PerfLogClient`) reads timing records of SDL from
+-- `config.perflogConnection`:`config.perflogConnectionPort`: time when SDL received mobile request,
+-- sent HMI request, received HMI response and sent mobile response. Records are matched with
+-- requests and responses seen by ATF (`latency_stats`) by session and correlation id.
+--
+-- SDL time is aligned on ATF clock like in NTP: every RPC bounds the offset between clocks by
+-- time of request and response seen by both sides, offset is taken from the RPC with the least
+-- transport delay and is limited by arrival time of records. So RPC time is split into transport
+-- to SDL, SDL processing, HMI round trip (from the first HMI request to the last HMI response)
+-- and transport back to ATF.
+--
+-- Records are taken from native client by timer, so its queue doesn't overflow during long test
+-- steps. RPC belongs to the step in which ATF received its response: it is summed into that step
+-- if its records arrive before the step finishes, otherwise it is only added to xml report later.
+--
+-- *Dependencies:* `latency_stats`
+--
+-- *Globals:* `network`, `xmlReporter`, `qt`, `timers`
+-- @module perflog
+-- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
+-- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
+
+local latency_stats = require("latency_stats")
+
+local Perflog = {}
+
+--- Time (ms) RPC waits for records of SDL before it is dropped as unmatched
+local MATCH_TIMEOUT = 10000
+--- Interval (ms) of taking records from native client
+local DRAIN_INTERVAL = 100
+
+--- Native client, nil if not connected
+local client = nil
+--- Timer which takes records from native client, created on connection
+local drain = nil
+--- Flag which defines whether responses seen by ATF are received from `latency_stats`
+local listening = false
+--- RPCs being matched by "session:correlation_id" keys
+local rpcs = {}
+--- Offset of SDL clock: ATF time = SDL time + offset, nil until the first complete RPC
+local clock = { offset = nil, delay = math.huge, bound = math.huge }
+--- Breakdown accumulated during test step
+local step = nil
+
+--- Round value to 3 decimals
+-- @tparam number v Value
+-- @treturn number Rounded value
+local function round(v)
+  return math.floor(v * 1000 + 0.5) / 1000
+end
+
+--- Find RPC by key, create it on the first use
+-- @tparam string key Session and correlation id
+-- @treturn table RPC
+local function entry(key)
+  local rpc = rpcs[key]
+  if not rpc then
+    rpc = {}
+    rpcs[key] = rpc
+  end
+  return rpc
+end
+
+--- Store response of SDL seen by ATF, listener of `latency_stats`
+-- @tparam string connection Connection name
+-- @param id Correlation id, "session:correlation_id" string for mobile RPCs
+-- @tparam string func Function name
+-- @tparam number sent Time of request
+-- @tparam number received Time of response
+function Perflog.response(connection, id, func, sent, received)
+  if type(id) ~= "string" then return end
+  local rpc = entry(id)
+  rpc.func, rpc.sent, rpc.received = func, sent, received
+  rpc.step, rpc.step_name = step, step and step.name
+end
+
+--- Store record of SDL performance log
+-- @tparam table record Record returned by `read_all` of native client
+function Perflog.record(record)
+  local rpc = entry(record.session .. ":" .. record.correlation_id)
+  local t = record.sdl_time
+  if record.point == "mob_in" then rpc.mob_in = t
+  elseif record.point == "mob_out" then rpc.mob_out = t
+  elseif record.point == "hmi_out" then rpc.hmi_out = math.min(rpc.hmi_out or t, t)
+  elseif record.point == "hmi_in" then rpc.hmi_in = math.max(rpc.hmi_in or t, t)
+  end
+  if not rpc.first_seen then rpc.first_seen = record.received end
+  -- record can't be received before SDL wrote it
+  clock.bound = math.min(clock.bound, record.received - t)
+end
+
+--- Split time of complete RPC
+-- @tparam table rpc RPC
+-- @treturn table Breakdown in ms
+local function breakdown(rpc)
+  local offset = math.min(clock.offset, clock.bound)
+  local residence = rpc.mob_out - rpc.mob_in
+  local hmi = (rpc.hmi_out and rpc.hmi_in) and math.max(rpc.hmi_in - rpc.hmi_out, 0) or 0
+  return {
+    total = round(rpc.received - rpc.sent),
+    transport_in = round(rpc.mob_in + offset - rpc.sent),
+    sdl = round(residence - hmi),
+    hmi = round(hmi),
+    transport_out = round(rpc.received - rpc.mob_out - offset)
+  }
+end
+
+--- Take records received by native client
+local function take_records()
+  if client then
+    for _, record in ipairs(client:read_all()) do Perflog.record(record) end
+  end
+end
+
+--- Take records received from SDL and split time of RPCs having all of them
+--
+-- Only RPCs answered during current step are summed into it
+-- @treturn table Array of breakdowns with `name`, `key` and `step` fields
+function Perflog.process()
+  take_records()
+  local complete = {}
+  for key, rpc in pairs(rpcs) do
+    if rpc.sent and rpc.mob_in and rpc.mob_out then
+      -- transport delay of the sample bounds error of its offset
+      local delay = (rpc.received - rpc.sent) - (rpc.mob_out - rpc.mob_in)
+      if delay < clock.delay then
+        clock.delay = delay
+        clock.offset = ((rpc.sent - rpc.mob_in) + (rpc.received - rpc.mob_out)) / 2
+      end
+      complete[key] = rpc
+    end
+  end
+  local res = {}
+  local now = timestamp()
+  for key, rpc in pairs(rpcs) do
+    if complete[key] then
+      local b = breakdown(rpc)
+      b.name, b.key, b.step = rpc.func, key, rpc.step_name
+      b.current = step ~= nil and rpc.step == step
+      table.insert(res, b)
+      rpcs[key] = nil
+    elseif now - (rpc.received or rpc.first_seen) > MATCH_TIMEOUT then
+      rpcs[key] = nil
+      if step and rpc.received then step.unmatched = step.unmatched + 1 end
+    end
+  end
+  table.sort(res, function(a, b) return a.key < b.key end)
+  if step then
+    for _, b in ipairs(res) do
+      if b.current then
+        step.rpcs = step.rpcs + 1
+        for _, k in ipairs({ "transport_in", "sdl", "hmi", "transport_out" }) do
+          step[k] = step[k] + b[k]
+        end
+      end
+    end
+  end
+  return res
+end
+
+--- Add breakdowns of RPCs to xml report
+-- @tparam table res Result of `process`
+local function report(res)
+  for _, b in ipairs(res) do
+    xmlReporter.AddMessage("PerfLog", { ["FunctionName"] = tostring(b.name), ["Id"] = b.key,
+      ["Step"] = tostring(b.step), ["total"] = tostring(b.total), ["transport_in"] = tostring(b.transport_in),
+      ["sdl"] = tostring(b.sdl), ["hmi"] = tostring(b.hmi), ["transport_out"] = tostring(b.transport_out) })
+  end
+end
+
+--- Module functions
+-- @section Perflog
+
+--- Connect to SDL performance log
+-- @tparam string host Host
+-- @tparam number port Port
+-- @treturn boolean True if connected
+function Perflog.connect(host, port)
+  client = port and network.PerfLogClient()
+  if not client or not client:connect(host, port) then
+    print("perflog: connection to " .. host .. ":" .. tostring(port) .. " is not established")
+    client = nil
+    return false
+  end
+  latency_stats.tracking = true
+  if not drain then
+    drain = { timer = timers.Timer(), proxy = qt.dynamic() }
+    function drain.proxy.timeout() take_records() end
+    qt.connect(drain.timer, "timeout()", drain.proxy, "timeout()")
+  end
+  drain.timer:start(DRAIN_INTERVAL)
+  if not listening then
+    latency_stats.on_response(Perflog.response)
+    listening = true
+  end
+  return true
+end
+
+--- Check whether client is connected
+-- @treturn boolean True if connected
+function Perflog.connected()
+  return client ~= nil
+end
+
+--- Start accumulating breakdown of test step
+-- @tparam string name Name of test step
+function Perflog.start(name)
+  step = { name = name, rpcs = 0, transport_in = 0, sdl = 0, hmi = 0, transport_out = 0, unmatched = 0 }
+end
+
+--- Split RPCs matched during test step and add them to xml report
+-- @treturn table Sums of breakdowns of step in ms with number of `rpcs`, `unmatched` RPCs,
+-- `pending` RPCs of step still waiting for records and `clock_offset`
+function Perflog.finish()
+  if not step then return nil end
+  report(Perflog.process())
+  local res = step
+  res.pending = 0
+  for _, rpc in pairs(rpcs) do
+    if rpc.step == step then res.pending = res.pending + 1 end
+  end
+  res.name = nil
+  for _, k in ipairs({ "transport_in", "sdl", "hmi", "transport_out" }) do res[k] = round(res[k]) end
+  if clock.offset then res.clock_offset = round(math.min(clock.offset, clock.bound)) end
+  step = nil
+  return res
+end
+
+--- Flatten breakdown into attributes of test step in xml report
+-- @tparam table res Result of `finish`
+-- @tparam table attributes Attributes to be extended
+-- @treturn table Extended attributes
+function Perflog.attributes(res, attributes)
+  for k, v in pairs(res) do
+    attributes["perflog_" .. k] = v
+  end
+  return attributes
+end
+
+--- Close connection to SDL performance log, RPCs whose records are already received are
+-- added to xml report
+function Perflog.close()
+  if not client then return end
+  drain.timer:stop()
+  client:close()
+  report(Perflog.process())
+  client = nil
+end
+
+return Perflog
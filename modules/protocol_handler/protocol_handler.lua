@@ -2,7 +2,7 @@
 --
 -- *Dependencies:* `json`, `protocol_handler.ford_protocol_constants`, `bit32`
 --
--- *Globals:* `bit32`, ret
+-- *Globals:* `bit32`, ret, `config`, `ford_protocol`
 -- @module protocol_handler.protocol_handler
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -95,13 +95,61 @@ local function create_ford_header(version, encryption, frameType, serviceType, f
   return res
 end
 
+if ford_protocol and ford_protocol.set_decoder then
+  -- Field of json module is looked up on each call, so wrappers of json.decode are respected
+  ford_protocol.set_decoder(function(text) return json.decode(text) end)
+end
+
+--- Parse complete frames of buffer to native message objects (see `config.lazyMessages`)
+--
+-- Messages are userdata which read header fields from frame bytes on access,
+-- JSON payload is decoded on the first access to `payload`
+-- @tparam ProtocolHandler self Protocol handler
+-- @tparam table res Table for parsed messages
+-- @tparam boolean validateJson True if JSON validation is required
+local function parseLazy(self, res, validateJson)
+  local buffer = self.buffer
+  local length = #buffer
+  local pos = 1
+  while length - pos + 1 >= 12 do
+    local size = bytesToInt32(buffer, pos + 4)
+    if length - pos + 1 < size + 12 then break end
+    local frameType = bit32.band(string.byte(buffer, pos), 0x07)
+    if size == 0 or frameType == constants.FRAME_TYPE.CONTROL_FRAME
+      or frameType == constants.FRAME_TYPE.SINGLE_FRAME then
+      table.insert(res, ford_protocol.message(buffer, pos, nil, not validateJson))
+    else
+      local messageId = bytesToInt32(buffer, pos + 8)
+      local data = string.sub(buffer, pos + 12, pos + size + 11)
+      if frameType == constants.FRAME_TYPE.FIRST_FRAME then
+        self.frames[messageId] = ""
+      elseif string.byte(buffer, pos + 2) == constants.FRAME_INFO.LAST_FRAME then
+        table.insert(res, ford_protocol.message(buffer, pos, self.frames[messageId] .. data, not validateJson))
+        self.frames[messageId] = nil
+      else
+        self.frames[messageId] = self.frames[messageId] .. data
+      end
+    end
+    pos = pos + size + 12
+  end
+  self.buffer = string.sub(buffer, pos)
+end
+
 --- Parse binary message from SDL to table with json validation
+--
+-- RPC message has `rawPayload` field with JSON text of payload.
+-- With `config.lazyMessages` messages are native objects with the same fields,
+-- uses native `ford_protocol.message`
 -- @tparam string binary Message
 -- @tparam boolean validateJson True if JSON validation is required
 -- @treturn table Parsed message
 function mt.__index:Parse(binary, validateJson)
   self.buffer = self.buffer .. binary
   local res = { }
+  if config and config.lazyMessages and ford_protocol and ford_protocol.message then
+    parseLazy(self, res, validateJson)
+    return res
+  end
   while #self.buffer >= 12 do
     local msg = {}
     local c1 = string.byte(self.buffer, 1)
@@ -132,8 +180,10 @@ function mt.__index:Parse(binary, validateJson)
           msg.rpcCorrelationId = bytesToInt32(msg.binaryData, 5)
           msg.rpcJsonSize = bytesToInt32(msg.binaryData, 9)
           if msg.rpcJsonSize > 0 then
+            -- JSON text is kept, so ATF log doesn't encode decoded payload again
+            msg.rawPayload = string.sub(msg.binaryData, 13, msg.rpcJsonSize + 12)
             if not validateJson then
-              msg.payload = json.decode(string.sub(msg.binaryData, 13, msg.rpcJsonSize + 12))
+              msg.payload = json.decode(msg.rawPayload)
             end
           end
           if msg.size > msg.rpcJsonSize + 12 then
@@ -153,11 +203,27 @@ function mt.__index:Parse(binary, validateJson)
   return res
 end
 
+--- Get maximal payload size of single frame
+-- @tparam number version Version number of the ford protocol
+-- @treturn number Maximal payload size in bytes
+local function maxPayloadSize(version)
+  local sizes = config and config.maxProtocolPayloadSize
+  if type(sizes) == "table" then
+    return sizes[version] or 1488
+  end
+  return sizes or 1488
+end
+
 --- Compose table with binary message and header for SDL
+--
+-- Uses native `ford_protocol.compose` if it is available
 -- @tparam table message Table representation of message
 -- @treturn table Table with binary message and header
 function mt.__index:Compose(message)
-  local kMax_protocol_payload_size = 1488
+  local kMax_protocol_payload_size = maxPayloadSize(message.version)
+  if ford_protocol then
+    return ford_protocol.compose(message, kMax_protocol_payload_size)
+  end
   local kFirstframe_frameType = 0x02
   local kFirstframe_frameInfo = 0
   local kFirstframe_dataSize = 0x08
@@ -190,10 +256,8 @@ function mt.__index:Compose(message)
 
   if payload and #payload > kMax_protocol_payload_size then
     is_multi_frame = true
-    while #payload > 0 do
-      local payload_part = string.sub(payload, 1, kMax_protocol_payload_size)
-      payload = string.sub(payload, kMax_protocol_payload_size + 1)
-      table.insert(multiframe_payloads, payload_part)
+    for first = 1, #payload, kMax_protocol_payload_size do
+      table.insert(multiframe_payloads, string.sub(payload, first, first + kMax_protocol_payload_size - 1))
     end
   end
 
@@ -17,10 +17,16 @@ local io = require('atf.stdlib.std.io')
 -- @tfield userdata ndoc XML builder
 -- @tfield userdata root Root node of XML report
 -- @tfield string curr_report_name Current report name
+-- @tfield boolean streaming Whether report is written by streaming XML writer (`config.reportStreaming`)
+-- @tfield userdata writer Streaming XML writer, nil after report is finalized
+-- @tfield boolean case_open Whether element of current test step is open in streaming XML writer
 local Reporter = {
   timestamp = '',
   script_file_name = '',
   ndoc = {},
+  streaming = false,
+  writer = nil,
+  case_open = false,
   curr_node = {},
   root = {},
   curr_report_name = {},
@@ -58,10 +64,38 @@ local function dump(o)
   return tostring(o)
 end
 
+--- Write message element into streaming report
+-- @tparam string name Test step name
+-- @tparam string|table funcName RPC name or table
+-- @tparam ? attrib RPC Data
+local function stream_message(name, funcName, attrib)
+  local w = Reporter.writer
+  w:startElement(name)
+  if (type(funcName) ~= 'table') then
+    w:attr('FunctionName', tostring(funcName))
+  else
+    for an, av in pairs(funcName) do
+      w:attr(an, tostring(av))
+    end
+  end
+  if (type(attrib) == 'table') then
+    w:text(dump(attrib))
+  elseif(attrib ~= nil) then
+    w:text(tostring(attrib))
+  end
+  w:endElement()
+end
+
 --- Add test step to report
 -- @tparam string name Test step name
 function Reporter.AddCase(name)
-  if(not config.excludeReport) then
+  if Reporter.streaming then
+    if not Reporter.writer then return end
+    if Reporter.case_open then Reporter.writer:endElement() end
+    Reporter.writer:startElement(name)
+    Reporter.case_open = true
+    Reporter.writer:flush()
+  elseif(not config.excludeReport) then
     Reporter.curr_node = Reporter.root:addChild(name)
     Reporter.ndoc:write(Reporter.curr_report_name)
   end
@@ -72,7 +106,9 @@ end
 -- @tparam string|table funcName RPC name or table
 -- @tparam table ... RPC Data
 function Reporter.AddMessage(name,funcName,...)
-  if(not config.excludeReport) then
+  if Reporter.streaming then
+    if Reporter.writer then stream_message(name, funcName, table.pack(...)[1]) end
+  elseif(not config.excludeReport) then
     local attrib = table.pack(...)[1]
     local msg = Reporter.curr_node:addChild(name)
 
@@ -93,23 +129,40 @@ function Reporter.AddMessage(name,funcName,...)
 end
 
 --- Add test step related message to report
+--
+-- In streaming mode test step element already has children at this point,
+-- so data is written as attributes of `CaseResult` child element
 -- @tparam string name Test step name
 -- @tparam table ... Data
 function Reporter.CaseMessageTotal(name, ... )
+  if Reporter.streaming and not Reporter.writer then return end
   if(not config.excludeReport) then
     local attrib = table.pack(...)[1]
+    if Reporter.streaming then Reporter.writer:startElement("CaseResult") end
     for attr_n,attr_v in pairs(attrib) do
       if (type(attr_v) == 'table') then attr_v = table.concat(attr_v, ';')
       elseif (type(attr_v) ~= 'string') then attr_v = tostring(attr_v)
       end
-      Reporter.curr_node:attr(attr_n, attr_v)
+      if Reporter.streaming then
+        Reporter.writer:attr(attr_n, attr_v)
+      else
+        Reporter.curr_node:attr(attr_n, attr_v)
+      end
+    end
+    if Reporter.streaming then
+      Reporter.writer:endElement()
+      Reporter.writer:flush()
     end
   end
 end
 
 --- Finalize report
 function Reporter.finalize()
-  if(not config.excludeReport) then
+  if Reporter.streaming then
+    if Reporter.writer then Reporter.writer:close() end
+    Reporter.writer = nil
+    Reporter.case_open = false
+  elseif(not config.excludeReport) then
     Reporter.ndoc:write(Reporter.curr_report_name)
   end
 end
@@ -147,8 +200,21 @@ function Reporter.init(script_file_name)
     report_header_name = script_file_name:gsub('.lua', '') .. '_' .. Reporter.timestamp
   end
   os.execute('mkdir -p "'.. curr_report_path .. '"')
-  Reporter.ndoc = xml.new()
   local alias = report_header_name:gsub('%.', '_'):gsub('/','_')
+  if config.reportStreaming then
+    if Reporter.writer then Reporter.writer:close() end
+    local err
+    Reporter.writer, err = xml.writer(Reporter.curr_report_name)
+    if Reporter.writer then
+      Reporter.writer:startElement(alias)
+      Reporter.streaming = true
+      Reporter.case_open = false
+      return Reporter
+    end
+    print("reporter: " .. tostring(err) .. ", xml report is kept in memory")
+  end
+  Reporter.streaming = false
+  Reporter.ndoc = xml.new()
   Reporter.root = Reporter.ndoc:createRootNode(alias)
   return Reporter
 end
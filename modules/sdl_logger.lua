@@ -2,7 +2,7 @@
 --
 -- *Dependencies:* `config`, `atf.stdlib.std.io`
 --
--- *Globals:* `network`, `qt`
+-- *Globals:* `network`, `qt`, `xmlReporter`
 -- @module sdl_logger
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -17,6 +17,7 @@ local io = require('atf.stdlib.std.io')
 -- @tfield string script_file_name Name of current script
 -- @tfield string sdl_log_file Name of normal SDL log file
 -- @tfield number timestamp Current date + time (timestamp)
+-- @tfield userdata sink Native log sink (if `config.sdlLogsNativeSink` is enabled)
 local SdlLogger = {
   is_open = true,
   full_sdlLog_name = '',
@@ -73,17 +74,24 @@ local function init(host,port)
     host = host,
     port = port
   }
-  SdlLogger.socket = network.TcpClient()
-  if not SdlLogger.socket then
-    print("TcpClient returns nothing")
-    return nil
-  end
   SdlLogger.sdl_log_file = io.open(SdlLogger.full_sdlLog_name,"r")
   if SdlLogger.sdl_log_file ~= nil then
     io.close(SdlLogger.sdl_log_file)
     print("sdl_logger: file already created")
   end
   SdlLogger.sdl_log_file = io.open(SdlLogger.full_sdlLog_name,"w+")
+  if config.sdlLogsNativeSink and network.LogSink then
+    -- Native sink writes into the file itself
+    SdlLogger.sdl_log_file:close()
+    SdlLogger.sdl_log_file = nil
+    SdlLogger.sink = network.LogSink()
+  else
+    SdlLogger.socket = network.TcpClient()
+    if not SdlLogger.socket then
+      print("TcpClient returns nothing")
+      return nil
+    end
+  end
   res.qtproxy = qt.dynamic()
   setmetatable(res, SdlLogger.mt)
   return res
@@ -98,6 +106,20 @@ function SdlLogger.init_log(script_name)
   SdlLogger.Connect(init(config.sdl_logs_host, config.sdl_logs_port))
 end
 
+--- Continue SDL log of reused SDL in a file of the next script, connection to SDL is kept
+-- @tparam string script_name Test script name
+function SdlLogger.reopen_log(script_name)
+  SdlLogger.script_file_name = script_name
+  local timestamp = tostring(os.date('%Y%m%d%H%M%S', os.time()))
+  SdlLogger.full_sdlLog_name = get_log_file_name(timestamp, "SDLLogs")..".log"
+  if SdlLogger.sink then
+    SdlLogger.sink:reopen(SdlLogger.full_sdlLog_name)
+  elseif SdlLogger.sdl_log_file then
+    SdlLogger.sdl_log_file:close()
+    SdlLogger.sdl_log_file = io.open(SdlLogger.full_sdlLog_name, "w+")
+  end
+end
+
 --- Write data received from SDL into SDL log
 function SdlLogger.dataReady()
   local data = SdlLogger.socket:read_all()
@@ -106,13 +128,31 @@ end
 
 --- Connect SDL logger to SDL
 function SdlLogger.Connect(self)
+  if SdlLogger.sink then
+    if SdlLogger.sink:connect(self.host, self.port) then
+      SdlLogger.sink:start(SdlLogger.full_sdlLog_name)
+    end
+    return
+  end
   self.qtproxy.dataReady = function() SdlLogger.dataReady() end
   qt.connect(SdlLogger.socket, "readyRead()", self.qtproxy, "dataReady()")
   SdlLogger.socket:connect(self.host, self.port)
 end
 
+--- Get number of bytes captured by native sink
+-- @treturn number Number of bytes written into SDL log or nil if native sink is not used
+function SdlLogger.bytes()
+  if SdlLogger.sink then return SdlLogger.sink:bytes() end
+  return nil
+end
+
 --- Close SDL logger connection to SDL
 function SdlLogger.close()
+  if SdlLogger.sink then
+    local bytes = SdlLogger.sink:stop()
+    xmlReporter.AddMessage("sdl_logger", { ["FunctionName"] = "close", ["BytesCaptured"] = tostring(bytes) })
+    SdlLogger.sink = nil
+  end
   if(SdlLogger.socket) then SdlLogger.socket:close() end
   os.execute('bash ./tools/WaitClosingSocket.sh '..config.sdl_logs_port)
 end
@@ -1,8 +1,11 @@
 --- Module which is responsible for all heartbeat emulation activities and provides HeartBeatMonitor type
 --
+-- If `config.nativeHeartbeat` is enabled and mobile connection is based on TCP socket (with or without I/O thread),
+-- heartbeat of all sessions of the connection is handled by one native `network.HeartbeatService`
+--
 -- *Dependencies:* `events`, `protocol_handler.ford_protocol_constants`, `qt`, `timers`
 --
--- *Globals:* `xmlReporter`, `AnyNumber()`, `qt`, `timers`
+-- *Globals:* `xmlReporter`, `AnyNumber()`, `qt`, `timers`, `network`, `config`
 -- @module services.heartbeat_monitor
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -15,6 +18,53 @@ local mt = { __index = { } }
 local d = qt.dynamic()
 local time_offset = 1000
 
+--- Native heartbeat services of mobile connections
+local native_services = setmetatable({ }, { __mode = "k" })
+--- All heartbeat monitors (weak keys)
+local monitors = setmetatable({ }, { __mode = "k" })
+
+--- Get native heartbeat service of mobile connection, create it on first call
+--
+-- Service parses frames of the whole stream, so it is attached by `HbMonitor.Attach`
+-- when connection is created, before anything is received
+-- @tparam MobileConnection connection Mobile connection
+-- @treturn table Native service (`hb` and `monitors` fields) or nil if native heartbeat is not available
+local function getNativeService(connection)
+  if not (config.nativeHeartbeat and network.HeartbeatService) then return nil end
+  if native_services[connection] then return native_services[connection] end
+  -- Find transport level connection with TCP socket
+  local transport = connection
+  while transport and not (transport.socket and transport.qtproxy) do
+    transport = transport.connection
+  end
+  -- Socket served by native I/O thread is supported too: frames are written through its queue
+  if not transport then return nil end
+  local srv = {
+    hb = network.HeartbeatService(transport.socket),
+    monitors = { },
+    proxy = qt.dynamic()
+  }
+  function srv.proxy:heartbeatTimeout(sessionId)
+    local monitor = srv.monitors[sessionId]
+    if monitor then monitor:CloseSession() end
+  end
+  qt.connect(transport.qtproxy, "inputData(QByteArray)", srv.hb, "input(QByteArray)")
+  qt.connect(srv.hb, "heartbeatTimeout(int)", srv.proxy, "heartbeatTimeout(int)")
+  native_services[connection] = srv
+  return srv
+end
+
+--- Attach native heartbeat service to mobile connection if native heartbeat is enabled
+-- @tparam MobileConnection connection Mobile connection
+function HbMonitor.Attach(connection)
+  getNativeService(connection)
+end
+
+--- Stop heartbeat of all sessions, e.g. when mobile connections of finished script are closed
+function HbMonitor.StopAll()
+  for monitor in pairs(monitors) do monitor:StopHeartbeat() end
+end
+
 --- Type which represents Heartbeat monitor. It responsible for all heartbeat emulation activities.
 -- @type HeartBeatMonitor
 
@@ -41,7 +91,11 @@ function mt.__index:SendHeartbeatAck()
 end
 
 --- Create and register expectation for heartbeat
+--
+-- Not needed if heartbeat is handled by native service: it answers heartbeat itself
+-- and gets flags of session from `SyncNativeFlags` when they are changed
 function mt.__index:AddHeartbeatExpectation()
+  if self.native then return end
   local event = events.Event()
   event.matches = function(s, data)
     return data.frameType == constants.FRAME_TYPE.CONTROL_FRAME and
@@ -53,16 +107,54 @@ function mt.__index:AddHeartbeatExpectation()
   :Pin()
   :Times(AnyNumber())
   :Do(function(data)
+      -- Native service may be started after expectation is registered
+      if self.native then return end
       if self.heartbeatEnabled and self.AnswerHeartbeatFromSDL.get() then
         self:SendHeartbeatAck()
       end
     end)
 end
 
+--- Pass heartbeat flags of session to native heartbeat service
+function mt.__index:SyncNativeFlags()
+  if self.native then
+    self.native.hb:setFlags(self.nativeSessionId, self.SendHeartbeatToSDL.get(),
+      self.AnswerHeartbeatFromSDL.get(), self.IgnoreHeartBeatAck.get())
+  end
+end
+
+--- Close session if SDL didn't send anything during heartbeat timeout
+function mt.__index:CloseSession()
+  if self.heartbeatEnabled then
+    print("\27[31m SDL didn't send anything for " .. (config.heartbeatTimeout + time_offset)
+      .. " msecs. Closing session # " .. self.session.sessionId.get().."\27[0m")
+    self.control_services:StopService(7)
+    self:StopHeartbeat()
+  end
+end
+
+--- Start heartbeat in native heartbeat service
+-- @tparam table native Native heartbeat service
+function mt.__index:StartNativeHeartbeat(native)
+  self.native = native
+  self.nativeSessionId = self.session.sessionId.get()
+  native.monitors[self.nativeSessionId] = self
+  xmlReporter.AddMessage("StartHearbeat", "True", (config.heartbeatTimeout + time_offset))
+  native.hb:start(self.nativeSessionId, self.session.version,
+    config.heartbeatTimeout, config.heartbeatTimeout + time_offset)
+  self:SyncNativeFlags()
+end
+
 --- Start heartbeat
 function mt.__index:StartHeartbeat()
   self.heartbeatEnabled = true
 
+  local native = getNativeService(self.session.connection)
+  if native then
+    self:StartNativeHeartbeat(native)
+    return
+  end
+
   function d.SendHeartbeat()
     if self.heartbeatEnabled and self.SendHeartbeatToSDL.get() then
       self.control_services:SendControlMessage( { frameInfo = constants.FRAME_INFO.HEARTBEAT } )
@@ -99,6 +191,11 @@ end
 function mt.__index:StopHeartbeat()
   if self.heartbeatEnabled then
     self.heartbeatEnabled = false
+    if self.native then
+      self.native.hb:stop(self.nativeSessionId)
+      self.native.monitors[self.nativeSessionId] = nil
+      self.native = nil
+    end
     if self.heartbeatToSDLTimer then
       self.heartbeatToSDLTimer:stop()
     end
@@ -112,6 +209,9 @@ end
 --- Set heartbeat interval
 -- @tparam number timeout Heartbeat interval in msec
 function mt.__index:SetHeartbeatTimeout(timeout)
+  if self.native then
+    self.native.hb:setInterval(self.nativeSessionId, timeout, timeout + time_offset)
+  end
   if self.heartbeatToSDLTimer and self.sessionheartbeatFromSDLTimer then
     self.heartbeatToSDLTimer:setInterval(timeout)
     self.heartbeatFromSDLTimer:setInterval(timeout + time_offset)
@@ -148,6 +248,7 @@ function HbMonitor.HeartBeatMonitor(session)
 
   res.heartbeatEnabled = true
   setmetatable(res, mt)
+  monitors[res] = true
   return res
 end
 
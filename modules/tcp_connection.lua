@@ -2,7 +2,10 @@
 --
 -- *Dependencies:* `qt`, `network`
 --
--- *Globals:* `xmlReporter`, `qt`, `network`
+-- If `config.networkThread` is enabled socket is served by native I/O thread,
+-- if `config.batchDelivery` is enabled all data available on socket is handed over at once
+--
+-- *Globals:* `xmlReporter`, `qt`, `network`, `config`
 -- @module tcp_connection
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -22,17 +25,41 @@ function Tcp.Connection(host, port)
     host = host,
     port = port
   }
-  res.socket = network.TcpClient()
+  res.threaded = config.networkThread and network.ThreadedTcpClient ~= nil
+  res.socket = res.threaded and network.ThreadedTcpClient() or network.TcpClient()
   setmetatable(res, Tcp.mt)
   res.qtproxy = qt.dynamic()
 
   function res:inputData() end
 
-  function res.qtproxy.readyRead()
-    while true do
-      local data = res.socket:read(81920)
-      if data == '' then break end
-      res.qtproxy:inputData(data)
+  if res.threaded then
+    -- All complete frames received by I/O thread are handled at once
+    function res.qtproxy.readyRead()
+      local frames = res.socket:read_all()
+      if #frames > 0 then
+        res.qtproxy:inputData(table.concat(frames))
+      end
+    end
+  elseif config.batchDelivery then
+    -- Everything available is handed over at once, so messages are parsed in one batch
+    function res.qtproxy.readyRead()
+      local chunks = { }
+      while true do
+        local data = res.socket:read(81920)
+        if data == '' then break end
+        chunks[#chunks + 1] = data
+      end
+      if #chunks > 0 then
+        res.qtproxy:inputData(table.concat(chunks))
+      end
+    end
+  else
+    function res.qtproxy.readyRead()
+      while true do
+        local data = res.socket:read(81920)
+        if data == '' then break end
+        res.qtproxy:inputData(data)
+      end
     end
   end
   qt.connect(res.socket, "readyRead()", res.qtproxy, "readyRead()")
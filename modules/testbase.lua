@@ -6,10 +6,11 @@
 --
 -- For component overview description and a list of responsibilities, please, follow [ATF SAD Component View](https://smartdevicelink.com/en/guides/pull_request/93dee199f30303b4b26ec9a852c1f5261ff0735d/atf/components-view/#test-base).
 --
--- *Dependencies:* `qt`, `event_dispatcher`, `events`, `expectations`, `console`, `format`, `SDL`, `exit_codes`, `config`
+-- *Dependencies:* `qt`, `event_dispatcher`, `events`, `expectations`, `console`, `format`, `SDL`, `exit_codes`, `config`,
+-- `case_resources`, `connection_metrics`, `latency_stats`, `perflog`
 --
 -- *Globals:* `xmlReporter`, `qt`, `critical()`, `description()`, `timestamp()`, `atf_logger`, `print_stopscript()`,
--- `is_redirected`, `config`, `event_dispatcher`, `quit`, `timeoutTimer`
+-- `is_redirected`, `config`, `event_dispatcher`, `quit`, `timeoutTimer`, `deadlineTimer`
 -- @module testbase
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
@@ -21,6 +22,10 @@ local console = require('console')
 local fmt = require('format')
 local SDL = require('SDL')
 local exit_codes = require('exit_codes')
+local case_resources = require('case_resources')
+local connection_metrics = require('connection_metrics')
+local latency_stats = require('latency_stats')
+local perflog = require('perflog')
 
 local Test = { }
 
@@ -114,6 +119,28 @@ local mt =
   __metatable = { }
 }
 
+--- Run next script in this process
+--
+-- Test steps of finished script are dropped. SDL is kept if it still runs, then `Test:prepareNextScript`
+-- (connecttest) resets connections and adds precondition steps before steps of the next script
+-- @tparam string script Path to the next script
+-- @lfunction runNextScript
+local function runNextScript(script)
+  SDL:Reuse(script)
+  print_stopscript(get_script_file_name())
+  xmlReporter:finalize()
+  mt.__index.test_cases = { }
+  mt.__index.case_names = { }
+  mt.__index.descriptions = { }
+  rawset(Test, "current_case_index", 0)
+  -- Report of each script gets timestamp of its start as in a separate run
+  xmlReporter.timestamp = ''
+  if Test.prepareNextScript then Test:prepareNextScript() end
+  print_startscript(script)
+  script_execute(script)
+  control:next()
+end
+
 --- Runs next Test Case or quit ATF execution
 -- Test case is any testbase inheritor
 -- with a first capital letter
@@ -127,12 +154,27 @@ function control.runNextCase()
     Test.current_case_name = Test.case_names[testcase]
     xmlReporter.AddCase(Test.current_case_name)
     atf_logger.LOGTestCaseStart(Test.current_case_name)
+    if config.caseResources then case_resources.start() end
+    if config.connectionMetrics then connection_metrics.start() end
+    if config.latencyStats then latency_stats.start() end
+    if perflog.connected() then perflog.start(Test.current_case_name) end
     testcase(Test)
   else
+    Test.current_case_name = nil
+    local next_script = config.reuseSDL and next_queued_script()
+    if next_script then
+      runNextScript(next_script)
+      return
+    end
     if SDL.autoStarted then
       SDL:StopSDL()
     end
-    Test.current_case_name = nil
+    if config.memoryTags then
+      require('memory_tags').print_summary()
+    end
+    connection_metrics.stop_export()
+    if config.latencyStats then latency_stats.report() end
+    perflog.close()
     print_stopscript()
     xmlReporter:finalize()
     if total_testset_result == false then
@@ -150,6 +192,9 @@ function control:start()
   if config.color == nil then config.color = true end
   if is_redirected then config.color = false end
   SDL:DeleteFile()
+  if config.memoryTags then
+    require('memory_tags').install()
+  end
   self:next()
 end
 
@@ -167,7 +212,7 @@ local function CheckStatus()
     print(console.setattr("SDL has unexpectedly crashed or stop responding!", "cyan", 1))
     critical(SDL.exitOnCrash)
     SDL:DeleteFile()
-  elseif Test.expectations_list:Any(function(e) return not e.status end) then return end
+  elseif Test.expectations_list:HasPending() then return end
   for _, e in ipairs(Test.expectations_list) do
     if e.status ~= SUCCESS then
       success = false
@@ -180,8 +225,22 @@ local function CheckStatus()
       errorMessage[e.name .. ": " .. k] = v
     end
   end
-  fmt.PrintCaseResult(Test.current_case_time, Test.current_case_name, success, errorMessage, timestamp() - Test.ts)
-  xmlReporter.CaseMessageTotal(Test.current_case_name,{ ["result"] = success, ["timestamp"] = (timestamp() - Test.ts)} )
+  local duration = timestamp() - Test.ts
+  fmt.PrintCaseResult(Test.current_case_time, Test.current_case_name, success, errorMessage, duration)
+  local total = { ["result"] = success, ["timestamp"] = duration }
+  local resources = config.caseResources and case_resources.finish()
+  if resources then
+    case_resources.attributes(resources, total)
+    case_resources.write_summary(Test.current_case_name, success, duration, resources)
+  end
+  local metrics = config.connectionMetrics and connection_metrics.finish()
+  if metrics then connection_metrics.attributes(metrics, total) end
+  local latencies = config.latencyStats and latency_stats.finish()
+  if latencies then latency_stats.attributes(latencies, total) end
+  local breakdown = perflog.finish()
+  if breakdown then perflog.attributes(breakdown, total) end
+  connection_metrics.write(Test.current_case_name)
+  xmlReporter.CaseMessageTotal(Test.current_case_name, total)
   if (not success) then xmlReporter.AddMessage("ErrorMessage", {["Status"] = "FAILD"}, errorMessage ) end
   Test.expectations_list:Clear()
   Test.current_case_name = nil
@@ -219,6 +278,23 @@ function control:checkstatus()
   CheckStatus()
 end
 
+--- Start single shot timer which fires as soon as deadline passes
+-- @tparam number deadline Deadline (`timestamp()` value)
+-- @lfunction armDeadlineTimer
+local function armDeadlineTimer(deadline)
+  deadlineTimer:start(math.max(deadline - timestamp() + 1, 0))
+end
+
+--- Supports method for Test Case status validation on the earliest expectation deadline
+-- @lfunction control.checkdeadline
+function control:checkdeadline()
+  event_dispatcher:validateAll()
+  -- timer may fire a bit earlier than deadline, so re-arm it for the same deadline
+  local deadline = event_dispatcher:NextDeadline()
+  if deadline then armDeadlineTimer(deadline) end
+  CheckStatus()
+end
+
 --- Testbase module initialization
 local function main()
   setmetatable(Test, mt)
@@ -227,11 +303,30 @@ local function main()
 
   rawset(Test, "FailTestCase", FailTestCase)
   rawset(Test, "SkipTest", SkipTest)
+  rawset(Test, "CheckStatus", CheckStatus)
 
   event_dispatcher = ed.EventDispatcher()
+  event_dispatcher:EnableBatches(config.batchDelivery)
   event_dispatcher:OnPostEvent(CheckStatus)
+  event_dispatcher:SetPendingCheck(function()
+      return Test.current_case_name == nil or Test.expectations_list:HasPending()
+    end)
+  if config.virtualTime then
+    timers.virtual_time(true, config.virtualTimeIdle)
+  end
+  latency_stats.tracking = config.latencyStats
+  if config.perflogConnection and config.perflogConnection ~= "" then
+    perflog.connect(config.perflogConnection, tonumber(config.perflogConnectionPort))
+  end
+  if config.connectionMetricsFile and config.connectionMetricsFile ~= "" then
+    connection_metrics.start_export(config.connectionMetricsFile, config.connectionMetricsInterval or 1000)
+  end
   timeoutTimer = timers.Timer()
   qt.connect(timeoutTimer, "timeout()", control, "checkstatus()")
+  deadlineTimer = timers.Timer()
+  deadlineTimer:setSingleShot(true)
+  qt.connect(deadlineTimer, "timeout()", control, "checkdeadline()")
+  event_dispatcher:OnDeadline(armDeadlineTimer)
 
   timeoutTimer:start(400)
   control:next()
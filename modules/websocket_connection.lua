@@ -1,13 +1,15 @@
 --- Module which provides transport level interface for emulate connection with HMI for SDL
 --
--- *Dependencies:* `json`, `qt`, `network`
+-- *Dependencies:* `json`, `qt`, `network`, `case_resources`, `connection_metrics`
 --
--- *Globals:* `atf_logger`, `qt`, `network`
+-- *Globals:* `atf_logger`, `qt`, `network`, `config`
 -- @module websocket_connection
 -- @copyright [Ford Motor Company](https://smartdevicelink.com/partners/ford/) and [SmartDeviceLink Consortium](https://smartdevicelink.com/consortium/)
 -- @license <https://github.com/smartdevicelink/sdl_core/blob/master/LICENSE>
 
 local json = require("json")
+local case_resources = require("case_resources")
+local connection_metrics = require("connection_metrics")
 
 local WS = {
   mt = { __index = {} }
@@ -27,6 +29,10 @@ function WS.WebSocketConnection(url, port)
     port = port
   }
   res.socket = network.WebSocket()
+  local name = case_resources.unique_name("hmi")
+  res.name = name
+  res.counters = case_resources.connection(name)
+  connection_metrics.register(name, res.socket)
   setmetatable(res, WS.mt)
   res.qtproxy = qt.dynamic()
   return res
@@ -49,16 +55,79 @@ end
 -- @tparam string text Message
 function WS.mt.__index:Send(text)
   atf_logger.LOG("HMItoSDL", text)
+  local counters = self.counters
+  counters.messages_sent = counters.messages_sent + 1
+  counters.bytes_sent = counters.bytes_sent + #text
   self.socket:write(text)
 end
 
+--- Send several messages from HMI to SDL by one native call
+-- @tparam table texts Array of messages
+function WS.mt.__index:SendBatch(texts)
+  local counters = self.counters
+  for _, text in ipairs(texts) do
+    atf_logger.LOG("HMItoSDL", text)
+    counters.messages_sent = counters.messages_sent + 1
+    counters.bytes_sent = counters.bytes_sent + #text
+  end
+  self.socket:write_batch(texts)
+end
+
+--- Set handler for batches of messages
+--
+-- If `config.nativeHmiJson` is set frames are taken as UTF-8 bytes by native receiver,
+-- JSON is decoded in native code and all frames received during event loop iteration
+-- are delivered by one call. Otherwise every batch has one message.
+-- @tparam function func Handler function with signature func(connection, messages)
+function WS.mt.__index:OnInputBatch(func)
+  local d = qt.dynamic()
+  local this = self
+  local counters = self.counters
+  local function received(text, data)
+    atf_logger.LOG("SDLtoHMI", text)
+    counters.messages_received = counters.messages_received + 1
+    counters.bytes_received = counters.bytes_received + #text
+    -- Texts native decoder rejected are decoded by Lua to get the same error
+    return data or json.decode(text)
+  end
+  if config.nativeHmiJson then
+    local receiver = network.WebSocketReceiver(self.socket, true)
+    self.receiver = receiver
+    function d:readyRead()
+      local texts, data = receiver:read_all()
+      local messages = { }
+      for i, text in ipairs(texts) do
+        messages[i] = received(text, data[i])
+      end
+      if #messages > 0 then func(this, messages) end
+    end
+    qt.connect(receiver, "readyRead()", d, "readyRead()")
+  else
+    function d:textMessageReceived(text)
+      func(this, { received(text) })
+    end
+    qt.connect(self.socket, "textMessageReceived(QString)", d, "textMessageReceived(QString)")
+  end
+end
+
 --- Set handler for OnInputData
+--
+-- If `config.nativeHmiJson` is set messages are received by `OnInputBatch`
 -- @tparam function func Handler function
 function WS.mt.__index:OnInputData(func)
+  if config.nativeHmiJson then
+    self:OnInputBatch(function(this, messages)
+        for _, data in ipairs(messages) do func(this, data) end
+      end)
+    return
+  end
   local d = qt.dynamic()
   local this = self
+  local counters = self.counters
   function d:textMessageReceived(text)
     atf_logger.LOG("SDLtoHMI", text)
+    counters.messages_received = counters.messages_received + 1
+    counters.bytes_received = counters.bytes_received + #text
     local data = json.decode(text)
     --print("ws input:", text)
     func(this, data)
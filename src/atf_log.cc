@@ -0,0 +1,201 @@
+#include "atf_log.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+namespace {
+const char kMagic[] = "ATFLOG1\n";
+const size_t kRecordHeaderSize = 32;
+const size_t kBufferSize = 256 * 1024;
+const char *kWriterMetatable = "atf_log.Writer";
+
+struct Writer {
+  FILE *file;
+  char *buffer;
+};
+
+uint64_t monotonic_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint64_t realtime_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return uint64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+void put16(char *p, uint16_t v) {
+  p[0] = char(v);
+  p[1] = char(v >> 8);
+}
+
+void put32(char *p, uint32_t v) {
+  for (int i = 0; i < 4; ++i) p[i] = char(v >> (8 * i));
+}
+
+void put64(char *p, uint64_t v) {
+  for (int i = 0; i < 8; ++i) p[i] = char(v >> (8 * i));
+}
+
+Writer *check_writer(lua_State *L) {
+  Writer *w = static_cast<Writer*>(luaL_checkudata(L, 1, kWriterMetatable));
+  if (!w->file) luaL_error(L, "atf log is closed");
+  return w;
+}
+
+// Header is written to stdio buffer of the file, so a record costs two memcpy
+void write_record(Writer *w, char *header, uint8_t type, uint8_t direction,
+                  uint16_t present, const char *payload, size_t size) {
+  header[0] = char(type);
+  header[1] = char(direction);
+  put16(header + 2, present);
+  put32(header + 4, uint32_t(size));
+  put64(header + 8, monotonic_us());
+  fwrite(header, 1, kRecordHeaderSize, w->file);
+  if (size) fwrite(payload, 1, size, w->file);
+}
+
+// Reads integer field of message at index 3, sets bit of mask if field is present
+uint32_t field(lua_State *L, const char *name, uint16_t bit, uint16_t *present) {
+  lua_getfield(L, 3, name);
+  uint32_t res = 0;
+  if (lua_isboolean(L, -1)) {
+    res = lua_toboolean(L, -1);
+    *present |= bit;
+  } else if (lua_isnumber(L, -1)) {
+    res = static_cast<uint32_t>(lua_tonumber(L, -1));
+    *present |= bit;
+  }
+  lua_pop(L, 1);
+  return res;
+}
+
+// open(filename, script_name)
+// Returns writer or nil and error message
+int atf_log_open(lua_State *L) {/*{{{*/
+  const char *filename = luaL_checkstring(L, 1);
+  size_t name_size = 0;
+  const char *script_name = luaL_optlstring(L, 2, "", &name_size);
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    lua_pushnil(L);
+    lua_pushfstring(L, "%s: %s", filename, strerror(errno));
+    return 2;
+  }
+  Writer *w = static_cast<Writer*>(lua_newuserdata(L, sizeof(Writer)));
+  w->file = file;
+  w->buffer = new char[kBufferSize];
+  setvbuf(file, w->buffer, _IOFBF, kBufferSize);
+  luaL_setmetatable(L, kWriterMetatable);
+
+  fwrite(kMagic, 1, sizeof(kMagic) - 1, file);
+  char header[kRecordHeaderSize] = { 0 };
+  put64(header + 16, realtime_ms());
+  write_record(w, header, kAtfLogStart, 0, 0, script_name, name_size);
+  return 1;
+}/*}}}*/
+
+// writer:mobile(direction, message, payload)
+// Fields of message (table or ford_protocol.Message) are stored in binary form,
+// payload is JSON text
+int writer_mobile(lua_State *L) {/*{{{*/
+  Writer *w = check_writer(L);
+  const int direction = luaL_checkinteger(L, 2);
+  luaL_checkany(L, 3);
+  uint16_t present = 0;
+  char header[kRecordHeaderSize] = { 0 };
+  char *p = header + 16;
+  p[0] = char(field(L, "sessionId", kAtfLogSessionId, &present));
+  p[1] = char(field(L, "version", kAtfLogVersion, &present));
+  p[2] = char(field(L, "frameType", kAtfLogFrameType, &present));
+  p[3] = char(field(L, "serviceType", kAtfLogServiceType, &present));
+  p[4] = char(field(L, "frameInfo", kAtfLogFrameInfo, &present));
+  p[5] = char(field(L, "encryption", kAtfLogEncryption, &present));
+  put32(p + 8, field(L, "messageId", kAtfLogMessageId, &present));
+  put32(p + 12, field(L, "rpcFunctionId", kAtfLogFunctionId, &present));
+  size_t size = 0;
+  const char *payload = lua_isstring(L, 4) ? lua_tolstring(L, 4, &size) : NULL;
+  if (payload) present |= kAtfLogPayload;
+  write_record(w, header, kAtfLogMobile, uint8_t(direction), present, payload, size);
+  return 0;
+}/*}}}*/
+
+int write_text(lua_State *L, uint8_t type, uint8_t direction, int index) {
+  Writer *w = check_writer(L);
+  size_t size = 0;
+  const char *text = luaL_checklstring(L, index, &size);
+  char header[kRecordHeaderSize] = { 0 };
+  write_record(w, header, type, direction, 0, text, size);
+  return 0;
+}
+
+// writer:hmi(direction, text)
+int writer_hmi(lua_State *L) {/*{{{*/
+  return write_text(L, kAtfLogHmi, uint8_t(luaL_checkinteger(L, 2)), 3);
+}/*}}}*/
+
+// writer:test_case(name)
+int writer_test_case(lua_State *L) {/*{{{*/
+  return write_text(L, kAtfLogCase, 0, 2);
+}/*}}}*/
+
+// writer:finish(total_time)
+int writer_finish(lua_State *L) {/*{{{*/
+  return write_text(L, kAtfLogFinish, 0, 2);
+}/*}}}*/
+
+int writer_flush(lua_State *L) {/*{{{*/
+  fflush(check_writer(L)->file);
+  return 0;
+}/*}}}*/
+
+int writer_close(lua_State *L) {/*{{{*/
+  Writer *w = static_cast<Writer*>(luaL_checkudata(L, 1, kWriterMetatable));
+  if (w->file) {
+    fclose(w->file);
+    w->file = NULL;
+    delete[] w->buffer;
+    w->buffer = NULL;
+  }
+  return 0;
+}/*}}}*/
+}  // anonymous namespace
+
+int luaopen_atf_log(lua_State *L) {
+  luaL_newmetatable(L, kWriterMetatable);
+  lua_newtable(L);
+  luaL_Reg writer_functions[] = {
+    { "mobile", &writer_mobile },
+    { "hmi", &writer_hmi },
+    { "test_case", &writer_test_case },
+    { "finish", &writer_finish },
+    { "flush", &writer_flush },
+    { "close", &writer_close },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, writer_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, &writer_close);
+  lua_setfield(L, -2, "__gc");
+  lua_pop(L, 1);
+
+  luaL_Reg atf_log_functions[] = {
+    { "open", &atf_log_open },
+    { NULL, NULL }
+  };
+  luaL_newlib(L, atf_log_functions);
+  lua_pushinteger(L, kAtfLogMobToSdl);
+  lua_setfield(L, -2, "MOB_TO_SDL");
+  lua_pushinteger(L, kAtfLogSdlToMob);
+  lua_setfield(L, -2, "SDL_TO_MOB");
+  lua_pushinteger(L, kAtfLogHmiToSdl);
+  lua_setfield(L, -2, "HMI_TO_SDL");
+  lua_pushinteger(L, kAtfLogSdlToHmi);
+  lua_setfield(L, -2, "SDL_TO_HMI");
+  return 1;
+}
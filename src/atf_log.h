@@ -0,0 +1,53 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+
+// Binary ATF log.
+// File starts with 8 bytes magic "ATFLOG1\n" followed by records. Every record
+// is a fixed 32 bytes little-endian header and raw payload bytes:
+//   u8  type        (AtfLogRecord)
+//   u8  direction   (AtfLogDirection)
+//   u16 present     bit mask of present mobile fields (AtfLogField)
+//   u32 size        size of payload following the header
+//   u64 time_us     monotonic time in microseconds
+//   16 bytes of type specific fields:
+//     start:  u64 realtime_ms (wall clock of time_us), payload is script name
+//     mobile: u8 session_id, version, frame_type, service_type, frame_info,
+//             encryption, u16 reserved, u32 message_id, u32 function_id;
+//             payload is JSON text of RPC
+//     hmi:    payload is JSON text
+//     case:   payload is test step name
+//     finish: payload is total time of script
+// tools/atf_logcat.lua renders records to text or JSON.
+enum AtfLogRecord {
+  kAtfLogStart = 1,
+  kAtfLogMobile = 2,
+  kAtfLogHmi = 3,
+  kAtfLogCase = 4,
+  kAtfLogFinish = 5
+};
+
+enum AtfLogDirection {
+  kAtfLogMobToSdl = 0,
+  kAtfLogSdlToMob = 1,
+  kAtfLogHmiToSdl = 2,
+  kAtfLogSdlToHmi = 3
+};
+
+enum AtfLogField {
+  kAtfLogSessionId = 1 << 0,
+  kAtfLogVersion = 1 << 1,
+  kAtfLogFrameType = 1 << 2,
+  kAtfLogServiceType = 1 << 3,
+  kAtfLogFrameInfo = 1 << 4,
+  kAtfLogEncryption = 1 << 5,
+  kAtfLogMessageId = 1 << 6,
+  kAtfLogFunctionId = 1 << 7,
+  kAtfLogPayload = 1 << 8
+};
+
+int luaopen_atf_log(lua_State *L);
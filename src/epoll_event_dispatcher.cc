@@ -0,0 +1,394 @@
+#include "epoll_event_dispatcher.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEvent>
+#include <QTimerEvent>
+#include <algorithm>
+#include <functional>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+extern uint qGlobalPostedEventsCount();
+
+namespace {
+const int kMaxEvents = 256;
+
+qint64 clockMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return qint64(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+quint32 eventsOf(QSocketNotifier::Type type) {
+  switch (type) {
+    case QSocketNotifier::Read: return EPOLLIN;
+    case QSocketNotifier::Write: return EPOLLOUT;
+    case QSocketNotifier::Exception: return EPOLLPRI;
+  }
+  return 0;
+}
+
+short pollEventsOf(QSocketNotifier::Type type) {
+  switch (type) {
+    case QSocketNotifier::Read: return POLLIN;
+    case QSocketNotifier::Write: return POLLOUT;
+    case QSocketNotifier::Exception: return POLLPRI;
+  }
+  return 0;
+}
+
+void addFd(int epoll_fd, int fd) {
+  // Internal descriptors are level-triggered: they are always drained
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+}
+
+EpollEventDispatcher::EpollEventDispatcher(QObject *parent)
+  : QAbstractEventDispatcher(parent),
+    epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+    event_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+    timer_fd_(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+    armed_deadline_(-1),
+    interrupted_(false),
+    wakeup_pending_(false),
+    stats_() {
+  if (epoll_fd_ < 0 || event_fd_ < 0 || timer_fd_ < 0) {
+    qFatal("EpollEventDispatcher: cannot create descriptors: %s", strerror(errno));
+  }
+  addFd(epoll_fd_, event_fd_);
+  addFd(epoll_fd_, timer_fd_);
+}
+
+EpollEventDispatcher::~EpollEventDispatcher() {
+  close(timer_fd_);
+  close(event_fd_);
+  close(epoll_fd_);
+}
+
+bool EpollEventDispatcher::processEvents(QEventLoop::ProcessEventsFlags flags) {
+  ++stats_.iterations;
+  interrupted_ = false;
+  emit awake();
+  QCoreApplication::sendPostedEvents();
+
+  const bool exclude_sockets = flags & QEventLoop::ExcludeSocketNotifiers;
+  const bool exclude_timers = flags & QEventLoop::X11ExcludeTimers;
+  const bool can_wait = !interrupted_ && (flags & QEventLoop::WaitForMoreEvents);
+
+  if (exclude_timers) {
+    // Expired timers stay in heap until timers are allowed again
+    if (armed_deadline_ >= 0) {
+      struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+      timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+      armed_deadline_ = -1;
+    }
+  } else {
+    armTimerFd();
+  }
+
+  const int timeout = waitTimeout(can_wait && (exclude_sockets || ready_.isEmpty()));
+  if (timeout != 0) {
+    ++stats_.waits;
+    emit aboutToBlock();
+  }
+
+  struct epoll_event events[kMaxEvents];
+  int n = epoll_wait(epoll_fd_, events, kMaxEvents, timeout);
+  if (timeout != 0) emit awake();
+  if (n < 0) {
+    if (errno != EINTR) qWarning("EpollEventDispatcher: epoll_wait failed: %s", strerror(errno));
+    n = 0;
+  }
+
+  bool timers_expired = false;
+  QList<QSocketNotifier*> pending;
+  pending.swap(ready_);
+  for (int i = 0; i < n; ++i) {
+    const int fd = events[i].data.fd;
+    if (fd == event_fd_) {
+      eventfd_t value;
+      eventfd_read(event_fd_, &value);
+      wakeup_pending_ = false;
+      ++stats_.wakeups;
+      continue;
+    }
+    if (fd == timer_fd_) {
+      uint64_t expirations;
+      if (read(timer_fd_, &expirations, sizeof(expirations)) > 0) {
+        timers_expired = true;
+      }
+      armed_deadline_ = -1;
+      continue;
+    }
+    auto it = sockets_.constFind(fd);
+    if (it == sockets_.constEnd()) continue;
+    const quint32 ev = events[i].events;
+    const quint32 error = ev & (EPOLLERR | EPOLLHUP);
+    QSocketNotifier *read_notifier = it->notifiers[QSocketNotifier::Read];
+    QSocketNotifier *write_notifier = it->notifiers[QSocketNotifier::Write];
+    QSocketNotifier *exception_notifier = it->notifiers[QSocketNotifier::Exception];
+    if (read_notifier && ((ev & (EPOLLIN | EPOLLRDHUP)) || error)
+        && !pending.contains(read_notifier)) {
+      pending.append(read_notifier);
+    }
+    if (write_notifier && ((ev & EPOLLOUT) || error)
+        && !pending.contains(write_notifier)) {
+      pending.append(write_notifier);
+    }
+    if (exception_notifier && (ev & EPOLLPRI)
+        && !pending.contains(exception_notifier)) {
+      pending.append(exception_notifier);
+    }
+  }
+
+  int delivered = 0;
+  if (exclude_sockets) {
+    // Edges are not repeated by kernel, so keep them for the next iteration
+    ready_.swap(pending);
+  } else {
+    pending_.swap(pending);
+    while (!pending_.isEmpty() && !interrupted_) {
+      if (activateNotifier(pending_.takeFirst())) ++delivered;
+    }
+    ready_.append(pending_);
+    pending_.clear();
+  }
+
+  if (timers_expired && !exclude_timers && !interrupted_) {
+    delivered += activateTimers();
+  }
+  return delivered > 0;
+}
+
+bool EpollEventDispatcher::hasPendingEvents() {
+  return qGlobalPostedEventsCount() > 0;
+}
+
+void EpollEventDispatcher::registerSocketNotifier(QSocketNotifier *notifier) {
+  const int fd = int(notifier->socket());
+  const QSocketNotifier::Type type = notifier->type();
+  Socket& socket = sockets_[fd];
+  if (socket.notifiers[type] && socket.notifiers[type] != notifier) {
+    qWarning("EpollEventDispatcher: multiple socket notifiers for same socket %d and type %d",
+             fd, int(type));
+  }
+  socket.notifiers[type] = notifier;
+  updateSocket(fd);
+}
+
+void EpollEventDispatcher::unregisterSocketNotifier(QSocketNotifier *notifier) {
+  const int fd = int(notifier->socket());
+  const QSocketNotifier::Type type = notifier->type();
+  ready_.removeAll(notifier);
+  pending_.removeAll(notifier);
+  auto it = sockets_.find(fd);
+  if (it == sockets_.end() || it->notifiers[type] != notifier) return;
+  it->notifiers[type] = nullptr;
+  updateSocket(fd);
+}
+
+void EpollEventDispatcher::updateSocket(int fd) {
+  auto it = sockets_.find(fd);
+  if (it == sockets_.end()) return;
+  quint32 mask = 0;
+  for (int type = QSocketNotifier::Read; type <= QSocketNotifier::Exception; ++type) {
+    if (it->notifiers[type]) mask |= eventsOf(QSocketNotifier::Type(type));
+  }
+  struct epoll_event ev;
+  ev.data.fd = fd;
+  if (mask == 0) {
+    if (it->events) epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, &ev);
+    sockets_.erase(it);
+    return;
+  }
+  ev.events = mask | EPOLLET | EPOLLRDHUP;
+  // Modification of registered mask makes kernel report current readiness,
+  // so re-enabled notifier gets already available data
+  int res = epoll_ctl(epoll_fd_, it->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev);
+  if (res < 0 && errno == EEXIST) {
+    res = epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+  } else if (res < 0 && errno == ENOENT) {
+    res = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+  }
+  if (res < 0) {
+    qWarning("EpollEventDispatcher: cannot watch socket %d: %s", fd, strerror(errno));
+  }
+  it->events = mask;
+}
+
+bool EpollEventDispatcher::activateNotifier(QSocketNotifier *notifier) {
+  // Notifier may be deleted by its handler, so everything needed later is
+  // copied before activation
+  const int fd = int(notifier->socket());
+  const QSocketNotifier::Type type = notifier->type();
+  ++stats_.socket_events;
+  QEvent event(QEvent::SockAct);
+  QCoreApplication::sendEvent(notifier, &event);
+
+  // Edge-triggered epoll does not repeat readiness, which was not consumed
+  // by handler, so descriptor is checked once more after activation
+  auto it = sockets_.constFind(fd);
+  if (it == sockets_.constEnd() || it->notifiers[type] != notifier) return true;
+  struct pollfd pfd = { fd, pollEventsOf(type), 0 };
+  if (poll(&pfd, 1, 0) > 0 && !ready_.contains(notifier)) {
+    ++stats_.rechecks;
+    ready_.append(notifier);
+  }
+  return true;
+}
+
+void EpollEventDispatcher::registerTimer(int timerId, int interval, Qt::TimerType timerType,
+                                         QObject *object) {
+  Timer timer;
+  timer.interval = interval;
+  timer.type = timerType;
+  timer.object = object;
+  timer.deadline = 0;
+  timer.serial = 0;
+  timer.active = false;
+  Timer& registered = timers_[timerId] = timer;
+  scheduleTimer(timerId, registered, clockMs() + interval);
+}
+
+bool EpollEventDispatcher::unregisterTimer(int timerId) {
+  // Heap entry of removed timer is skipped when it is popped
+  return timers_.remove(timerId) > 0;
+}
+
+bool EpollEventDispatcher::unregisterTimers(QObject *object) {
+  bool removed = false;
+  for (auto it = timers_.begin(); it != timers_.end();) {
+    if (it->object == object) {
+      it = timers_.erase(it);
+      removed = true;
+    } else {
+      ++it;
+    }
+  }
+  return removed;
+}
+
+QList<QAbstractEventDispatcher::TimerInfo> EpollEventDispatcher::registeredTimers(QObject *object) const {
+  QList<TimerInfo> result;
+  for (auto it = timers_.constBegin(); it != timers_.constEnd(); ++it) {
+    if (it->object == object) result.append(TimerInfo(it.key(), it->interval, it->type));
+  }
+  return result;
+}
+
+int EpollEventDispatcher::remainingTime(int timerId) {
+  auto it = timers_.constFind(timerId);
+  if (it == timers_.constEnd()) return -1;
+  return int(qMax<qint64>(0, it->deadline - clockMs()));
+}
+
+int EpollEventDispatcher::activateTimers() {
+  const qint64 now = clockMs();
+  // Due timers are popped before any of them is rescheduled, so a timer with
+  // zero interval is popped once. Timers rescheduled or registered by
+  // handlers are delivered in the next batch
+  QList<int> due;
+  while (!heap_.empty() && heap_.front().deadline <= now) {
+    const HeapEntry entry = heap_.front();
+    std::pop_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+    heap_.pop_back();
+    auto it = timers_.find(entry.id);
+    if (it == timers_.end() || it->serial != entry.serial) continue;
+    due.append(entry.id);
+  }
+  QList<int> batch;
+  for (int id : due) {
+    Timer& timer = timers_[id];
+    qint64 next = timer.deadline + timer.interval;
+    if (next <= now) next = now + timer.interval;
+    scheduleTimer(id, timer, next);
+    // Timer, which handler is still running (nested event loop), skips this period
+    if (!timer.active) batch.append(id);
+  }
+
+  int delivered = 0;
+  for (int id : batch) {
+    auto it = timers_.find(id);
+    if (it == timers_.end()) continue;
+    it->active = true;
+    QObject *object = it->object;
+    QTimerEvent event(id);
+    QCoreApplication::sendEvent(object, &event);
+    ++delivered;
+    // Handler may kill timer or register new ones
+    it = timers_.find(id);
+    if (it != timers_.end()) it->active = false;
+  }
+  if (delivered > 0) {
+    ++stats_.timer_batches;
+    stats_.timer_events += delivered;
+    stats_.max_timer_batch = qMax<quint64>(stats_.max_timer_batch, delivered);
+  }
+  compactHeap();
+  return delivered;
+}
+
+void EpollEventDispatcher::scheduleTimer(int id, Timer& timer, qint64 deadline) {
+  timer.deadline = deadline;
+  ++timer.serial;
+  heap_.push_back(HeapEntry{ deadline, id, timer.serial });
+  std::push_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+}
+
+void EpollEventDispatcher::armTimerFd() {
+  // Drop outdated entries from top, so timerfd is armed to live timer only
+  while (!heap_.empty()) {
+    const HeapEntry& top = heap_.front();
+    auto it = timers_.constFind(top.id);
+    if (it != timers_.constEnd() && it->serial == top.serial) break;
+    std::pop_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+    heap_.pop_back();
+  }
+  const qint64 deadline = heap_.empty() ? -1 : qMax<qint64>(1, heap_.front().deadline);
+  if (deadline == armed_deadline_) return;
+  struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+  if (deadline >= 0) {
+    spec.it_value.tv_sec = deadline / 1000;
+    spec.it_value.tv_nsec = (deadline % 1000) * 1000000;
+  }
+  timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+  armed_deadline_ = deadline;
+}
+
+void EpollEventDispatcher::compactHeap() {
+  if (heap_.size() <= size_t(timers_.size()) * 2 + 64) return;
+  heap_.clear();
+  for (auto it = timers_.constBegin(); it != timers_.constEnd(); ++it) {
+    heap_.push_back(HeapEntry{ it->deadline, it.key(), it->serial });
+  }
+  std::make_heap(heap_.begin(), heap_.end(), std::greater<HeapEntry>());
+}
+
+int EpollEventDispatcher::waitTimeout(bool can_wait) {
+  // Timers are watched by timerfd, so blocking wait needs no timeout
+  return can_wait ? -1 : 0;
+}
+
+void EpollEventDispatcher::wakeUp() {
+  // Called from any thread, e.g. by QCoreApplication::postEvent()
+  if (wakeup_pending_.exchange(true)) return;
+  eventfd_write(event_fd_, 1);
+}
+
+void EpollEventDispatcher::interrupt() {
+  interrupted_ = true;
+  wakeUp();
+}
+
+void EpollEventDispatcher::flush() {
+}
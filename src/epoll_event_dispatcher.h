@@ -0,0 +1,91 @@
+#pragma once
+
+#include <QAbstractEventDispatcher>
+#include <QHash>
+#include <QList>
+#include <QSocketNotifier>
+#include <atomic>
+#include <vector>
+
+// Event dispatcher of the main thread based on epoll, timerfd and eventfd.
+// Descriptors stay registered in kernel between loop iterations and are
+// watched in edge-triggered mode; all timers share one timerfd armed to the
+// earliest deadline, so expired timers are delivered in one batch.
+class EpollEventDispatcher : public QAbstractEventDispatcher {
+  Q_OBJECT
+ public:
+  struct Stats {
+    quint64 iterations;      // processEvents() calls
+    quint64 waits;           // epoll_wait() calls which were allowed to block
+    quint64 wakeups;         // wakeUp() calls which reached eventfd
+    quint64 socket_events;   // activated socket notifiers
+    quint64 rechecks;        // notifiers activated again without new edge
+    quint64 timer_events;    // delivered timer events
+    quint64 timer_batches;   // timerfd expirations
+    quint64 max_timer_batch; // most timer events delivered in one batch
+  };
+
+  explicit EpollEventDispatcher(QObject *parent = 0);
+  ~EpollEventDispatcher();
+
+  bool processEvents(QEventLoop::ProcessEventsFlags flags) override;
+  bool hasPendingEvents() override;
+
+  void registerSocketNotifier(QSocketNotifier *notifier) override;
+  void unregisterSocketNotifier(QSocketNotifier *notifier) override;
+
+  void registerTimer(int timerId, int interval, Qt::TimerType timerType, QObject *object) override;
+  bool unregisterTimer(int timerId) override;
+  bool unregisterTimers(QObject *object) override;
+  QList<TimerInfo> registeredTimers(QObject *object) const override;
+  int remainingTime(int timerId) override;
+
+  void wakeUp() override;
+  void interrupt() override;
+  void flush() override;
+
+  const Stats& stats() const { return stats_; }
+  int socketCount() const { return sockets_.size(); }
+  int timerCount() const { return timers_.size(); }
+
+ private:
+  struct Socket {
+    QSocketNotifier *notifiers[3] = { nullptr, nullptr, nullptr }; // by QSocketNotifier::Type
+    quint32 events = 0;                                            // mask registered in epoll
+  };
+  struct Timer {
+    int interval;
+    Qt::TimerType type;
+    QObject *object;
+    qint64 deadline;
+    quint32 serial;   // matches heap entry which is still valid
+    bool active;      // timer event is being delivered
+  };
+  struct HeapEntry {
+    qint64 deadline;
+    int id;
+    quint32 serial;
+    bool operator>(const HeapEntry& other) const { return deadline > other.deadline; }
+  };
+
+  void updateSocket(int fd);
+  bool activateNotifier(QSocketNotifier *notifier);
+  int activateTimers();
+  void scheduleTimer(int id, Timer& timer, qint64 deadline);
+  void armTimerFd();
+  void compactHeap();
+  int waitTimeout(bool can_wait);
+
+  int epoll_fd_;
+  int event_fd_;
+  int timer_fd_;
+  qint64 armed_deadline_;
+  std::atomic<bool> interrupted_;
+  std::atomic<bool> wakeup_pending_;
+  QHash<int, Socket> sockets_;
+  QList<QSocketNotifier*> ready_;   // still ready after activation
+  QList<QSocketNotifier*> pending_; // being activated in this iteration
+  QHash<int, Timer> timers_;
+  std::vector<HeapEntry> heap_;
+  Stats stats_;
+};
@@ -0,0 +1,392 @@
+#include "ford_protocol.h"
+
+#include <string.h>
+#include <vector>
+
+namespace {
+const int kHeaderSize = 12;
+const int kRpcHeaderSize = 12;
+const int kFirstFramePayloadSize = 8;
+const int kControlFrame = 0x00;
+const int kFirstFrame = 0x02;
+const int kConsecutiveFrame = 0x03;
+const int kRpcService = 0x07;
+const int kBulkDataService = 0x0F;
+
+void int32ToBytes(char *p, unsigned int val) {
+  p[0] = char(val >> 24);
+  p[1] = char(val >> 16);
+  p[2] = char(val >> 8);
+  p[3] = char(val);
+}
+
+unsigned int bytesToInt32(const void *data) {
+  const unsigned char *p = static_cast<const unsigned char*>(data);
+  return (static_cast<unsigned int>(p[0]) << 24) | (static_cast<unsigned int>(p[1]) << 16) |
+         (static_cast<unsigned int>(p[2]) << 8) | static_cast<unsigned int>(p[3]);
+}
+
+// Reads integer field of message table at index 1, missing field is 0
+unsigned int field(lua_State* L, const char *name) {
+  lua_getfield(L, 1, name);
+  unsigned int res = static_cast<unsigned int>(lua_tointegerx(L, -1, NULL));
+  lua_pop(L, 1);
+  return res;
+}
+
+struct Header {
+  unsigned int version;
+  bool encryption;
+  unsigned int service_type;
+  unsigned int session_id;
+  unsigned int message_id;
+
+  void write(char *p, unsigned int frame_type, unsigned int frame_info, unsigned int size) const {
+    p[0] = char((version << 4) | (encryption ? 0x08 : 0) | (frame_type & 0x07));
+    p[1] = char(service_type);
+    p[2] = char(frame_info);
+    p[3] = char(session_id);
+    int32ToBytes(p + 4, size);
+    int32ToBytes(p + 8, message_id);
+  }
+};
+
+// Payload of message is a sequence of segments (rpc header, json, binary data),
+// which are copied to frames without joining them first
+struct Segment {
+  const char *data;
+  size_t size;
+};
+
+size_t gather(const std::vector<Segment>& segments, size_t& segment, size_t& offset,
+              char *dst, size_t size) {
+  size_t copied = 0;
+  while (copied < size && segment < segments.size()) {
+    const Segment& s = segments[segment];
+    size_t n = s.size - offset;
+    if (n > size - copied) n = size - copied;
+    memcpy(dst + copied, s.data + offset, n);
+    copied += n;
+    offset += n;
+    if (offset == s.size) {
+      ++segment;
+      offset = 0;
+    }
+  }
+  return copied;
+}
+
+// compose(message, max_payload_size)
+// Returns table with frames of message, see ProtocolHandler:Compose
+int ford_protocol_compose(lua_State* L) {
+  luaL_checktype(L, 1, LUA_TTABLE);
+  const lua_Integer max_payload_arg = luaL_optinteger(L, 2, 1488);
+  luaL_argcheck(L, max_payload_arg > 0, 2, "max payload size must be positive");
+  const size_t max_payload = static_cast<size_t>(max_payload_arg);
+
+  Header header;
+  header.version = field(L, "version");
+  lua_getfield(L, 1, "encryption");
+  header.encryption = lua_toboolean(L, -1);
+  lua_pop(L, 1);
+  header.service_type = field(L, "serviceType");
+  header.session_id = field(L, "sessionId");
+  header.message_id = field(L, "messageId");
+  const unsigned int frame_type = field(L, "frameType");
+  const unsigned int frame_info = field(L, "frameInfo");
+
+  // Strings stay referenced by message table during the call
+  std::vector<Segment> segments;
+  size_t payload_size = 0;
+  char rpc_header[kRpcHeaderSize];
+  lua_getfield(L, 1, "payload");
+  size_t json_size = 0;
+  const char *json = lua_tolstring(L, -1, &json_size);
+  lua_pop(L, 1);
+  if (json && frame_type != kControlFrame &&
+      (header.service_type == kRpcService || header.service_type == kBulkDataService)) {
+    const unsigned int function_id = field(L, "rpcFunctionId");
+    rpc_header[0] = char((field(L, "rpcType") << 4) + ((function_id >> 24) & 0x0f));
+    rpc_header[1] = char(function_id >> 16);
+    rpc_header[2] = char(function_id >> 8);
+    rpc_header[3] = char(function_id);
+    int32ToBytes(rpc_header + 4, field(L, "rpcCorrelationId"));
+    int32ToBytes(rpc_header + 8, json_size);
+    segments.push_back({ rpc_header, kRpcHeaderSize });
+    segments.push_back({ json, json_size });
+    payload_size += kRpcHeaderSize + json_size;
+  }
+  lua_getfield(L, 1, "binaryData");
+  size_t binary_size = 0;
+  const char *binary = lua_tolstring(L, -1, &binary_size);
+  lua_pop(L, 1);
+  if (binary) {
+    segments.push_back({ binary, binary_size });
+    payload_size += binary_size;
+  }
+
+  size_t segment = 0;
+  size_t offset = 0;
+  if (payload_size <= max_payload) {
+    // Single frame (also control frames)
+    std::vector<char> frame(kHeaderSize + payload_size);
+    header.write(frame.data(), frame_type, frame_info, payload_size);
+    gather(segments, segment, offset, frame.data() + kHeaderSize, payload_size);
+    lua_createtable(L, 1, 0);
+    lua_pushlstring(L, frame.data(), frame.size());
+    lua_rawseti(L, -2, 1);
+    return 1;
+  }
+
+  const size_t frames = (payload_size + max_payload - 1) / max_payload;
+  lua_createtable(L, frames + 1, 0);
+  // One buffer is reused for all frames
+  std::vector<char> frame(kHeaderSize + max_payload);
+
+  header.write(frame.data(), kFirstFrame, 0, kFirstFramePayloadSize);
+  int32ToBytes(frame.data() + kHeaderSize, payload_size);
+  int32ToBytes(frame.data() + kHeaderSize + 4, frames);
+  lua_pushlstring(L, frame.data(), kHeaderSize + kFirstFramePayloadSize);
+  lua_rawseti(L, -2, 1);
+
+  for (size_t i = 1; i <= frames; ++i) {
+    // frame info range is [1 - 255], 0 means last frame
+    const unsigned int info = i == frames ? 0 : ((i - 1) % 255) + 1;
+    const size_t size = gather(segments, segment, offset, frame.data() + kHeaderSize, max_payload);
+    header.write(frame.data(), kConsecutiveFrame, info, size);
+    lua_pushlstring(L, frame.data(), kHeaderSize + size);
+    lua_rawseti(L, -2, i + 1);
+  }
+  return 1;
+}
+
+// Parsed message is a userdata holding frame header and complete payload.
+// Header fields are read from bytes on access, JSON payload is decoded on
+// the first access to 'payload'. Assigned fields and decoded payload are
+// kept in uservalue table, which is created on demand.
+const char *kMessageMetatable = "ford_protocol.Message";
+const char *kDecoderKey = "ford_protocol.decoder";
+
+struct Message {
+  unsigned char header[kHeaderSize];
+  bool decode_json;
+  bool payload_set;   // payload is decoded or assigned, uservalue holds it
+  size_t size;        // size of payload, bytes follow the structure
+
+  const char *payload() const { return reinterpret_cast<const char*>(this + 1); }
+  unsigned int frame_type() const { return header[0] & 0x07; }
+  unsigned int service_type() const { return header[1]; }
+  bool is_rpc() const {
+    return frame_type() != kControlFrame && size >= kRpcHeaderSize &&
+      (service_type() == kRpcService || service_type() == kBulkDataService);
+  }
+  size_t json_size() const {
+    const size_t json = bytesToInt32(payload() + 8);
+    return json < size - kRpcHeaderSize ? json : size - kRpcHeaderSize;
+  }
+};
+
+Message *check_message(lua_State *L, int index) {
+  return static_cast<Message*>(luaL_checkudata(L, index, kMessageMetatable));
+}
+
+// Pushes uservalue table of message at index 1, creates it if needed
+void push_uservalue(lua_State *L) {
+  lua_getuservalue(L, 1);
+  if (lua_istable(L, -1)) return;
+  lua_pop(L, 1);
+  lua_newtable(L);
+  lua_pushvalue(L, -1);
+  lua_setuservalue(L, 1);
+}
+
+// Pushes value of field computed from message bytes, returns false if message has no such field
+bool push_field(lua_State *L, Message *m, const char *key) {
+  const unsigned char *h = m->header;
+  if (strcmp(key, "version") == 0) {
+    lua_pushinteger(L, h[0] >> 4);
+  } else if (strcmp(key, "frameType") == 0) {
+    lua_pushinteger(L, m->frame_type());
+  } else if (strcmp(key, "encryption") == 0) {
+    lua_pushboolean(L, (h[0] & 0x08) != 0);
+  } else if (strcmp(key, "serviceType") == 0) {
+    lua_pushinteger(L, m->service_type());
+  } else if (strcmp(key, "frameInfo") == 0) {
+    lua_pushinteger(L, h[2]);
+  } else if (strcmp(key, "sessionId") == 0) {
+    lua_pushinteger(L, h[3]);
+  } else if (strcmp(key, "size") == 0) {
+    lua_pushnumber(L, bytesToInt32(h + 4));
+  } else if (strcmp(key, "messageId") == 0) {
+    lua_pushnumber(L, bytesToInt32(h + 8));
+  } else if (strcmp(key, "binaryData") == 0) {
+    if (m->is_rpc()) {
+      const size_t offset = kRpcHeaderSize + m->json_size();
+      lua_pushlstring(L, m->payload() + offset, m->size - offset);
+    } else {
+      lua_pushlstring(L, m->payload(), m->size);
+    }
+  } else if (!m->is_rpc()) {
+    return false;
+  } else if (strcmp(key, "rpcType") == 0) {
+    lua_pushinteger(L, static_cast<unsigned char>(m->payload()[0]) >> 4);
+  } else if (strcmp(key, "rpcFunctionId") == 0) {
+    lua_pushnumber(L, bytesToInt32(m->payload()) & 0x0fffffff);
+  } else if (strcmp(key, "rpcCorrelationId") == 0) {
+    lua_pushnumber(L, bytesToInt32(m->payload() + 4));
+  } else if (strcmp(key, "rpcJsonSize") == 0) {
+    lua_pushnumber(L, bytesToInt32(m->payload() + 8));
+  } else if (strcmp(key, "rawPayload") == 0) {
+    if (m->json_size() == 0) return false;
+    lua_pushlstring(L, m->payload() + kRpcHeaderSize, m->json_size());
+  } else if (strcmp(key, "payload") == 0) {
+    if (!m->decode_json || m->json_size() == 0) return false;
+    lua_getfield(L, LUA_REGISTRYINDEX, kDecoderKey);
+    if (lua_isnil(L, -1)) return false;
+    lua_pushlstring(L, m->payload() + kRpcHeaderSize, m->json_size());
+    lua_call(L, 1, 1);
+    // Decoded payload is cached, so expectations share the same table
+    push_uservalue(L);
+    lua_pushvalue(L, -2);
+    lua_setfield(L, -2, "payload");
+    lua_pop(L, 1);
+    m->payload_set = true;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// message(data, position, [payload], [decode_json])
+// Header is taken from data at position (1-based), payload is either given
+// (reassembled multi-frame message) or follows the header in data
+int ford_protocol_message(lua_State* L) {
+  size_t data_size = 0;
+  const char *data = luaL_checklstring(L, 1, &data_size);
+  const size_t position = luaL_checkinteger(L, 2) - 1;
+  luaL_argcheck(L, position + kHeaderSize <= data_size, 2, "no frame header at position");
+  const unsigned char *header = reinterpret_cast<const unsigned char*>(data + position);
+  const char *payload = data + position + kHeaderSize;
+  size_t payload_size = bytesToInt32(header + 4);
+  if (!lua_isnoneornil(L, 3)) {
+    payload = luaL_checklstring(L, 3, &payload_size);
+  } else {
+    luaL_argcheck(L, position + kHeaderSize + payload_size <= data_size, 2, "frame is incomplete");
+  }
+  const bool decode_json = lua_isnone(L, 4) || lua_toboolean(L, 4);
+
+  Message *m = static_cast<Message*>(lua_newuserdata(L, sizeof(Message) + payload_size));
+  memcpy(m->header, header, kHeaderSize);
+  m->decode_json = decode_json;
+  m->payload_set = false;
+  m->size = payload_size;
+  memcpy(m + 1, payload, payload_size);
+  luaL_setmetatable(L, kMessageMetatable);
+  return 1;
+}
+
+// set_decoder(func)
+// Function which decodes JSON payload of messages
+int ford_protocol_set_decoder(lua_State* L) {
+  if (!lua_isnil(L, 1)) luaL_checktype(L, 1, LUA_TFUNCTION);
+  lua_settop(L, 1);
+  lua_setfield(L, LUA_REGISTRYINDEX, kDecoderKey);
+  return 0;
+}
+
+int message_index(lua_State* L) {/*{{{*/
+  Message *m = check_message(L, 1);
+  lua_getuservalue(L, 1);
+  if (lua_istable(L, -1)) {
+    lua_pushvalue(L, 2);
+    lua_rawget(L, -2);
+    if (!lua_isnil(L, -1)) return 1;
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 1);
+  const char *key = lua_tostring(L, 2);
+  if (!key || lua_type(L, 2) != LUA_TSTRING) return 0;
+  if (strcmp(key, "payload") == 0 && m->payload_set) return 0;
+  return push_field(L, m, key) ? 1 : 0;
+}/*}}}*/
+
+int message_newindex(lua_State* L) {/*{{{*/
+  Message *m = check_message(L, 1);
+  if (lua_type(L, 2) == LUA_TSTRING && strcmp(lua_tostring(L, 2), "payload") == 0) {
+    m->payload_set = true;
+  }
+  push_uservalue(L);
+  lua_pushvalue(L, 2);
+  lua_pushvalue(L, 3);
+  lua_rawset(L, -3);
+  return 0;
+}/*}}}*/
+
+int message_next(lua_State* L) {/*{{{*/
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_settop(L, 2);
+  if (lua_next(L, 1)) return 2;
+  lua_pushnil(L);
+  return 1;
+}/*}}}*/
+
+// Iterates over snapshot table of all fields, so generic code
+// (comparison, dumping to report) sees message as a plain table
+int message_pairs(lua_State* L) {/*{{{*/
+  check_message(L, 1);
+  static const char *kFields[] = {
+    "version", "frameType", "encryption", "serviceType", "frameInfo", "sessionId",
+    "size", "messageId", "rpcType", "rpcFunctionId", "rpcCorrelationId", "rpcJsonSize",
+    "payload", "binaryData", NULL
+  };
+  lua_pushcfunction(L, &message_next);
+  lua_newtable(L);
+  const int snapshot = lua_gettop(L);
+  for (const char **key = kFields; *key; ++key) {
+    lua_pushstring(L, *key);
+    lua_gettable(L, 1);
+    lua_setfield(L, snapshot, *key);
+  }
+  lua_getuservalue(L, 1);
+  if (lua_istable(L, -1)) {
+    lua_pushnil(L);
+    while (lua_next(L, -2)) {
+      lua_pushvalue(L, -2);
+      lua_insert(L, -2);
+      lua_rawset(L, snapshot);
+    }
+  }
+  lua_settop(L, snapshot);
+  lua_pushnil(L);
+  return 3;
+}/*}}}*/
+
+int message_tostring(lua_State* L) {/*{{{*/
+  Message *m = check_message(L, 1);
+  lua_pushfstring(L, "ford_protocol.Message(service %d, frame type %d, %d bytes)",
+                  int(m->service_type()), int(m->frame_type()), int(m->size));
+  return 1;
+}/*}}}*/
+}  // anonymous namespace
+
+int luaopen_ford_protocol(lua_State* L) {
+  luaL_newmetatable(L, kMessageMetatable);
+  const luaL_Reg message_functions [] = {
+    {"__index", message_index},
+    {"__newindex", message_newindex},
+    {"__pairs", message_pairs},
+    {"__tostring", message_tostring},
+    {NULL, NULL}
+  };
+  luaL_setfuncs(L, message_functions, 0);
+  lua_pop(L, 1);
+
+  const luaL_Reg ford_protocol_lib [] = {
+    {"compose", ford_protocol_compose},
+    {"message", ford_protocol_message},
+    {"set_decoder", ford_protocol_set_decoder},
+    {NULL, NULL}
+  };
+  luaL_newlib(L, ford_protocol_lib);
+  return 1;
+}
@@ -0,0 +1,193 @@
+#include "heartbeat_service.h"
+#include "io_thread_socket.h"
+
+#include <QList>
+#include <limits>
+
+namespace {
+// Ford protocol values, see protocol_handler/ford_protocol_constants.lua
+const int kHeaderSize = 12;
+const int kHeaderSizeV1 = 8;
+const quint8 kControlFrame = 0x00;
+const quint8 kControlService = 0x00;
+const quint8 kHeartbeat = 0x00;
+const quint8 kHeartbeatAck = 0xFF;
+
+// Protocol version 1 frames have no message id
+int headerSize(quint8 first_byte) {
+  return (first_byte >> 4) == 1 ? kHeaderSizeV1 : kHeaderSize;
+}
+
+quint32 bytesToInt32(const char *p) {
+  const uchar *u = reinterpret_cast<const uchar*>(p);
+  return (quint32(u[0]) << 24) | (quint32(u[1]) << 16) |
+         (quint32(u[2]) << 8) | quint32(u[3]);
+}
+}
+
+HeartbeatService::HeartbeatService(QTcpSocket *socket, QObject *parent)
+  : QObject(parent),
+    socket_(socket) {
+  timer_.setSingleShot(true);
+  connect(&timer_, SIGNAL(timeout()), this, SLOT(onTimer()));
+  // Stream of new connection starts with a frame header
+  connect(socket, SIGNAL(connected()), this, SLOT(reset()));
+  clock_.start();
+}
+
+HeartbeatService::HeartbeatService(IoThreadSocket *socket, QObject *parent)
+  : QObject(parent),
+    io_socket_(socket) {
+  timer_.setSingleShot(true);
+  connect(&timer_, SIGNAL(timeout()), this, SLOT(onTimer()));
+  connect(socket, SIGNAL(connected()), this, SLOT(reset()));
+  clock_.start();
+}
+
+void HeartbeatService::reset() {
+  header_.clear();
+  skip_ = 0;
+}
+
+void HeartbeatService::start(int session_id, int version, int interval_ms, int timeout_ms) {
+  Session session;
+  session.version = version;
+  session.interval = interval_ms;
+  session.timeout = timeout_ms;
+  session.send = true;
+  session.answer = true;
+  session.ignore_ack = false;
+  session.watching = true;
+  session.next_send = clock_.elapsed() + interval_ms;
+  session.deadline = clock_.elapsed() + timeout_ms;
+  session.message_id = 0;
+  sessions_.insert(session_id, session);
+  schedule();
+}
+
+void HeartbeatService::stop(int session_id) {
+  sessions_.remove(session_id);
+  schedule();
+}
+
+void HeartbeatService::setFlags(int session_id, bool send, bool answer, bool ignore_ack) {
+  auto it = sessions_.find(session_id);
+  if (it == sessions_.end()) return;
+  it->send = send;
+  it->answer = answer;
+  it->ignore_ack = ignore_ack;
+  schedule();
+}
+
+void HeartbeatService::setInterval(int session_id, int interval_ms, int timeout_ms) {
+  auto it = sessions_.find(session_id);
+  if (it == sessions_.end()) return;
+  const qint64 now = clock_.elapsed();
+  it->interval = interval_ms;
+  it->timeout = timeout_ms;
+  it->next_send = now + interval_ms;
+  if (it->watching) it->deadline = now + timeout_ms;
+  schedule();
+}
+
+void HeartbeatService::input(const QByteArray& data) {
+  // Only frame headers are buffered, payloads are skipped
+  const qint64 now = clock_.elapsed();
+  const char *p = data.constData();
+  qint64 left = data.size();
+  while (left > 0) {
+    if (skip_ > 0) {
+      const qint64 n = qMin<qint64>(skip_, left);
+      skip_ -= n;
+      p += n;
+      left -= n;
+      continue;
+    }
+    // Size of header is known from version in its first byte
+    const int size = headerSize(quint8(header_.isEmpty() ? *p : header_[0]));
+    const int n = int(qMin<qint64>(size - header_.size(), left));
+    header_.append(p, n);
+    p += n;
+    left -= n;
+    if (header_.size() < size) break;
+    onFrame(header_.constData(), now);
+    skip_ = bytesToInt32(header_.constData() + 4);
+    header_.clear();
+  }
+  schedule();
+}
+
+void HeartbeatService::onFrame(const char *header, qint64 now) {
+  const quint8 frame_type = quint8(header[0]) & 0x07;
+  const quint8 service_type = quint8(header[1]);
+  const quint8 frame_info = quint8(header[2]);
+  const int session_id = quint8(header[3]);
+  auto it = sessions_.find(session_id);
+  if (it == sessions_.end()) return;
+
+  const bool control = frame_type == kControlFrame;
+  if (control && service_type == kControlService && frame_info == kHeartbeat
+      && it->answer) {
+    sendControlFrame(session_id, *it, kHeartbeatAck);
+  }
+  if (control && frame_info == kHeartbeatAck && it->ignore_ack) return;
+  if (it->watching) it->deadline = now + it->timeout;
+}
+
+void HeartbeatService::onTimer() {
+  const qint64 now = clock_.elapsed();
+  QList<int> expired;
+  for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+    if (it->next_send <= now) {
+      if (it->send) sendControlFrame(it.key(), *it, kHeartbeat);
+      it->next_send = now + it->interval;
+    }
+    if (it->watching && it->deadline <= now) {
+      it->watching = false;
+      expired.append(it.key());
+    }
+  }
+  schedule();
+  // Handlers may stop sessions, so signals are emitted after the loop
+  for (int session_id : expired) {
+    emit heartbeatTimeout(session_id);
+  }
+}
+
+void HeartbeatService::sendControlFrame(int session_id, Session& session, quint8 frame_info) {
+  if (!isConnected()) return;
+  const quint32 message_id = ++session.message_id;
+  char frame[kHeaderSize] = {
+    char((session.version << 4) | kControlFrame),
+    char(kControlService),
+    char(frame_info),
+    char(session_id),
+    0, 0, 0, 0, // payload size
+    char(message_id >> 24), char(message_id >> 16),
+    char(message_id >> 8), char(message_id)
+  };
+  const int size = session.version == 1 ? kHeaderSizeV1 : kHeaderSize;
+  if (io_socket_) {
+    io_socket_->write(QByteArray(frame, size));
+  } else {
+    socket_->write(frame, size);
+  }
+}
+
+bool HeartbeatService::isConnected() const {
+  if (io_socket_) return io_socket_->isConnected();
+  return socket_ && socket_->state() == QAbstractSocket::ConnectedState;
+}
+
+void HeartbeatService::schedule() {
+  qint64 next = std::numeric_limits<qint64>::max();
+  for (auto it = sessions_.constBegin(); it != sessions_.constEnd(); ++it) {
+    next = qMin(next, it->next_send);
+    if (it->watching) next = qMin(next, it->deadline);
+  }
+  if (next == std::numeric_limits<qint64>::max()) {
+    timer_.stop();
+    return;
+  }
+  timer_.start(int(qMax<qint64>(0, next - clock_.elapsed())));
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTcpSocket>
+
+class IoThreadSocket;
+
+// Heartbeat service emulates mobile side heartbeat for all sessions of one
+// mobile connection. Control frames are parsed and written in native code,
+// Lua is notified only when SDL stays silent longer than session timeout.
+// Connection served by I/O thread gets control frames through its write queue.
+class HeartbeatService : public QObject {
+  Q_OBJECT
+ public:
+  explicit HeartbeatService(QTcpSocket *socket, QObject *parent = 0);
+  explicit HeartbeatService(IoThreadSocket *socket, QObject *parent = 0);
+  // Starts heartbeat of session: HEARTBEAT is sent every interval_ms,
+  // heartbeatTimeout() is emitted if SDL sends nothing during timeout_ms
+  void start(int session_id, int version, int interval_ms, int timeout_ms);
+  void stop(int session_id);
+  void setFlags(int session_id, bool send, bool answer, bool ignore_ack);
+  void setInterval(int session_id, int interval_ms, int timeout_ms);
+  int sessions() const { return sessions_.size(); }
+ public slots:
+  // Bytes received from SDL on the connection
+  void input(const QByteArray& data);
+  // Drops partially received frame, called when socket is (re)connected
+  void reset();
+ signals:
+  void heartbeatTimeout(int session_id);
+ private slots:
+  void onTimer();
+ private:
+  struct Session {
+    int version;
+    int interval;
+    int timeout;
+    bool send;
+    bool answer;
+    bool ignore_ack;
+    bool watching;
+    qint64 next_send;
+    qint64 deadline;
+    quint32 message_id;
+  };
+  void onFrame(const char *header, qint64 now);
+  void sendControlFrame(int session_id, Session& session, quint8 frame_info);
+  void schedule();
+  bool isConnected() const;
+
+  QPointer<QTcpSocket> socket_;
+  QPointer<IoThreadSocket> io_socket_;
+  QHash<int, Session> sessions_;
+  QByteArray header_;
+  quint32 skip_ = 0;
+  QTimer timer_;
+  QElapsedTimer clock_;
+};
@@ -0,0 +1,451 @@
+#include "interp_server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <iostream>
+#include <vector>
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+
+#include <QCoreApplication>
+#include "lua_interpreter.h"
+#include "epoll_event_dispatcher.h"
+
+namespace {
+const int kClientFds = 3;
+const size_t kMaxRequestSize = 1024 * 1024;
+const int kRequestTimeoutMs = 5000;
+
+volatile sig_atomic_t stop_requested = 0;
+// Self-pipe which wakes server up when child exits
+int child_pipe[2] = { -1, -1 };
+
+void stop_handler(int) {
+  stop_requested = 1;
+}
+
+void child_handler(int) {
+  const int saved_errno = errno;
+  const char c = 0;
+  if (write(child_pipe[1], &c, 1) < 0) {
+    // pipe is full, server is woken up anyway
+  }
+  errno = saved_errno;
+}
+
+void set_handler(int signal, void (*handler)(int)) {
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handler;
+  sigemptyset(&sa.sa_mask);
+  sigaction(signal, &sa, NULL);
+}
+
+bool write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    const ssize_t n = write(fd, data, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool write_line(int fd, const QByteArray& line) {
+  const QByteArray data = line + '\n';
+  return write_all(fd, data.constData(), data.size());
+}
+
+void close_fds(int *fds) {
+  for (int i = 0; i < kClientFds; ++i) {
+    if (fds[i] >= 0) close(fds[i]);
+    fds[i] = -1;
+  }
+}
+
+// Reads request strings, descriptors of the client are taken from the first chunk
+bool read_request(int conn, QStringList *strings, int *fds) {
+  QByteArray data;
+  int count = -1;
+  int pos = 0;
+  while (count < 0 || strings->count() < count) {
+    struct pollfd p = { conn, POLLIN, 0 };
+    if (poll(&p, 1, kRequestTimeoutMs) <= 0) return false;
+    char buffer[4096];
+    struct iovec iov = { buffer, sizeof(buffer) };
+    union {
+      char buf[CMSG_SPACE(sizeof(int) * kClientFds)];
+      struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    const ssize_t n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+      if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+      const int received = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      const int *received_fds = reinterpret_cast<const int*>(CMSG_DATA(c));
+      for (int i = 0; i < received; ++i) {
+        if (i < kClientFds && fds[i] < 0) {
+          fds[i] = received_fds[i];
+        } else {
+          close(received_fds[i]);
+        }
+      }
+    }
+    data.append(buffer, n);
+    if (size_t(data.size()) > kMaxRequestSize) return false;
+    int end;
+    while ((end = data.indexOf('\0', pos)) >= 0) {
+      const QByteArray item = data.mid(pos, end - pos);
+      pos = end + 1;
+      if (count < 0) {
+        bool ok = false;
+        count = item.toInt(&ok);
+        if (!ok || count < 2) return false;
+      } else {
+        strings->append(QString::fromUtf8(item));
+      }
+    }
+  }
+  for (int i = 0; i < kClientFds; ++i) {
+    if (fds[i] < 0) return false;
+  }
+  return true;
+}
+
+bool stat_file(const QByteArray& path, qint64 *mtime_ns, qint64 *size) {
+  struct stat st;
+  if (stat(path.constData(), &st) != 0) return false;
+  *mtime_ns = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  *size = st.st_size;
+  return true;
+}
+}  // anonymous namespace
+
+InterpServer::InterpServer(const char *exe, const QString& warmup,
+                           const QString& bytecode_cache_dir, bool epoll_dispatcher)
+  : exe_(exe),
+    warmup_(warmup),
+    bytecode_cache_dir_(bytecode_cache_dir),
+    epoll_dispatcher_(epoll_dispatcher),
+    interp_(nullptr),
+    warm_ref_(LUA_NOREF),
+    listen_fd_(-1) {
+  char cwd[PATH_MAX];
+  if (getcwd(cwd, sizeof(cwd))) cwd_ = cwd;
+}
+
+InterpServer::~InterpServer() {
+  delete interp_;
+  if (listen_fd_ >= 0) close(listen_fd_);
+}
+
+// Creates Lua state and runs warm-up script. No QCoreApplication exists in
+// server process, it has no threads when it forks
+bool InterpServer::warmUp() {
+  delete interp_;
+  files_.clear();
+  QStringList no_args;
+  interp_ = new LuaInterpreter(nullptr, no_args.begin(), no_args.end());
+  if (!bytecode_cache_dir_.isEmpty() && !interp_->enableBytecodeCache(bytecode_cache_dir_)) {
+    return false;
+  }
+  lua_State *L = interp_->state();
+  if (luaL_dofile(L, warmup_.toUtf8().constData()) != 0) {
+    std::cerr << "Lua error:" << std::endl << lua_tostring(L, -1) << std::endl;
+    return false;
+  }
+  if (!lua_istable(L, -1)) {
+    std::cerr << "Warm-up script " << warmup_.toStdString() << " has to return table" << std::endl;
+    return false;
+  }
+  lua_getfield(L, -1, "files");
+  if (lua_istable(L, -1)) {
+    const int n = lua_rawlen(L, -1);
+    for (int i = 1; i <= n; ++i) {
+      lua_rawgeti(L, -1, i);
+      WatchedFile file;
+      file.path = lua_tostring(L, -1);
+      file.mtime_ns = file.size = -1;
+      stat_file(file.path, &file.mtime_ns, &file.size);
+      files_.append(file);
+      lua_pop(L, 1);
+    }
+  }
+  lua_pop(L, 1);
+  warm_ref_ = luaL_ref(L, LUA_REGISTRYINDEX);
+  return true;
+}
+
+bool InterpServer::isStale() const {
+  for (const WatchedFile& file : files_) {
+    qint64 mtime_ns = -1, size = -1;
+    stat_file(file.path, &mtime_ns, &size);
+    if (mtime_ns != file.mtime_ns || size != file.size) return true;
+  }
+  return false;
+}
+
+int InterpServer::run(const char *socket_path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+    std::cerr << "Socket path is too long: " << socket_path << std::endl;
+    return 1;
+  }
+  strcpy(addr.sun_path, socket_path);
+
+  if (!warmUp()) return 1;
+
+  if (pipe2(child_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+    perror("pipe");
+    return 1;
+  }
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  unlink(socket_path);
+  if (listen_fd_ < 0 ||
+      bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(listen_fd_, 16) != 0) {
+    perror(socket_path);
+    return 1;
+  }
+  // Handlers are installed without SA_RESTART, so accept() is interrupted by stop signals
+  set_handler(SIGINT, &stop_handler);
+  set_handler(SIGTERM, &stop_handler);
+  set_handler(SIGCHLD, &child_handler);
+  set_handler(SIGPIPE, SIG_IGN);
+  std::cout << "Serving " << socket_path << std::endl;
+
+  while (!stop_requested) {
+    const int conn = accept4(listen_fd_, NULL, NULL, SOCK_CLOEXEC);
+    if (conn < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      perror("accept");
+      break;
+    }
+    serve(conn);
+    close(conn);
+  }
+  unlink(socket_path);
+  return 0;
+}
+
+void InterpServer::serve(int conn) {
+  QStringList strings;
+  int fds[kClientFds] = { -1, -1, -1 };
+  if (!read_request(conn, &strings, fds)) {
+    close_fds(fds);
+    return;
+  }
+  const QByteArray cwd = strings.takeFirst().toUtf8();
+  if (cwd != cwd_) {
+    // Modules which are not warm would be loaded from other folder
+    const QByteArray error = "Interpreter server runs in " + cwd_ + ", client in " + cwd + "\n";
+    write_all(fds[2], error.constData(), error.size());
+    close_fds(fds);
+    write_line(conn, "exit 1");
+    return;
+  }
+  if (isStale()) {
+    std::cout << "Warm-up files are modified, reloading " << warmup_.toStdString() << std::endl;
+    if (!warmUp()) {
+      close_fds(fds);
+      write_line(conn, "exit 1");
+      stop_requested = 1;
+      return;
+    }
+  }
+
+  // Data buffered by server must not be written by child
+  fflush(stdout);
+  fflush(stderr);
+  char c;
+  while (read(child_pipe[0], &c, 1) > 0) { }
+  const pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    close_fds(fds);
+    write_line(conn, "exit 1");
+    return;
+  }
+  if (pid == 0) {
+    close(listen_fd_);
+    close(child_pipe[0]);
+    close(child_pipe[1]);
+    set_handler(SIGINT, SIG_DFL);
+    set_handler(SIGTERM, SIG_DFL);
+    set_handler(SIGCHLD, SIG_DFL);
+    set_handler(SIGPIPE, SIG_DFL);
+    for (int i = 0; i < kClientFds; ++i) {
+      dup2(fds[i], i);
+    }
+    close_fds(fds);
+    _exit(runChild(conn, strings));
+  }
+  close_fds(fds);
+  write_line(conn, "exit " + QByteArray::number(waitChild(conn, pid)));
+}
+
+int InterpServer::runChild(int conn, const QStringList& args) {
+  std::vector<QByteArray> storage;
+  storage.push_back(exe_);
+  for (const QString& arg : args) {
+    storage.push_back(arg.toUtf8());
+  }
+  std::vector<char*> argv;
+  for (QByteArray& arg : storage) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+  int argc = storage.size();
+
+  if (epoll_dispatcher_) {
+    QCoreApplication::setEventDispatcher(new EpollEventDispatcher);
+  }
+  QCoreApplication app(argc, argv.data());
+  interp_->setArguments(args);
+
+  int res = interp_->load(storage[1].constData());
+  if (!res && !interp_->quitCalled) {
+    res = app.exec();
+  } else if (interp_->quitCalled) {
+    res = interp_->retCode;
+  }
+
+  lua_State *L = interp_->state();
+  lua_rawgeti(L, LUA_REGISTRYINDEX, warm_ref_);
+  lua_getfield(L, -1, "report");
+  if (lua_isfunction(L, -1) && lua_pcall(L, 0, 1, 0) == 0 && lua_isstring(L, -1)) {
+    write_line(conn, QByteArray("report ") + lua_tostring(L, -1));
+  }
+  // Closing the state finalizes files opened by script
+  delete interp_;
+  interp_ = nullptr;
+  fflush(stdout);
+  fflush(stderr);
+  return res;
+}
+
+// Waits for child, the child is terminated if client disconnects
+int InterpServer::waitChild(int conn, pid_t pid) {
+  bool terminated = false;
+  for (;;) {
+    int status = 0;
+    const pid_t r = waitpid(pid, &status, WNOHANG);
+    if (r == pid) {
+      return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    if (r < 0 && errno != EINTR) {
+      return 1;
+    }
+    struct pollfd p[2] = { { child_pipe[0], POLLIN, 0 }, { conn, POLLIN, 0 } };
+    if (poll(p, terminated ? 1 : 2, -1) < 0) continue;
+    char c;
+    while (read(child_pipe[0], &c, 1) > 0) { }
+    // Client sends nothing after request, so readable connection means it is closed
+    if (!terminated && p[1].revents) {
+      const ssize_t n = recv(conn, &c, 1, MSG_DONTWAIT);
+      if (n >= 0 || (errno != EAGAIN && errno != EINTR)) {
+        kill(pid, SIGTERM);
+        terminated = true;
+      }
+    }
+  }
+}
+
+int RunInterpClient(const char *socket_path, int argc, char **argv) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+    perror(socket_path);
+    return 1;
+  }
+  char cwd[PATH_MAX];
+  if (!getcwd(cwd, sizeof(cwd))) {
+    perror("getcwd");
+    return 1;
+  }
+  QByteArray request = QByteArray::number(argc + 1);
+  request.append('\0');
+  request.append(cwd);
+  request.append('\0');
+  for (int i = 0; i < argc; ++i) {
+    request.append(argv[i]);
+    request.append('\0');
+  }
+
+  struct iovec iov = { request.data(), size_t(request.size()) };
+  union {
+    char buf[CMSG_SPACE(sizeof(int) * kClientFds)];
+    struct cmsghdr align;
+  } control;
+  memset(&control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = CMSG_LEN(sizeof(int) * kClientFds);
+  const int fds[kClientFds] = { 0, 1, 2 };
+  memcpy(CMSG_DATA(c), fds, sizeof(fds));
+  ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+  if (n > 0 && n < request.size()) {
+    if (!write_all(fd, request.constData() + n, request.size() - n)) n = -1;
+  }
+  if (n < 0) {
+    perror(socket_path);
+    return 1;
+  }
+
+  QByteArray response;
+  char buffer[512];
+  while ((n = read(fd, buffer, sizeof(buffer))) != 0) {
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) break;
+    response.append(buffer, n);
+  }
+  close(fd);
+  int res = -1;
+  for (const QByteArray& line : response.split('\n')) {
+    if (line.startsWith("report ")) {
+      std::cerr << "Report: " << line.mid(strlen("report ")).constData() << std::endl;
+    } else if (line.startsWith("exit ")) {
+      res = line.mid(strlen("exit ")).toInt();
+    }
+  }
+  if (res < 0) {
+    std::cerr << "Interpreter server closed connection" << std::endl;
+    return 1;
+  }
+  return res;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <sys/types.h>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class LuaInterpreter;
+
+// Persistent interpreter server (interp --serve=<socket> [warmup.lua]).
+// Server creates Lua state once and runs warm-up script (modules/atf/serve.lua
+// by default) which requires modules and parses API schemas. Then it accepts run
+// requests on Unix socket, each request is served by forked child of the warm
+// process: child takes descriptors 0, 1, 2 of client, creates QCoreApplication
+// and runs the script as `interp <script> [arguments]` would. Requests are
+// served one at a time, warm state is rebuilt when files listed by warm-up
+// script are modified.
+//
+// Request: "<count>\0" and count NUL terminated strings: working directory,
+// script path and its arguments. Client descriptors are attached by SCM_RIGHTS.
+// Response: "report <path>\n" if script produced xml report, "exit <code>\n".
+class InterpServer {
+ public:
+  InterpServer(const char *exe, const QString& warmup, const QString& bytecode_cache_dir,
+               bool epoll_dispatcher);
+  ~InterpServer();
+  int run(const char *socket_path);
+
+ private:
+  struct WatchedFile {
+    QByteArray path;
+    qint64 mtime_ns;
+    qint64 size;
+  };
+
+  bool warmUp();
+  bool isStale() const;
+  void serve(int conn);
+  int runChild(int conn, const QStringList& args);
+  int waitChild(int conn, pid_t pid);
+
+  QByteArray exe_;
+  QString warmup_;
+  QString bytecode_cache_dir_;
+  bool epoll_dispatcher_;
+  QByteArray cwd_;
+  LuaInterpreter *interp_;
+  // Registry reference of table returned by warm-up script
+  int warm_ref_;
+  QList<WatchedFile> files_;
+  int listen_fd_;
+};
+
+// Client of interpreter server (interp --connect=<socket> script.lua [arguments]).
+// Output of the script goes directly to descriptors of the client,
+// returns exit code of the script
+int RunInterpClient(const char *socket_path, int argc, char **argv);
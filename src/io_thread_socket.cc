@@ -0,0 +1,268 @@
+#include "io_thread_socket.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <initializer_list>
+#include "socket_stats.h"
+
+namespace {
+// Number of frames and writes queued between threads
+const size_t kQueueCapacity = 4096;
+const size_t kChunkSize = 64 * 1024;
+// Ford protocol header, see protocol_handler/ford_protocol_constants.lua
+const int kHeaderSizeV1 = 8;
+const int kHeaderSize = 12;
+// Poll interval while frames wait for free space in queue
+const int kBacklogPollMs = 1;
+
+qint64 now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<qint64>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+int connect_once(const char *host, int port) {
+  struct addrinfo hints, *addrs = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+  if (getaddrinfo(host, service, &hints, &addrs) != 0) {
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo *a = addrs; a; a = a->ai_next) {
+    fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+    if (fd < 0) continue;
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) break;
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addrs);
+  return fd;
+}
+
+// Size of frame starting at offset of data or 0 if it is not complete yet
+int frame_size(const QByteArray& data, int offset) {
+  const int available = data.size() - offset;
+  if (available < kHeaderSizeV1) return 0;
+  const uchar *u = reinterpret_cast<const uchar*>(data.constData() + offset);
+  const int header_size = (u[0] >> 4) == 1 ? kHeaderSizeV1 : kHeaderSize;
+  if (available < header_size) return 0;
+  const quint32 payload_size = (quint32(u[4]) << 24) | (quint32(u[5]) << 16) |
+                               (quint32(u[6]) << 8) | quint32(u[7]);
+  const qint64 size = header_size + qint64(payload_size);
+  return available >= size ? int(size) : 0;
+}
+}  // anonymous namespace
+
+IoThreadSocket::IoThreadSocket(QObject *parent)
+  : QObject(parent),
+    running_(false),
+    stop_(false),
+    closed_by_peer_(false),
+    finished_(false),
+    written_(0),
+    write_queue_(0),
+    pending_since_us_(-1),
+    in_(kQueueCapacity),
+    out_(kQueueCapacity) {
+}
+
+IoThreadSocket::~IoThreadSocket() {
+  close();
+}
+
+bool IoThreadSocket::connect(const QByteArray& host, int port, int timeout_ms) {
+  close();
+  const qint64 start = now_ms();
+  while ((sock_fd_ = connect_once(host.constData(), port)) < 0) {
+    if (now_ms() - start > timeout_ms) {
+      fprintf(stderr, "%s\n%s\n", "Error: Connection not established", strerror(errno));
+      return false;
+    }
+    usleep(10000);
+  }
+  int one = 1;
+  setsockopt(sock_fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  fcntl(sock_fd_, F_SETFL, fcntl(sock_fd_, F_GETFL) | O_NONBLOCK);
+  io_wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  lua_wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  notifier_ = new QSocketNotifier(lua_wake_fd_, QSocketNotifier::Read, this);
+  QObject::connect(notifier_, SIGNAL(activated(int)), this, SLOT(onWakeup()));
+
+  stop_ = false;
+  closed_by_peer_ = false;
+  finished_ = false;
+  disconnect_reported_ = false;
+  written_ = 0;
+  write_queue_ = 0;
+  pending_since_us_ = -1;
+  running_ = true;
+  thread_ = std::thread(&IoThreadSocket::run, this);
+  emit connected();
+  return true;
+}
+
+qint64 IoThreadSocket::write(const QByteArray& data) {
+  if (!running_ || closed_by_peer_) return -1;
+  // Queue is full only if I/O thread can not write to socket for a long time
+  while (!out_.push(data)) {
+    wake(io_wake_fd_);
+    usleep(100);
+    if (closed_by_peer_) return -1;
+  }
+  write_queue_ += data.size();
+  wake(io_wake_fd_);
+  return data.size();
+}
+
+QList<QByteArray> IoThreadSocket::takeFrames(qint64 *received_us) {
+  const qint64 since = pending_since_us_.exchange(-1);
+  if (received_us) *received_us = since;
+  QList<QByteArray> res;
+  QByteArray frame;
+  while (in_.pop(&frame)) {
+    res.append(frame);
+  }
+  return res;
+}
+
+void IoThreadSocket::close() {
+  if (thread_.joinable()) {
+    stop_ = true;
+    wake(io_wake_fd_);
+    thread_.join();
+  }
+  delete notifier_;
+  notifier_ = nullptr;
+  for (int *fd : { &sock_fd_, &io_wake_fd_, &lua_wake_fd_ }) {
+    if (*fd >= 0) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+  const bool was_running = running_;
+  running_ = false;
+  if (was_running && !disconnect_reported_) {
+    disconnect_reported_ = true;
+    emit disconnected();
+  }
+}
+
+void IoThreadSocket::wake(int fd) {
+  if (fd >= 0 && eventfd_write(fd, 1) != 0 && errno != EAGAIN) {
+    perror("IoThreadSocket: wake");
+  }
+}
+
+void IoThreadSocket::onWakeup() {
+  eventfd_t value;
+  eventfd_read(lua_wake_fd_, &value);
+  // Flag is read before frames: all frames of finished thread are queued already
+  const bool finished = finished_;
+  const qint64 bytes = written_.exchange(0);
+  if (bytes > 0) emit bytesWritten(bytes);
+  if (!in_.empty()) emit readyRead();
+  // Frames received before connection was closed are delivered first
+  if (finished && !disconnect_reported_) {
+    disconnect_reported_ = true;
+    emit disconnected();
+  }
+}
+
+void IoThreadSocket::run() {
+  struct pollfd fds[2];
+  fds[0].fd = io_wake_fd_;
+  fds[0].events = POLLIN;
+  fds[1].fd = sock_fd_;
+  while (!stop_) {
+    // Socket is not read while previous frames wait for free space in queue
+    fds[1].events = (backlog_.empty() && !closed_by_peer_ ? POLLIN : 0) |
+                    (output_.isEmpty() ? 0 : POLLOUT);
+    const int timeout = backlog_.empty() ? -1 : kBacklogPollMs;
+    if (poll(fds, 2, timeout) < 0) {
+      if (errno == EINTR) continue;
+      perror("IoThreadSocket: poll");
+      break;
+    }
+    if (fds[0].revents & POLLIN) {
+      eventfd_t value;
+      eventfd_read(io_wake_fd_, &value);
+    }
+    QByteArray data;
+    while (out_.pop(&data)) output_.append(data);
+    // Data can't be written to broken connection, but received frames are still posted
+    if (!output_.isEmpty() && !writeSocket()) output_.clear();
+    if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) readSocket();
+    postFrames();
+    if (closed_by_peer_ && backlog_.empty()) break;
+  }
+  // Lua thread is notified about the rest of frames and disconnection
+  finished_ = true;
+  wake(lua_wake_fd_);
+}
+
+void IoThreadSocket::readSocket() {
+  char buffer[kChunkSize];
+  while (true) {
+    const ssize_t received = read(sock_fd_, buffer, sizeof(buffer));
+    if (received > 0) {
+      input_.append(buffer, received);
+      int offset = 0;
+      int size;
+      while ((size = frame_size(input_, offset)) > 0) {
+        backlog_.push_back(input_.mid(offset, size));
+        offset += size;
+      }
+      input_.remove(0, offset);
+      // Rest of data stays in kernel buffer until queue has free space, so SDL is slowed down by TCP
+      postFrames();
+      if (!backlog_.empty()) return;
+      continue;
+    }
+    if (received < 0 && errno == EINTR) continue;
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+    // SDL closed connection or connection is broken
+    closed_by_peer_ = true;
+    return;
+  }
+}
+
+bool IoThreadSocket::writeSocket() {
+  const ssize_t sent = send(sock_fd_, output_.constData(), output_.size(), MSG_NOSIGNAL);
+  if (sent < 0) {
+    if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) return true;
+    closed_by_peer_ = true;
+    return false;
+  }
+  output_.remove(0, sent);
+  written_ += sent;
+  write_queue_ -= sent;
+  wake(lua_wake_fd_);
+  return true;
+}
+
+void IoThreadSocket::postFrames() {
+  bool posted = false;
+  while (!backlog_.empty() && in_.push(backlog_.front())) {
+    backlog_.pop_front();
+    posted = true;
+  }
+  if (posted) {
+    qint64 none = -1;
+    pending_since_us_.compare_exchange_strong(none, SocketStats::now_us());
+    wake(lua_wake_fd_);
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QSocketNotifier>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include "spsc_queue.h"
+
+// TCP connection to SDL served by dedicated I/O thread.
+// The thread reads socket, splits stream to complete Ford protocol frames and
+// posts them to Lua thread through lock-free queue, readyRead() is emitted
+// once per batch. Writes are posted back to the thread through the other queue,
+// so slow Lua code delays neither reading nor writing of the socket.
+class IoThreadSocket : public QObject {
+  Q_OBJECT
+ public:
+  explicit IoThreadSocket(QObject *parent = 0);
+  ~IoThreadSocket();
+  // Connects to host:port, retries during timeout_ms, starts I/O thread
+  bool connect(const QByteArray& host, int port, int timeout_ms);
+  // Posts data to I/O thread, returns its size or -1 if socket is not connected
+  qint64 write(const QByteArray& data);
+  // Returns complete frames received since previous call, received_us is set
+  // to monotonic time when the oldest of them was queued or -1
+  QList<QByteArray> takeFrames(qint64 *received_us = nullptr);
+  // Monotonic time when the oldest frame not taken yet was queued or -1
+  qint64 pendingSince() const { return pending_since_us_; }
+  // Bytes posted by write() and not written to socket yet
+  qint64 writeQueue() const { return write_queue_; }
+  // Stops I/O thread and closes connection
+  void close();
+  bool isConnected() const { return running_; }
+ signals:
+  void connected();
+  void disconnected();
+  void readyRead();
+  void bytesWritten(qint64 bytes);
+ private slots:
+  void onWakeup();
+ private:
+  void run();
+  void readSocket();
+  bool writeSocket();
+  void postFrames();
+  void wake(int fd);
+
+  int sock_fd_ = -1;
+  // eventfd descriptors to wake I/O thread and Lua thread
+  int io_wake_fd_ = -1;
+  int lua_wake_fd_ = -1;
+  QSocketNotifier *notifier_ = nullptr;
+  std::thread thread_;
+  std::atomic<bool> running_;
+  std::atomic<bool> stop_;
+  std::atomic<bool> closed_by_peer_;
+  // Set by I/O thread after the last frame is posted and the thread exits
+  std::atomic<bool> finished_;
+  std::atomic<qint64> written_;
+  std::atomic<qint64> write_queue_;
+  std::atomic<qint64> pending_since_us_;
+  bool disconnect_reported_ = false;
+  SpscQueue<QByteArray> in_;
+  SpscQueue<QByteArray> out_;
+  // Owned by I/O thread: partial frame, frames not fitting into queue yet
+  // (socket is not read until they are posted), unsent data
+  QByteArray input_;
+  std::deque<QByteArray> backlog_;
+  QByteArray output_;
+};
@@ -0,0 +1,219 @@
+#include "log_sink.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <initializer_list>
+
+namespace {
+// Maximal amount of data moved by one splice() call
+const size_t kChunkSize = 64 * 1024;
+// Time to capture data which is still arriving after stop request
+const qint64 kDrainTimeoutMs = 200;
+// Interval between attempts to connect to SDL log port
+const int kRetryIntervalMs = 10;
+
+qint64 now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<qint64>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+int connect_once(const char *host, int port) {
+  struct addrinfo hints, *addrs = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+  if (getaddrinfo(host, service, &hints, &addrs) != 0) {
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo *a = addrs; a; a = a->ai_next) {
+    fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+    if (fd < 0) continue;
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) break;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addrs);
+  return fd;
+}
+
+bool write_all(int fd, const char *data, ssize_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+}  // anonymous namespace
+
+LogSink::LogSink()
+  : running(false), captured(0) {
+}
+
+LogSink::~LogSink() {
+  stop();
+}
+
+bool LogSink::connect(const QByteArray& host, int port, int timeout_ms) {
+  stop();
+  this->host = host;
+  this->port = port;
+  this->timeout_ms = timeout_ms;
+  return true;
+}
+
+bool LogSink::connectSocket() {
+  struct pollfd stop_fd;
+  stop_fd.fd = stop_pipe[0];
+  stop_fd.events = POLLIN;
+  const qint64 start = now_ms();
+  while ((sock_fd = connect_once(host.constData(), port)) < 0) {
+    if (now_ms() - start > timeout_ms) {
+      fprintf(stderr, "%s\n%s\n", "Error: Connection not established", strerror(errno));
+      return false;
+    }
+    // Stop request interrupts waiting for the next attempt
+    if (poll(&stop_fd, 1, kRetryIntervalMs) > 0) return false;
+  }
+  return true;
+}
+
+bool LogSink::start(const QByteArray& filename) {
+  if (running || (sock_fd < 0 && port < 0)) {
+    return false;
+  }
+  file_fd = open(filename.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (file_fd < 0) {
+    fprintf(stderr, "Error: cannot open %s: %s\n", filename.constData(), strerror(errno));
+    return false;
+  }
+  if (pipe2(stop_pipe, O_CLOEXEC) != 0) {
+    close(file_fd);
+    file_fd = -1;
+    return false;
+  }
+  captured = 0;
+  running = true;
+  thread = std::thread(&LogSink::run, this);
+  return true;
+}
+
+void LogSink::stopCapture() {
+  if (thread.joinable()) {
+    // Wake up poll() in capture thread
+    char c = 0;
+    if (write(stop_pipe[1], &c, 1) < 0) {
+      perror("LogSink: stop");
+    }
+    thread.join();
+  }
+  for (int *fd : { &file_fd, &stop_pipe[0], &stop_pipe[1] }) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+  running = false;
+}
+
+void LogSink::stop() {
+  stopCapture();
+  if (sock_fd >= 0) {
+    close(sock_fd);
+    sock_fd = -1;
+  }
+}
+
+bool LogSink::reopen(const QByteArray& filename) {
+  // Data which is already available goes to the previous file
+  stopCapture();
+  return start(filename);
+}
+
+void LogSink::run() {
+  if (sock_fd < 0 && !connectSocket()) {
+    running = false;
+    return;
+  }
+  int pipe_fd[2];
+  const bool have_pipe = pipe2(pipe_fd, O_CLOEXEC) == 0;
+  bool use_splice = have_pipe;
+  char buffer[kChunkSize];
+
+  struct pollfd fds[2];
+  fds[0].fd = sock_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = stop_pipe[0];
+  fds[1].events = POLLIN;
+
+  // After stop request data which is already available is still captured
+  qint64 drain_deadline = -1;
+  while (true) {
+    const bool stopping = drain_deadline >= 0;
+    if (poll(fds, stopping ? 1 : 2, stopping ? 0 : -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (!stopping && (fds[1].revents & POLLIN)) {
+      drain_deadline = now_ms() + kDrainTimeoutMs;
+    }
+    if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+      if (stopping) break;
+      continue;
+    }
+    if (stopping && now_ms() > drain_deadline) break;
+
+    ssize_t received;
+    if (use_splice) {
+      received = splice(sock_fd, NULL, pipe_fd[1], NULL, kChunkSize, SPLICE_F_MOVE);
+      if (received < 0 && errno == EINVAL) {
+        // splice is not supported for these descriptors
+        use_splice = false;
+        continue;
+      }
+      for (ssize_t left = received; left > 0;) {
+        ssize_t moved = splice(pipe_fd[0], NULL, file_fd, NULL, left, SPLICE_F_MOVE);
+        if (moved < 0 && errno == EINTR) continue;
+        if (moved <= 0) {
+          perror("LogSink: splice");
+          received = -1;
+          break;
+        }
+        left -= moved;
+      }
+    } else {
+      received = read(sock_fd, buffer, sizeof(buffer));
+      if (received > 0 && !write_all(file_fd, buffer, received)) {
+        perror("LogSink: write");
+        received = -1;
+      }
+    }
+
+    if (received == 0) break;  // SDL closed log connection
+    if (received < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      break;
+    }
+    captured += received;
+  }
+
+  if (have_pipe) {
+    close(pipe_fd[0]);
+    close(pipe_fd[1]);
+  }
+  running = false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QByteArray>
+#include <atomic>
+#include <thread>
+
+// Log sink owns TCP connection to SDL log port and moves all received bytes
+// to a file in dedicated thread. On Linux data is moved kernel-side with
+// splice() through a pipe, read()/write() is used as a fallback.
+// Connection is established by the capture thread, so Qt event loop is not
+// blocked while SDL log port is not opened yet.
+class LogSink {
+ public:
+  LogSink();
+  ~LogSink();
+  // Sets SDL log port, capture thread connects to it and retries during
+  // timeout_ms. Previous capture and connection are stopped
+  bool connect(const QByteArray& host, int port, int timeout_ms);
+  // Opens (truncates) file and starts capture thread, which connects first
+  // if connection is not established yet
+  bool start(const QByteArray& filename);
+  // Stops capture thread and closes connection and file
+  void stop();
+  // Switches capture to another file, connection is kept
+  bool reopen(const QByteArray& filename);
+  bool isRunning() const { return running; }
+  quint64 bytes() const { return captured; }
+ private:
+  void run();
+  // Called by capture thread, returns false on timeout or stop request
+  bool connectSocket();
+  // Stops capture thread and closes file
+  void stopCapture();
+
+  QByteArray host;
+  int port = -1;
+  int timeout_ms = 0;
+  int sock_fd = -1;
+  int file_fd = -1;
+  int stop_pipe[2] = { -1, -1 };
+  std::thread thread;
+  std::atomic<bool> running;
+  std::atomic<quint64> captured;
+};
@@ -0,0 +1,258 @@
+#include "lua_allocator.h"
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+double monotonic_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Same as panic handler of luaL_newstate()
+int panic(lua_State *L) {
+  fprintf(stderr, "PANIC: unprotected error in call to Lua API (%s)\n",
+          lua_tostring(L, -1));
+  fflush(stderr);
+  return 0;
+}
+
+LuaAllocator *allocator(lua_State *L) {
+  void *ud = NULL;
+  lua_getallocf(L, &ud);
+  return static_cast<LuaAllocator*>(ud);
+}
+}  // anonymous namespace
+
+LuaAllocator::LuaAllocator()
+  : rate_time_(monotonic_seconds()) {
+  memset(free_lists_, 0, sizeof(free_lists_));
+  tag_names_.append("untagged");
+}
+
+LuaAllocator::~LuaAllocator() {
+  for (void *slab : slabs_) {
+    free(slab);
+  }
+}
+
+lua_State *LuaAllocator::newState() {
+  lua_State *L = lua_newstate(&LuaAllocator::alloc, this);
+  if (L) lua_atpanic(L, &panic);
+  return L;
+}
+
+double LuaAllocator::allocationRate() {
+  const double now = monotonic_seconds();
+  const double elapsed = now - rate_time_;
+  const double rate = elapsed > 0 ? (stats_.allocations - rate_allocations_) / elapsed : 0;
+  rate_time_ = now;
+  rate_allocations_ = stats_.allocations;
+  return rate;
+}
+
+int LuaAllocator::tagIndex(const QByteArray& name) {
+  int index = tag_names_.indexOf(name);
+  if (index >= 0) return index;
+  if (tag_names_.size() >= kMaxTags) return -1;
+  tag_names_.append(name);
+  return tag_names_.size() - 1;
+}
+
+void *LuaAllocator::alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+  LuaAllocator *self = static_cast<LuaAllocator*>(ud);
+  // osize holds type of object if ptr is NULL
+  if (!ptr) osize = 0;
+  if (nsize == 0) {
+    if (ptr) self->release(ptr, osize);
+    return NULL;
+  }
+  if (!ptr) return self->allocate(nsize);
+
+  // Both sizes fall into the same block
+  if (osize <= kMaxSmallSize && nsize <= kMaxSmallSize && sizeClass(osize) == sizeClass(nsize)) {
+    self->resized(osize, nsize);
+    return ptr;
+  }
+  if (osize > kMaxSmallSize && nsize > kMaxSmallSize) {
+    void *block = realloc(ptr, nsize);
+    if (!block) return self->shrinkFailed(ptr, osize, nsize);
+    self->resized(osize, nsize);
+    return block;
+  }
+  // Block moves between pool and malloc or between size classes
+  void *block = self->allocate(nsize);
+  if (!block) return self->shrinkFailed(ptr, osize, nsize);
+  memcpy(block, ptr, osize < nsize ? osize : nsize);
+  self->release(ptr, osize);
+  return block;
+}
+
+void LuaAllocator::resized(size_t osize, size_t nsize) {
+  stats_.reallocations++;
+  stats_.live_bytes += nsize;
+  stats_.live_bytes -= osize;
+  if (stats_.live_bytes > stats_.peak_bytes) stats_.peak_bytes = stats_.live_bytes;
+}
+
+void *LuaAllocator::shrinkFailed(void *ptr, size_t osize, size_t nsize) {
+  if (nsize > osize) return NULL;
+  // Lua assumes shrinking never fails, so the old block is kept. It is
+  // released later with the new size: a bigger size class block or
+  // a malloc block goes to the pool of nsize, which is only wasteful.
+  resized(osize, nsize);
+  return ptr;
+}
+
+void *LuaAllocator::allocate(size_t size) {
+  void *block;
+  if (size <= kMaxSmallSize) {
+    const int size_class = sizeClass(size);
+    if (!free_lists_[size_class]) {
+      refill(size_class);
+      if (!free_lists_[size_class]) return NULL;
+    }
+    FreeBlock *head = free_lists_[size_class];
+    free_lists_[size_class] = head->next;
+    block = head;
+    stats_.pooled++;
+  } else {
+    block = malloc(size);
+    if (!block) return NULL;
+  }
+  stats_.allocations++;
+  stats_.live_bytes += size;
+  if (stats_.live_bytes > stats_.peak_bytes) stats_.peak_bytes = stats_.live_bytes;
+  TagStats& tag = tag_stats_[current_tag_];
+  tag.allocations++;
+  tag.bytes += size;
+  return block;
+}
+
+void LuaAllocator::release(void *ptr, size_t size) {
+  stats_.frees++;
+  stats_.live_bytes -= size;
+  if (size <= kMaxSmallSize) {
+    FreeBlock *block = static_cast<FreeBlock*>(ptr);
+    const int size_class = sizeClass(size);
+    block->next = free_lists_[size_class];
+    free_lists_[size_class] = block;
+  } else {
+    free(ptr);
+  }
+}
+
+void LuaAllocator::refill(int size_class) {
+  char *slab = static_cast<char*>(malloc(kSlabSize));
+  if (!slab) return;
+  slabs_.push_back(slab);
+  stats_.slab_bytes += kSlabSize;
+  const size_t block_size = (size_class + 1) * kGranularity;
+  FreeBlock *head = free_lists_[size_class];
+  for (size_t offset = 0; offset + block_size <= kSlabSize; offset += block_size) {
+    FreeBlock *block = reinterpret_cast<FreeBlock*>(slab + offset);
+    block->next = head;
+    head = block;
+  }
+  free_lists_[size_class] = head;
+}
+
+namespace {
+void push_tag(lua_State *L, LuaAllocator *a, int index) {
+  const QByteArray& name = a->tagName(index);
+  lua_pushlstring(L, name.constData(), name.size());
+}
+
+int set_tag(lua_State *L, LuaAllocator *a) {
+  size_t len = 0;
+  const char *name = luaL_checklstring(L, 1, &len);
+  const int index = a->tagIndex(QByteArray(name, int(len)));
+  if (index < 0) return luaL_error(L, "too many memory tags (max %d)", LuaAllocator::kMaxTags);
+  a->setCurrentTag(index);
+  return index;
+}
+
+int memory_stats(lua_State *L) {/*{{{*/
+  LuaAllocator *a = allocator(L);
+  const LuaAllocator::Stats& stats = a->stats();
+  lua_createtable(L, 0, 8);
+  lua_pushnumber(L, stats.live_bytes);
+  lua_setfield(L, -2, "live_bytes");
+  lua_pushnumber(L, stats.peak_bytes);
+  lua_setfield(L, -2, "peak_bytes");
+  lua_pushnumber(L, stats.allocations);
+  lua_setfield(L, -2, "allocations");
+  lua_pushnumber(L, stats.frees);
+  lua_setfield(L, -2, "frees");
+  lua_pushnumber(L, stats.reallocations);
+  lua_setfield(L, -2, "reallocations");
+  lua_pushnumber(L, stats.pooled);
+  lua_setfield(L, -2, "pooled");
+  lua_pushnumber(L, stats.slab_bytes);
+  lua_setfield(L, -2, "slab_bytes");
+  lua_pushnumber(L, a->allocationRate());
+  lua_setfield(L, -2, "allocations_per_sec");
+  return 1;
+}/*}}}*/
+
+int memory_reset_peak(lua_State *L) {/*{{{*/
+  allocator(L)->resetPeak();
+  return 0;
+}/*}}}*/
+
+int memory_tag(lua_State *L) {/*{{{*/
+  LuaAllocator *a = allocator(L);
+  const int previous = a->currentTag();
+  if (!lua_isnoneornil(L, 1)) {
+    set_tag(L, a);
+  } else {
+    a->setCurrentTag(0);
+  }
+  push_tag(L, a, previous);
+  return 1;
+}/*}}}*/
+
+int memory_tagged(lua_State *L) {/*{{{*/
+  LuaAllocator *a = allocator(L);
+  luaL_checktype(L, 2, LUA_TFUNCTION);
+  const int previous = a->currentTag();
+  set_tag(L, a);
+  lua_remove(L, 1);
+  const int res = lua_pcall(L, lua_gettop(L) - 1, LUA_MULTRET, 0);
+  a->setCurrentTag(previous);
+  if (res != LUA_OK) return lua_error(L);
+  return lua_gettop(L);
+}/*}}}*/
+
+int memory_tags(lua_State *L) {/*{{{*/
+  LuaAllocator *a = allocator(L);
+  lua_createtable(L, 0, a->tagCount());
+  for (int i = 0; i < a->tagCount(); ++i) {
+    const LuaAllocator::TagStats& stats = a->tagStats(i);
+    push_tag(L, a, i);
+    lua_createtable(L, 0, 2);
+    lua_pushnumber(L, stats.bytes);
+    lua_setfield(L, -2, "bytes");
+    lua_pushnumber(L, stats.allocations);
+    lua_setfield(L, -2, "allocations");
+    lua_rawset(L, -3);
+  }
+  return 1;
+}/*}}}*/
+}  // anonymous namespace
+
+int luaopen_memory(lua_State *L) {
+  luaL_Reg memory_functions[] = {
+    { "stats", &memory_stats },
+    { "reset_peak", &memory_reset_peak },
+    { "tag", &memory_tag },
+    { "tagged", &memory_tagged },
+    { "tags", &memory_tags },
+    { NULL, NULL }
+  };
+  luaL_newlib(L, memory_functions);
+  return 1;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+
+#include <QByteArray>
+#include <QList>
+#include <vector>
+
+// lua_Alloc with size-class pools for small objects.
+// Blocks up to kMaxSmallSize bytes are carved from 64 KB slabs and recycled
+// through per-class free lists, larger blocks go to malloc. Slabs are
+// released only when the allocator is destroyed, i.e. after lua_close().
+// Every allocation is counted against the current tag, so cumulative
+// allocation volume can be split between subsystems (see 'memory' module).
+class LuaAllocator {
+ public:
+  static const size_t kGranularity = 16;
+  static const size_t kMaxSmallSize = 512;
+  static const size_t kSlabSize = 64 * 1024;
+  static const int kMaxTags = 64;
+
+  struct Stats {
+    quint64 live_bytes = 0;     // requested sizes of live blocks
+    quint64 peak_bytes = 0;
+    quint64 allocations = 0;
+    quint64 frees = 0;
+    quint64 reallocations = 0;  // resizes of live blocks
+    quint64 pooled = 0;         // allocations served from size-class pools
+    quint64 slab_bytes = 0;     // memory reserved by slabs
+  };
+  struct TagStats {
+    quint64 bytes = 0;
+    quint64 allocations = 0;
+  };
+
+  LuaAllocator();
+  ~LuaAllocator();
+
+  // Creates Lua state which uses this allocator, panic handler
+  // is the same as of luaL_newstate()
+  lua_State *newState();
+
+  const Stats& stats() const { return stats_; }
+  void resetPeak() { stats_.peak_bytes = stats_.live_bytes; }
+  // Allocations per second since previous call (since creation for the first one)
+  double allocationRate();
+
+  // Returns index of tag, -1 if there are too many tags. Tag 0 is "untagged".
+  int tagIndex(const QByteArray& name);
+  int currentTag() const { return current_tag_; }
+  void setCurrentTag(int index) { current_tag_ = index; }
+  int tagCount() const { return tag_names_.size(); }
+  const QByteArray& tagName(int index) const { return tag_names_[index]; }
+  const TagStats& tagStats(int index) const { return tag_stats_[index]; }
+
+ private:
+  static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+  void *allocate(size_t size);
+  void release(void *ptr, size_t size);
+  // Counts resize of live block in place
+  void resized(size_t osize, size_t nsize);
+  // Returns ptr if failed resize is a shrink, NULL otherwise
+  void *shrinkFailed(void *ptr, size_t osize, size_t nsize);
+  void refill(int size_class);
+
+  static int sizeClass(size_t size) { return int((size + kGranularity - 1) / kGranularity) - 1; }
+
+  struct FreeBlock { FreeBlock *next; };
+  FreeBlock *free_lists_[kMaxSmallSize / kGranularity];
+  std::vector<void*> slabs_;
+  Stats stats_;
+  QList<QByteArray> tag_names_;
+  TagStats tag_stats_[kMaxTags];
+  int current_tag_ = 0;
+  double rate_time_;
+  quint64 rate_allocations_ = 0;
+};
+
+int luaopen_memory(lua_State *L);
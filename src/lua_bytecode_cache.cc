@@ -0,0 +1,132 @@
+#include "lua_bytecode_cache.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+namespace {
+const char kMagic[8] = { 'A', 'T', 'F', 'L', 'U', 'A', 'C', '1' };
+
+// Cache file is the header followed by output of lua_dump
+struct CacheHeader {
+  char magic[8];
+  qint64 mtime_sec;
+  qint64 mtime_nsec;
+  qint64 size;
+};
+
+int dump_writer(lua_State *, const void *p, size_t sz, void *ud) {
+  static_cast<QByteArray*>(ud)->append(static_cast<const char*>(p), sz);
+  return 0;
+}
+
+QByteArray cache_file_name(const QByteArray& cache_dir, QByteArray source) {
+  if (source.startsWith("./")) {
+    source.remove(0, 2);
+  }
+  source.replace('/', '%');
+  return cache_dir + "/" + source + "c";
+}
+
+bool read_cache(const QByteArray& path, const CacheHeader& expected, QByteArray *bytecode) {
+  QFile f(QFile::decodeName(path));
+  if (!f.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QByteArray data = f.readAll();
+  if (static_cast<size_t>(data.size()) <= sizeof(CacheHeader) ||
+      memcmp(data.constData(), &expected, sizeof(CacheHeader)) != 0) {
+    return false;
+  }
+  *bytecode = data.mid(sizeof(CacheHeader));
+  return true;
+}
+
+void write_cache(const QByteArray& path, const CacheHeader& header, const QByteArray& bytecode) {
+  QSaveFile f(QFile::decodeName(path));
+  if (!f.open(QIODevice::WriteOnly)) {
+    return;
+  }
+  f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  f.write(bytecode);
+  f.commit();
+}
+
+int bytecode_searcher(lua_State *L) {
+  const char *name = luaL_checkstring(L, 1);
+
+  // filename = package.searchpath(name, package.path)
+  lua_getglobal(L, "package");
+  lua_getfield(L, -1, "searchpath");
+  lua_pushstring(L, name);
+  lua_getfield(L, -3, "path");
+  lua_call(L, 2, 1);
+  if (lua_isnil(L, -1)) {
+    // Standard Lua searcher reports the list of tried files
+    return 0;
+  }
+  QByteArray filename = lua_tostring(L, -1);
+  lua_pop(L, 2);
+
+  struct stat st;
+  if (stat(filename.constData(), &st) != 0) {
+    return 0;
+  }
+  CacheHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.mtime_sec = st.st_mtim.tv_sec;
+  header.mtime_nsec = st.st_mtim.tv_nsec;
+  header.size = st.st_size;
+
+  const QByteArray cache_path =
+    cache_file_name(lua_tostring(L, lua_upvalueindex(1)), filename);
+  const QByteArray chunkname = "@" + filename;
+
+  QByteArray bytecode;
+  if (read_cache(cache_path, header, &bytecode)) {
+    if (luaL_loadbufferx(L, bytecode.constData(), bytecode.size(),
+                         chunkname.constData(), "b") == LUA_OK) {
+      lua_pushstring(L, filename.constData());
+      return 2;
+    }
+    // Broken cache entry, compile from source
+    lua_pop(L, 1);
+  }
+
+  if (luaL_loadfilex(L, filename.constData(), NULL) != LUA_OK) {
+    return luaL_error(L, "error loading module " LUA_QS " from file " LUA_QS ":\n\t%s",
+                      name, filename.constData(), lua_tostring(L, -1));
+  }
+  bytecode.clear();
+  if (lua_dump(L, &dump_writer, &bytecode) == 0) {
+    write_cache(cache_path, header, bytecode);
+  }
+  lua_pushstring(L, filename.constData());
+  return 2;
+}
+}  // anonymous namespace
+
+bool install_bytecode_cache(lua_State *L, const QString& cache_dir) {
+  if (!QDir().mkpath(cache_dir)) {
+    fprintf(stderr, "Cannot create bytecode cache directory %s\n", cache_dir.toUtf8().constData());
+    return false;
+  }
+
+  lua_getglobal(L, "package");
+  lua_getfield(L, -1, "searchers");
+  // Shift searchers to place the cache right after preload searcher
+  int n = luaL_len(L, -1);
+  for (int i = n; i >= 2; --i) {
+    lua_rawgeti(L, -1, i);
+    lua_rawseti(L, -2, i + 1);
+  }
+  lua_pushstring(L, QFile::encodeName(cache_dir).constData());
+  lua_pushcclosure(L, &bytecode_searcher, 1);
+  lua_rawseti(L, -2, 2);
+  lua_pop(L, 2);
+  return true;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+
+#include <QString>
+
+// Installs package.searchers entry (right after preload searcher) which loads
+// Lua modules found on package.path from precompiled bytecode stored in cache_dir.
+// Cache entry is valid while mtime and size of the source file are unchanged,
+// otherwise the module is compiled from source and cache entry is rewritten.
+bool install_bytecode_cache(lua_State *L, const QString& cache_dir);
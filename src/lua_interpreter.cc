@@ -1,14 +1,20 @@
 #line 121 "main.nw"
-#include <time.h> // for clock_gettime
 #include <locale.h> // for setlocale()
 #include <stdio.h>
 #include <unistd.h> // for isatty()
 #include "lua_interpreter.h"
+#include "lua_profiler.h"
+#include "lua_allocator.h"
+#include "lua_bytecode_cache.h"
 #include "qtdynamic.h"
 #include "network.h"
 #include "timers.h"
+#include "virtual_clock.h"
 #include "qtlua.h"
 #include "qdatetime.h"
+#include "ford_protocol.h"
+#include "atf_log.h"
+#include "epoll_event_dispatcher.h"
 #include <assert.h>
 #include <iostream>
 #include <stdexcept>
@@ -38,9 +44,40 @@ int app_quit(lua_State *L) {
 }
 
 int timestamp(lua_State *L) {
-  struct timespec ts;
-  clock_gettime(CLOCK_MONOTONIC, &ts);
-  lua_pushnumber(L, ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+  // Monotonic time, shifted by offset of virtual clock
+  lua_pushnumber(L, VirtualClock::now());
+  return 1;
+}
+
+int event_loop_stats(lua_State *L) {
+  EpollEventDispatcher *dispatcher =
+    dynamic_cast<EpollEventDispatcher*>(QAbstractEventDispatcher::instance());
+  if (!dispatcher) {
+    lua_pushnil(L);
+    return 1;
+  }
+  const EpollEventDispatcher::Stats& stats = dispatcher->stats();
+  lua_createtable(L, 0, 10);
+  lua_pushnumber(L, stats.iterations);
+  lua_setfield(L, -2, "iterations");
+  lua_pushnumber(L, stats.waits);
+  lua_setfield(L, -2, "waits");
+  lua_pushnumber(L, stats.wakeups);
+  lua_setfield(L, -2, "wakeups");
+  lua_pushnumber(L, stats.socket_events);
+  lua_setfield(L, -2, "socket_events");
+  lua_pushnumber(L, stats.rechecks);
+  lua_setfield(L, -2, "rechecks");
+  lua_pushnumber(L, stats.timer_events);
+  lua_setfield(L, -2, "timer_events");
+  lua_pushnumber(L, stats.timer_batches);
+  lua_setfield(L, -2, "timer_batches");
+  lua_pushnumber(L, stats.max_timer_batch);
+  lua_setfield(L, -2, "max_timer_batch");
+  lua_pushinteger(L, dispatcher->socketCount());
+  lua_setfield(L, -2, "sockets");
+  lua_pushinteger(L, dispatcher->timerCount());
+  lua_setfield(L, -2, "timers");
   return 1;
 }
 
@@ -58,7 +95,8 @@ int arguments(lua_State *L) {
 }  // anonymous namespace
 LuaInterpreter::LuaInterpreter(QObject *parent, const QStringList::iterator& args, const QStringList::iterator& args_end)
   : QObject(parent) {
-  lua_state = luaL_newstate();
+  allocator = new LuaAllocator;
+  lua_state = allocator->newState();
 
   luaL_requiref(lua_state, "base", &luaopen_base, 1);
   luaL_requiref(lua_state, "package", &luaopen_package, 1);
@@ -73,6 +111,9 @@ LuaInterpreter::LuaInterpreter(QObject *parent, const QStringList::iterator& arg
   luaL_requiref(lua_state, "bit32", &luaopen_bit32, 1);
   luaL_requiref(lua_state, "qt", &luaopen_qt, 1);
   luaL_requiref(lua_state, "qdatetime", &luaopen_qdatetime, 1);
+  luaL_requiref(lua_state, "ford_protocol", &luaopen_ford_protocol, 1);
+  luaL_requiref(lua_state, "memory", &luaopen_memory, 1);
+  luaL_requiref(lua_state, "atf_log", &luaopen_atf_log, 1);
 
 #line 192 "main.nw"
   // extend package.cpath
@@ -99,19 +140,30 @@ LuaInterpreter::LuaInterpreter(QObject *parent, const QStringList::iterator& arg
   lua_pushcfunction(lua_state, &arguments);
   lua_setglobal(lua_state, "arguments");
 
-  lua_pushboolean(lua_state, !isatty(fileno(stdout)));
-  lua_setglobal(lua_state, "is_redirected");
+  lua_pushcfunction(lua_state, &event_loop_stats);
+  lua_setglobal(lua_state, "event_loop_stats");
 
   // Adding global 'interp'
   QObject **p = static_cast<QObject**>(lua_newuserdata(lua_state, sizeof(QObject*)));
   *p = this;
   lua_setglobal(lua_state, "interp");
 
+  QStringList arguments;
+  for (auto p = args; p != args_end; ++p) {
+    arguments << *p;
+  }
+  setArguments(arguments);
+}
+
+void LuaInterpreter::setArguments(const QStringList& args) {
+  lua_pushboolean(lua_state, !isatty(fileno(stdout)));
+  lua_setglobal(lua_state, "is_redirected");
+
   // Adding global 'argv'
-  lua_createtable(lua_state, 0, 0);
+  lua_createtable(lua_state, args.count(), 0);
   int i = 1;
-  for (auto p = args; p != args_end; ++p) {
-    lua_pushstring(lua_state, p->toUtf8().constData());
+  for (auto& arg : args) {
+    lua_pushstring(lua_state, arg.toUtf8().constData());
     lua_rawseti(lua_state, -2, i++);
   }
   lua_setglobal(lua_state, "argv");
@@ -125,10 +177,23 @@ int LuaInterpreter::load(const char *filename) {
   }
   return quitCalled ? retCode : res;
 }
+bool LuaInterpreter::startProfiler(const QString& filename, int interval_us) {
+  profiler = new LuaProfiler(lua_state, filename.toUtf8(), interval_us);
+  return profiler->start();
+}
+
+bool LuaInterpreter::enableBytecodeCache(const QString& cache_dir) {
+  return install_bytecode_cache(lua_state, cache_dir);
+}
+
 void LuaInterpreter::quit() {
   QCoreApplication::quit();
 }
 
 LuaInterpreter::~LuaInterpreter() {
+  // Profiler writes collected stacks on destruction
+  delete profiler;
   lua_close(lua_state);
+  // Slabs of allocator are released after all objects of state are freed
+  delete allocator;
 }
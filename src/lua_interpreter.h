@@ -14,16 +14,27 @@ extern "C" {
 #include <QString>
 #include <QStringList>
 
+class LuaProfiler;
+class LuaAllocator;
+
 class LuaInterpreter : public QObject {
   Q_OBJECT
  private:
+  LuaAllocator *allocator;
   lua_State* lua_state;
   int testObject;
+  LuaProfiler *profiler = nullptr;
  public:
   bool quitCalled = false;
   int retCode = 0;
   LuaInterpreter(QObject *parent, const QStringList::iterator& args, const QStringList::iterator& end);
   int load(const char *filename);
+  bool startProfiler(const QString& filename, int interval_us);
+  bool enableBytecodeCache(const QString& cache_dir);
+  // Replaces 'argv' and 'is_redirected' globals for the next script,
+  // used by interpreter server in forked child
+  void setArguments(const QStringList& args);
+  lua_State* state() const { return lua_state; }
  public slots:
   void quit();
  public:
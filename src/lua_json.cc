@@ -0,0 +1,78 @@
+#include "lua_json.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QJsonValue>
+
+namespace {
+// Deeper documents are left to Lua decoder
+const int kMaxDepth = 128;
+
+bool push_value(lua_State *L, const QJsonValue& value, int depth);
+
+void push_string(lua_State *L, const QString& str) {
+  QByteArray utf8 = str.toUtf8();
+  lua_pushlstring(L, utf8.constData(), utf8.size());
+}
+
+bool push_array(lua_State *L, const QJsonArray& array, int depth) {
+  lua_createtable(L, array.size(), 0);
+  int i = 0;
+  for (QJsonArray::const_iterator it = array.begin(); it != array.end(); ++it) {
+    ++i;
+    QJsonValue value = *it;
+    // Null leaves a hole as json4lua does
+    if (value.isNull() || value.isUndefined()) continue;
+    if (!push_value(L, value, depth + 1)) return false;
+    lua_rawseti(L, -2, i);
+  }
+  return true;
+}
+
+bool push_object(lua_State *L, const QJsonObject& object, int depth) {
+  lua_createtable(L, 0, object.size());
+  for (QJsonObject::const_iterator it = object.constBegin(); it != object.constEnd(); ++it) {
+    QJsonValue value = it.value();
+    if (value.isNull() || value.isUndefined()) continue;
+    push_string(L, it.key());
+    if (!push_value(L, value, depth + 1)) return false;
+    lua_rawset(L, -3);
+  }
+  return true;
+}
+
+bool push_value(lua_State *L, const QJsonValue& value, int depth) {
+  // Lua errors must not be raised here, they would skip destructors of Qt values
+  if (depth > kMaxDepth || !lua_checkstack(L, 3)) return false;
+  switch (value.type()) {
+    case QJsonValue::Bool:
+      lua_pushboolean(L, value.toBool());
+      break;
+    case QJsonValue::Double:
+      lua_pushnumber(L, value.toDouble());
+      break;
+    case QJsonValue::String:
+      push_string(L, value.toString());
+      break;
+    case QJsonValue::Array:
+      return push_array(L, value.toArray(), depth);
+    case QJsonValue::Object:
+      return push_object(L, value.toObject(), depth);
+    default:
+      lua_pushnil(L);
+  }
+  return true;
+}
+}  // anonymous namespace
+
+bool lua_push_json(lua_State *L, const QByteArray& text) {
+  QJsonParseError error;
+  QJsonDocument doc = QJsonDocument::fromJson(text, &error);
+  if (error.error != QJsonParseError::NoError) return false;
+  const int top = lua_gettop(L);
+  const bool ok = doc.isArray() ? push_array(L, doc.array(), 0) : push_object(L, doc.object(), 0);
+  if (!ok) lua_settop(L, top);
+  return ok;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+#include <QByteArray>
+
+// Parses JSON object or array and pushes it as Lua table.
+// Conversion follows json4lua decoder: null values are omitted, all numbers
+// are Lua numbers. Pushes nothing and returns false if text is not valid JSON
+// or is nested too deeply.
+bool lua_push_json(lua_State *L, const QByteArray& text);
@@ -0,0 +1,131 @@
+#include "lua_profiler.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <QList>
+
+LuaProfiler *LuaProfiler::instance = nullptr;
+
+namespace {
+// Stack walk is limited to keep sampling cost bounded on deep recursion
+const int kMaxStackDepth = 128;
+
+QByteArray frame_name(const lua_Debug& ar) {
+  QByteArray res;
+  if (*ar.what == 'C') {
+    res = "[C] ";
+    res += ar.name ? ar.name : "?";
+  } else if (*ar.what == 'm') {
+    res = "main (";
+    res += ar.short_src;
+    res += ")";
+  } else {
+    res = ar.name ? ar.name : "?";
+    res += " (";
+    res += ar.short_src;
+    res += ":";
+    res += QByteArray::number(ar.linedefined);
+    res += ")";
+  }
+  // ';' separates frames in folded format
+  res.replace(';', ':');
+  return res;
+}
+}  // anonymous namespace
+
+LuaProfiler::LuaProfiler(lua_State *L, const QByteArray& filename, int interval_us)
+  : lua_state(L), filename(filename), interval_us(interval_us) {
+}
+
+LuaProfiler::~LuaProfiler() {
+  if (running) {
+    stop();
+    write();
+  }
+}
+
+bool LuaProfiler::start() {
+  if (instance) {
+    fprintf(stderr, "Profiler: another profiler is already running\n");
+    return false;
+  }
+  instance = this;
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = &LuaProfiler::signal_handler;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGPROF, &sa, NULL);
+
+  struct itimerval timer;
+  timer.it_interval.tv_sec = interval_us / 1000000;
+  timer.it_interval.tv_usec = interval_us % 1000000;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+    perror("Profiler: setitimer");
+    instance = nullptr;
+    return false;
+  }
+  running = true;
+  return true;
+}
+
+void LuaProfiler::stop() {
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+  signal(SIGPROF, SIG_IGN);
+  lua_sethook(lua_state, NULL, 0, 0);
+  running = false;
+  instance = nullptr;
+}
+
+bool LuaProfiler::write() const {
+  FILE *f = fopen(filename.constData(), "w");
+  if (!f) {
+    fprintf(stderr, "Profiler: cannot open %s: %s\n", filename.constData(), strerror(errno));
+    return false;
+  }
+  for (auto it = stacks.constBegin(); it != stacks.constEnd(); ++it) {
+    fprintf(f, "%s %llu\n", it.key().constData(), static_cast<unsigned long long>(it.value()));
+  }
+  fclose(f);
+  return true;
+}
+
+// lua_sethook is safe to call from signal handler (lua.c does the same for SIGINT).
+// Hook fires on the first instruction, call or return that Lua executes after
+// the signal, so C function on top of stack is caught on its call or return.
+void LuaProfiler::signal_handler(int) {
+  if (instance) {
+    lua_sethook(instance->lua_state, &LuaProfiler::hook,
+                LUA_MASKCALL | LUA_MASKRET | LUA_MASKCOUNT, 1);
+  }
+}
+
+void LuaProfiler::hook(lua_State *L, lua_Debug *) {
+  lua_sethook(L, NULL, 0, 0);
+  if (instance) {
+    instance->sample(L);
+  }
+}
+
+void LuaProfiler::sample(lua_State *L) {
+  QList<QByteArray> frames;
+  lua_Debug ar;
+  for (int level = 0; level < kMaxStackDepth && lua_getstack(L, level, &ar); ++level) {
+    lua_getinfo(L, "Sn", &ar);
+    frames.prepend(frame_name(ar));
+  }
+  if (frames.isEmpty()) return;
+
+  QByteArray stack = frames.first();
+  for (int i = 1; i < frames.size(); ++i) {
+    stack += ';';
+    stack += frames[i];
+  }
+  ++stacks[stack];
+}
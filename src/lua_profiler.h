@@ -0,0 +1,35 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+
+#include <QByteArray>
+#include <QHash>
+
+// Sampling profiler for Lua state.
+// SIGPROF timer (process CPU time) arms a one-shot Lua hook, the hook records
+// current call stack. Stacks are written in folded format
+// ("root;caller;callee count" per line) which is accepted by flamegraph tools.
+// Only one profiler can be active at a time.
+class LuaProfiler {
+ public:
+  LuaProfiler(lua_State *L, const QByteArray& filename, int interval_us);
+  ~LuaProfiler();
+  bool start();
+  void stop();
+  bool write() const;
+ private:
+  static void signal_handler(int signal);
+  static void hook(lua_State *L, lua_Debug *ar);
+  void sample(lua_State *L);
+
+  static LuaProfiler *instance;
+  lua_State *lua_state;
+  QByteArray filename;
+  int interval_us;
+  bool running = false;
+  QHash<QByteArray, quint64> stacks;
+};
@@ -11,11 +11,15 @@ extern "C" {
 #include <libxml/tree.h>
 #include <libxml/xpath.h>
 #include <libxml/xmlsave.h>
+#include <libxml/xmlwriter.h>
 
 #include <iostream>
 #include <assert.h>
 #include <stdarg.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace {
 void genericErrorHandler(void *ctx, const char* message, ...){
@@ -385,6 +389,103 @@ int node_eq(lua_State *L) {
   lua_pushboolean(L, a == b);
   return 1;
 }
+
+// Report writer streams elements straight to the file: output is kept in
+// libxml buffer and written with plain write() calls, so flush() makes
+// the written part of the document visible on disk immediately
+struct XmlWriter {
+  xmlTextWriterPtr writer;
+  int fd;
+};
+
+int xml_writer(lua_State *L) {
+  const char *filename = luaL_checkstring(L, 1);
+  int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    lua_pushnil(L);
+    lua_pushstring(L, strerror(errno));
+    return 2;
+  }
+  xmlOutputBufferPtr out = xmlOutputBufferCreateFd(fd, nullptr);
+  xmlTextWriterPtr writer = out ? xmlNewTextWriter(out) : nullptr;
+  if (!writer) {
+    if (out) xmlOutputBufferClose(out);
+    close(fd);
+    lua_pushnil(L);
+    lua_pushstring(L, "Error creating xml writer");
+    return 2;
+  }
+  xmlTextWriterSetIndent(writer, 1);
+  xmlTextWriterSetIndentString(writer, BAD_CAST "  ");
+  xmlTextWriterStartDocument(writer, "1.0", "utf-8", nullptr);
+  XmlWriter *p = static_cast<XmlWriter*>(lua_newuserdata(L, sizeof(XmlWriter)));
+  p->writer = writer;
+  p->fd = fd;
+  luaL_getmetatable(L, "xml.Writer");
+  lua_setmetatable(L, -2);
+  return 1;
+}
+
+xmlTextWriterPtr check_writer(lua_State *L) {
+  XmlWriter *p = static_cast<XmlWriter*>(luaL_checkudata(L, 1, "xml.Writer"));
+  if (!p->writer) {
+    luaL_error(L, "Invalid xml.Writer object: writer is already closed");
+  }
+  return p->writer;
+}
+
+int writer_startElement(lua_State *L) {
+  xmlTextWriterPtr writer = check_writer(L);
+  auto name = reinterpret_cast<const xmlChar*>(luaL_checkstring(L, 2));
+  xmlTextWriterStartElement(writer, name);
+  lua_settop(L, 1);
+  return 1;
+}
+
+int writer_attr(lua_State *L) {
+  xmlTextWriterPtr writer = check_writer(L);
+  auto name = reinterpret_cast<const xmlChar*>(luaL_checkstring(L, 2));
+  auto value = reinterpret_cast<const xmlChar*>(luaL_checkstring(L, 3));
+  xmlTextWriterWriteAttribute(writer, name, value);
+  lua_settop(L, 1);
+  return 1;
+}
+
+int writer_text(lua_State *L) {
+  xmlTextWriterPtr writer = check_writer(L);
+  auto text = reinterpret_cast<const xmlChar*>(luaL_checkstring(L, 2));
+  xmlTextWriterWriteString(writer, text);
+  lua_settop(L, 1);
+  return 1;
+}
+
+int writer_endElement(lua_State *L) {
+  xmlTextWriterPtr writer = check_writer(L);
+  xmlTextWriterEndElement(writer);
+  lua_settop(L, 1);
+  return 1;
+}
+
+// Pushes buffered output to the file, element which is being written
+// stays open
+int writer_flush(lua_State *L) {
+  xmlTextWriterPtr writer = check_writer(L);
+  xmlTextWriterFlush(writer);
+  return 0;
+}
+
+// Closes all open elements and the file, safe to call more than once
+int writer_close(lua_State *L) {
+  XmlWriter *p = static_cast<XmlWriter*>(luaL_checkudata(L, 1, "xml.Writer"));
+  if (p->writer) {
+    xmlTextWriterEndDocument(p->writer);
+    xmlFreeTextWriter(p->writer);
+    close(p->fd);
+    p->writer = nullptr;
+    p->fd = -1;
+  }
+  return 0;
+}
 }
 extern "C"
 int luaopen_xml(lua_State *L, int ) {
@@ -396,6 +497,7 @@ int luaopen_xml(lua_State *L, int ) {
   luaL_Reg functions[] = {
     { "open", &xml_open },
     { "new", &xml_new },
+    { "writer", &xml_writer },
     { NULL, NULL }
   };
 
@@ -432,6 +534,22 @@ int luaopen_xml(lua_State *L, int ) {
   lua_pushcfunction(L, &node_eq);
   lua_setfield(L, -2, "__eq");
 
+  luaL_newmetatable(L, "xml.Writer");
+  lua_newtable(L);
+  luaL_Reg writer_functions[] = {
+    { "startElement", &writer_startElement },
+    { "attr", &writer_attr },
+    { "text", &writer_text },
+    { "endElement", &writer_endElement },
+    { "flush", &writer_flush },
+    { "close", &writer_close },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, writer_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, &writer_close);
+  lua_setfield(L, -2, "__gc");
+
   luaL_newlib(L, functions);
   return 1;
 }
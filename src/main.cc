@@ -16,7 +16,10 @@ extern "C" {
 #include <iostream>
 #include <csignal>
 #include <csetjmp>
+#include <cstring>
 #include "lua_interpreter.h"
+#include "epoll_event_dispatcher.h"
+#include "interp_server.h"
 
 #line 32 "main.nw"
 namespace {
@@ -26,21 +29,107 @@ void abrt_handler(int signal) {
 }
 
 static void Usage(const char* exe) {
-  std::cout << "Usage: " << exe << " filename.lua [arguments] or" << std::endl <<
-               "       " << exe << " -h|--help" << std::endl;
+  std::cout << "Usage: " << exe << " [options] filename.lua [arguments] or" << std::endl <<
+               "       " << exe << " -h|--help" << std::endl <<
+               "Options:" << std::endl <<
+               "  --profile=<file>          sample Lua call stacks and write them" << std::endl <<
+               "                            in folded format (for flamegraph tools)" << std::endl <<
+               "  --profile-interval=<us>   sampling interval of CPU time, default 1000" << std::endl <<
+               "  --bytecode-cache=<dir>    load Lua modules from precompiled bytecode" << std::endl <<
+               "                            stored in <dir>, refreshed when source changes" << std::endl <<
+               "  --epoll-dispatcher        run event loop on epoll based dispatcher" << std::endl <<
+               "  --serve=<socket>          run persistent server which keeps modules loaded by" << std::endl <<
+               "                            [warmup.lua] (modules/atf/serve.lua by default) and" << std::endl <<
+               "                            runs scripts of clients in forked processes" << std::endl <<
+               "  --connect=<socket>        run script by server, exit with code of the script" << std::endl;
+}
+
+// Event dispatcher has to be installed before application is constructed,
+// so options are scanned up to script name in advance
+static bool EpollDispatcherRequested(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--epoll-dispatcher") == 0) return true;
+    if (strcmp(argv[i], "--") == 0 || argv[i][0] != '-') return false;
+  }
+  return false;
+}
+
+// Index of the first argument which is not an option of interpreter
+static int ScriptIndex(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--") == 0) return i + 1;
+    if (argv[i][0] != '-') return i;
+  }
+  return argc;
+}
+
+static const char* OptionValue(int argc, char** argv, const char* prefix) {
+  const int end = ScriptIndex(argc, argv);
+  for (int i = 1; i < end; ++i) {
+    if (strncmp(argv[i], prefix, strlen(prefix)) == 0) return argv[i] + strlen(prefix);
+  }
+  return nullptr;
 }
 
 int main(int argc, char** argv)
 {
+  struct sigaction sa, oldsa;
+  sa.sa_handler = abrt_handler;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGABRT, &sa, &oldsa);
+  sa.sa_flags = 0;
+
+  // Server and client don't construct application in this process,
+  // server creates it in forked children only
+  if (const char* socket = OptionValue(argc, argv, "--connect=")) {
+    const int script = ScriptIndex(argc, argv);
+    if (script == argc) {
+      std::cerr << "Path to Lua script expected" << std::endl;
+      return 1;
+    }
+    return RunInterpClient(socket, argc - script, argv + script);
+  }
+  if (const char* socket = OptionValue(argc, argv, "--serve=")) {
+    if (OptionValue(argc, argv, "--profile")) {
+      std::cerr << "Profiler is not supported by --serve" << std::endl;
+      return 1;
+    }
+    const int script = ScriptIndex(argc, argv);
+    const char* cache = OptionValue(argc, argv, "--bytecode-cache=");
+    InterpServer server(argv[0], script < argc ? argv[script] : "modules/atf/serve.lua",
+                        cache ? cache : "", EpollDispatcherRequested(argc, argv));
+    return server.run(socket);
+  }
+
+  if (EpollDispatcherRequested(argc, argv)) {
+    QCoreApplication::setEventDispatcher(new EpollEventDispatcher);
+  }
   QCoreApplication app(argc, argv);
   QStringList arguments = QCoreApplication::instance()->arguments();
 
+  QString profileFile;
+  int profileInterval = 1000;
+  QString bytecodeCacheDir;
+
   auto arg = arguments.begin();
   for (++arg; arg != arguments.end(); ++arg) {
     if (*arg == "-h" ||
         *arg == "--help") {
         Usage(argv[0]);
         return 0;
+    } else if (arg->startsWith("--profile=")) {
+        profileFile = arg->mid(strlen("--profile="));
+    } else if (arg->startsWith("--profile-interval=")) {
+        bool ok = false;
+        profileInterval = arg->mid(strlen("--profile-interval=")).toInt(&ok);
+        if (!ok || profileInterval <= 0) {
+          std::cerr << "Invalid profile interval " << arg->toStdString() << std::endl;
+          return 1;
+        }
+    } else if (arg->startsWith("--bytecode-cache=")) {
+        bytecodeCacheDir = arg->mid(strlen("--bytecode-cache="));
+    } else if (*arg == "--epoll-dispatcher") {
+        // installed before application construction
     } else if (*arg == "--") {
         ++arg;
         break;
@@ -61,11 +150,15 @@ int main(int argc, char** argv)
 
   LuaInterpreter lua_interpreter(&app, arg, arguments.end());
 
-  struct sigaction sa, oldsa;
-  sa.sa_handler = abrt_handler;
-  sigemptyset(&sa.sa_mask);
-  sigaction(SIGABRT, &sa, &oldsa);
-  sa.sa_flags = 0;
+  if (!bytecodeCacheDir.isEmpty() &&
+      !lua_interpreter.enableBytecodeCache(bytecodeCacheDir)) {
+    return 1;
+  }
+
+  if (!profileFile.isEmpty() &&
+      !lua_interpreter.startProfiler(profileFile, profileInterval)) {
+    return 1;
+  }
 
   int res = lua_interpreter.load(fileName.toUtf8().constData());
   if (res) {
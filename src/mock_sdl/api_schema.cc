@@ -0,0 +1,176 @@
+#include "api_schema.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QXmlStreamReader>
+
+namespace {
+// Structs may refer to each other, canned values are cut at this depth
+const int kMaxDepth = 8;
+
+QString attribute(const QXmlStreamAttributes& attributes, const char *name) {
+  return attributes.value(name).toString();
+}
+}
+
+ApiSchema::ApiSchema(bool qualified_names)
+  : qualified_names_(qualified_names) {
+}
+
+bool ApiSchema::load(const QString& filename) {
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    error_ = filename + ": " + file.errorString();
+    return false;
+  }
+  QXmlStreamReader xml(&file);
+  QString interface;
+  QString enum_key;
+  QString struct_key;
+  QString function_key;
+  Function function;
+  while (!xml.atEnd()) {
+    xml.readNext();
+    if (xml.isStartElement()) {
+      const QXmlStreamAttributes attributes = xml.attributes();
+      if (xml.name() == "interface") {
+        interface = attribute(attributes, "name");
+      } else if (xml.name() == "enum") {
+        enum_key = key(interface, attribute(attributes, "name"));
+        enums_[enum_key].clear();
+      } else if (xml.name() == "element" && !enum_key.isEmpty()) {
+        const QString name = attribute(attributes, "name");
+        enums_[enum_key].append(name);
+        if (enum_key.endsWith(".FunctionID")) {
+          element_values_.insert(name, attribute(attributes, "value").toInt());
+        }
+      } else if (xml.name() == "struct") {
+        struct_key = key(interface, attribute(attributes, "name"));
+        structs_[struct_key].clear();
+      } else if (xml.name() == "function") {
+        const QString name = attribute(attributes, "name");
+        function = Function();
+        function.interface = interface;
+        function.function_id = attribute(attributes, "functionID");
+        function_key = (qualified_names_ ? interface + "." + name : name)
+                       + "/" + attribute(attributes, "messagetype");
+      } else if (xml.name() == "param") {
+        Param param;
+        param.name = attribute(attributes, "name");
+        param.type = attribute(attributes, "type");
+        param.mandatory = attribute(attributes, "mandatory") != "false";
+        param.array = attribute(attributes, "array") == "true";
+        if (attributes.hasAttribute("minsize")) param.minsize = attribute(attributes, "minsize").toInt();
+        if (attributes.hasAttribute("minlength")) param.minlength = attribute(attributes, "minlength").toInt();
+        if (attributes.hasAttribute("maxlength")) param.maxlength = attribute(attributes, "maxlength").toInt();
+        param.has_minvalue = attributes.hasAttribute("minvalue");
+        param.has_maxvalue = attributes.hasAttribute("maxvalue");
+        param.minvalue = attribute(attributes, "minvalue").toDouble();
+        param.maxvalue = attribute(attributes, "maxvalue").toDouble();
+        if (!function_key.isEmpty()) {
+          function.params.append(param);
+        } else if (!struct_key.isEmpty()) {
+          structs_[struct_key].append(param);
+        }
+      }
+    } else if (xml.isEndElement()) {
+      if (xml.name() == "enum") {
+        enum_key.clear();
+      } else if (xml.name() == "struct") {
+        struct_key.clear();
+      } else if (xml.name() == "function") {
+        functions_.insert(function_key, function);
+        if (!function.function_id.isEmpty()) {
+          const QString name = function_key.left(function_key.indexOf('/'));
+          const int id = element_values_.value(function.function_id, -1);
+          function_ids_.insert(name, id);
+          if (id >= 0) function_names_.insert(id, name);
+        }
+        function_key.clear();
+      }
+    }
+  }
+  if (xml.hasError()) {
+    error_ = filename + ": " + xml.errorString();
+    return false;
+  }
+  return true;
+}
+
+bool ApiSchema::hasFunction(const QString& name, const QString& messagetype) const {
+  return functions_.contains(name + "/" + messagetype);
+}
+
+QJsonObject ApiSchema::params(const QString& name, const QString& messagetype) const {
+  auto it = functions_.constFind(name + "/" + messagetype);
+  if (it == functions_.constEnd()) return QJsonObject();
+  return object(it->interface, it->params, 0);
+}
+
+int ApiSchema::functionId(const QString& name) const {
+  return function_ids_.value(name, -1);
+}
+
+QString ApiSchema::functionName(int function_id) const {
+  return function_names_.value(function_id);
+}
+
+QJsonObject ApiSchema::object(const QString& interface, const QList<Param>& params, int depth) const {
+  QJsonObject result;
+  for (const Param& param : params) {
+    if (!param.mandatory) continue;
+    const QJsonValue v = value(interface, param, depth);
+    if (!v.isNull()) result.insert(param.name, v);
+  }
+  return result;
+}
+
+QJsonValue ApiSchema::value(const QString& interface, const Param& param, int depth) const {
+  if (!param.array) return scalar(interface, param, depth);
+  QJsonArray result;
+  for (int i = 0; i < qMax(param.minsize, 1); ++i) {
+    const QJsonValue v = scalar(interface, param, depth);
+    if (v.isNull()) return QJsonValue();
+    result.append(v);
+  }
+  return result;
+}
+
+QJsonValue ApiSchema::scalar(const QString& interface, const Param& param, int depth) const {
+  if (param.type == "Boolean") return false;
+  if (param.type == "Integer" || param.type == "Long" ||
+      param.type == "Float" || param.type == "Double") {
+    double v = 0;
+    if (param.has_minvalue && v < param.minvalue) v = param.minvalue;
+    if (param.has_maxvalue && v > param.maxvalue) v = param.maxvalue;
+    if (param.type == "Integer" || param.type == "Long") return qint64(v);
+    return v;
+  }
+  if (param.type == "String") {
+    int length = qMax(param.minlength, 1);
+    if (param.maxlength > 0) length = qMin(length, param.maxlength);
+    return QString(length, 'a');
+  }
+  const QString type = resolve(interface, param.type);
+  auto e = enums_.constFind(type);
+  if (e != enums_.constEnd()) {
+    return e->isEmpty() ? QJsonValue() : QJsonValue(e->first());
+  }
+  auto s = structs_.constFind(type);
+  if (s != structs_.constEnd() && depth < kMaxDepth) {
+    const QString struct_interface = type.left(type.lastIndexOf('.'));
+    return object(struct_interface, *s, depth + 1);
+  }
+  return QJsonValue();
+}
+
+QString ApiSchema::resolve(const QString& interface, const QString& type) const {
+  if (type.contains('.')) return type;
+  const QString local = key(interface, type);
+  if (enums_.contains(local) || structs_.contains(local)) return local;
+  return key("Common", type);
+}
+
+QString ApiSchema::key(const QString& interface, const QString& name) const {
+  return interface + "." + name;
+}
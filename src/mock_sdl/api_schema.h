@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Canned messages built from API description (MOBILE_API.xml or HMI_API.xml).
+// Message contains mandatory parameters only and every value is the minimal
+// one accepted by schema: first element of enum, minimal number and length.
+class ApiSchema {
+ public:
+  // Functions of HMI API are addressed as "Interface.Function",
+  // functions of mobile API by bare name
+  explicit ApiSchema(bool qualified_names);
+  bool load(const QString& filename);
+  QString errorString() const { return error_; }
+
+  bool hasFunction(const QString& name, const QString& messagetype) const;
+  QJsonObject params(const QString& name, const QString& messagetype) const;
+  // Mobile API function identifiers, -1 or empty name if unknown
+  int functionId(const QString& name) const;
+  QString functionName(int function_id) const;
+
+ private:
+  struct Param {
+    QString name;
+    QString type;
+    bool mandatory = true;
+    bool array = false;
+    int minsize = 1;
+    int minlength = 1;
+    int maxlength = 0;
+    bool has_minvalue = false;
+    bool has_maxvalue = false;
+    double minvalue = 0;
+    double maxvalue = 0;
+  };
+  struct Function {
+    QString interface;
+    QString function_id;
+    QList<Param> params;
+  };
+
+  QJsonObject object(const QString& interface, const QList<Param>& params, int depth) const;
+  QJsonValue value(const QString& interface, const Param& param, int depth) const;
+  QJsonValue scalar(const QString& interface, const Param& param, int depth) const;
+  QString resolve(const QString& interface, const QString& type) const;
+  QString key(const QString& interface, const QString& name) const;
+
+  bool qualified_names_;
+  QHash<QString, QStringList> enums_;     // "Interface.Enum" -> elements
+  QHash<QString, QList<Param> > structs_; // "Interface.Struct" -> members
+  QHash<QString, Function> functions_;    // "name/messagetype"
+  QHash<QString, int> element_values_;    // FunctionID element -> value
+  QHash<QString, int> function_ids_;
+  QHash<int, QString> function_names_;
+  QString error_;
+};
@@ -0,0 +1,161 @@
+#include "hmi_server.h"
+#include "api_schema.h"
+
+#include <QJsonDocument>
+#include <QTimer>
+
+namespace {
+// Requests SDL sends to HMI on BasicCommunication.OnReady,
+// connecttest.lua expects them during HMI initialization
+const char *kStartupRequests[] = {
+  "VR.IsReady",
+  "TTS.IsReady",
+  "UI.IsReady",
+  "Navigation.IsReady",
+  "VehicleInfo.IsReady",
+  "BasicCommunication.MixingAudioSupported",
+  "BasicCommunication.GetSystemInfo",
+  "UI.GetLanguage",
+  "VR.GetLanguage",
+  "TTS.GetLanguage",
+  "UI.GetSupportedLanguages",
+  "VR.GetSupportedLanguages",
+  "TTS.GetSupportedLanguages",
+  "UI.GetCapabilities",
+  "VR.GetCapabilities",
+  "TTS.GetCapabilities",
+  "Buttons.GetCapabilities",
+  "VehicleInfo.GetVehicleType",
+  "VehicleInfo.GetVehicleData"
+};
+
+// JSON-RPC error code of SDL for unknown method
+const int kUnsupportedRequest = 1;
+}
+
+HmiServer::HmiServer(const ApiSchema& schema, int latency_ms, QObject *parent)
+  : QObject(parent),
+    server_("mock_sdl", QWebSocketServer::NonSecureMode),
+    schema_(schema),
+    latency_ms_(latency_ms) {
+  connect(&server_, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+bool HmiServer::listen(const QHostAddress& address, quint16 port) {
+  return server_.listen(address, port);
+}
+
+QString HmiServer::errorString() const {
+  return server_.errorString();
+}
+
+void HmiServer::onNewConnection() {
+  while (QWebSocket *client = server_.nextPendingConnection()) {
+    client->setParent(this);
+    clients_.append(client);
+    connect(client, SIGNAL(textMessageReceived(QString)), this, SLOT(onTextMessage(QString)));
+    connect(client, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+  }
+}
+
+void HmiServer::onDisconnected() {
+  QWebSocket *client = qobject_cast<QWebSocket*>(sender());
+  clients_.removeAll(client);
+  if (client) client->deleteLater();
+}
+
+void HmiServer::onTextMessage(const QString& text) {
+  QWebSocket *client = qobject_cast<QWebSocket*>(sender());
+  const QJsonObject message = QJsonDocument::fromJson(text.toUtf8()).object();
+  const QString method = message.value("method").toString();
+  // Responses of HMI to requests of mock need no handling
+  if (method.isEmpty()) return;
+  const QJsonValue id = message.value("id");
+  if (id.isUndefined()) {
+    if (method == "BasicCommunication.OnReady") onReady();
+    return;
+  }
+
+  QJsonObject response;
+  response.insert("id", id);
+  response.insert("jsonrpc", QString("2.0"));
+  if (method == "MB.registerComponent") {
+    response.insert("result", next_component_id_);
+    next_component_id_ += 100;
+  } else if (method == "MB.subscribeTo" || method == "MB.unsubscribeFrom") {
+    response.insert("result", QString("OK"));
+  } else if (schema_.hasFunction(method, "response")) {
+    QJsonObject result = schema_.params(method, "response");
+    result.insert("code", 0);
+    result.insert("method", method);
+    response.insert("result", result);
+  } else {
+    QJsonObject data;
+    data.insert("method", method);
+    QJsonObject error;
+    error.insert("code", kUnsupportedRequest);
+    error.insert("message", QString("Unsupported request"));
+    error.insert("data", data);
+    response.insert("error", error);
+  }
+  reply(client, response);
+}
+
+void HmiServer::onAppRegistered(const QString& app_name, int app_id) {
+  QJsonObject params = schema_.params("BasicCommunication.OnAppRegistered", "notification");
+  QJsonObject application = params.value("application").toObject();
+  application.insert("appName", app_name);
+  application.insert("appID", app_id);
+  params.insert("application", application);
+  sendNotification("BasicCommunication.OnAppRegistered", params);
+}
+
+void HmiServer::onAppUnregistered(int app_id) {
+  QJsonObject params;
+  params.insert("appID", app_id);
+  params.insert("unexpectedDisconnect", false);
+  sendNotification("BasicCommunication.OnAppUnregistered", params);
+}
+
+void HmiServer::onReady() {
+  for (const char *method : kStartupRequests) {
+    if (schema_.hasFunction(method, "request")) sendRequest(method);
+  }
+}
+
+void HmiServer::reply(QWebSocket *client, const QJsonObject& message) {
+  const QString text = QString::fromUtf8(QJsonDocument(message).toJson(QJsonDocument::Compact));
+  if (latency_ms_ <= 0) {
+    client->sendTextMessage(text);
+    return;
+  }
+  QPointer<QWebSocket> guard(client);
+  QTimer::singleShot(latency_ms_, this, [guard, text]() {
+      if (guard) guard->sendTextMessage(text);
+    });
+}
+
+void HmiServer::broadcast(const QJsonObject& message) {
+  const QString text = QString::fromUtf8(QJsonDocument(message).toJson(QJsonDocument::Compact));
+  for (QWebSocket *client : clients_) {
+    client->sendTextMessage(text);
+  }
+}
+
+void HmiServer::sendRequest(const QString& method) {
+  QJsonObject request;
+  request.insert("id", next_request_id_++);
+  request.insert("jsonrpc", QString("2.0"));
+  request.insert("method", method);
+  const QJsonObject params = schema_.params(method, "request");
+  if (!params.isEmpty()) request.insert("params", params);
+  broadcast(request);
+}
+
+void HmiServer::sendNotification(const QString& method, const QJsonObject& params) {
+  QJsonObject notification;
+  notification.insert("jsonrpc", QString("2.0"));
+  notification.insert("method", method);
+  notification.insert("params", params);
+  broadcast(notification);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QWebSocket>
+#include <QWebSocketServer>
+
+class ApiSchema;
+
+// HMI side of mock SDL: JSON-RPC over WebSocket. Requests of HMI get canned
+// responses after configured latency, BasicCommunication.OnReady triggers
+// the same startup requests SDL sends to HMI.
+class HmiServer : public QObject {
+  Q_OBJECT
+ public:
+  HmiServer(const ApiSchema& schema, int latency_ms, QObject *parent = 0);
+  bool listen(const QHostAddress& address, quint16 port);
+  QString errorString() const;
+ public slots:
+  void onAppRegistered(const QString& app_name, int app_id);
+  void onAppUnregistered(int app_id);
+ private slots:
+  void onNewConnection();
+  void onTextMessage(const QString& message);
+  void onDisconnected();
+ private:
+  void onReady();
+  void reply(QWebSocket *client, const QJsonObject& message);
+  void broadcast(const QJsonObject& message);
+  void sendRequest(const QString& method);
+  void sendNotification(const QString& method, const QJsonObject& params);
+
+  QWebSocketServer server_;
+  const ApiSchema& schema_;
+  const int latency_ms_;
+  QList<QWebSocket*> clients_;
+  int next_component_id_ = 100;
+  int next_request_id_ = 1;
+};
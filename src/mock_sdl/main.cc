@@ -0,0 +1,147 @@
+#include <QCoreApplication>
+#include <QHostAddress>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <iostream>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include "api_schema.h"
+#include "hmi_server.h"
+#include "mobile_server.h"
+
+namespace {
+// Signal handler only writes to the pipe, event loop is quit by its read end
+int quit_pipe[2] = { -1, -1 };
+
+void quit_handler(int) {
+  const int saved_errno = errno;
+  const char c = 0;
+  if (write(quit_pipe[1], &c, 1) < 0) {
+    // Pipe is full, quit is already pending
+  }
+  errno = saved_errno;
+}
+}
+
+static void Usage(const char* exe) {
+  std::cout << "Usage: " << exe << " [options]" << std::endl <<
+               "Mock of SDL core for benchmarking of ATF: answers mobile RPCs and HMI requests" << std::endl <<
+               "with canned responses built from API xml files" << std::endl <<
+               "Options:" << std::endl <<
+               "  --host=<address>          listening address, default 127.0.0.1" << std::endl <<
+               "  --mobile-port=<port>      mobile TCP port, default 12345" << std::endl <<
+               "  --hmi-port=<port>         HMI WebSocket port, default 8087" << std::endl <<
+               "  --mobile-api=<file>       mobile API, default data/MOBILE_API.xml" << std::endl <<
+               "  --hmi-api=<file>          HMI API, default data/HMI_API.xml" << std::endl <<
+               "  --latency=<ms>            delay of every response, default 0" << std::endl <<
+               "  --heartbeat=<ms>          send heartbeat to mobile sessions, default off" << std::endl <<
+               "  --log-port=<port>         accept ATF connection to SDL logs port, default 6676, 0 to disable" << std::endl;
+}
+
+static bool ParseInt(const QString& arg, const char* option, int* value) {
+  bool ok = false;
+  *value = arg.mid(strlen(option)).toInt(&ok);
+  if (!ok || *value < 0) {
+    std::cerr << "Invalid value " << arg.toStdString() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  QCoreApplication app(argc, argv);
+  QStringList arguments = QCoreApplication::instance()->arguments();
+
+  // API files are looked up next to bin/ since SDL is started from its own folder
+  const QString dataDir = QCoreApplication::applicationDirPath() + "/../data/";
+  QString host = "127.0.0.1";
+  int mobilePort = 12345;
+  int hmiPort = 8087;
+  QString mobileApi = dataDir + "MOBILE_API.xml";
+  QString hmiApi = dataDir + "HMI_API.xml";
+  int latency = 0;
+  int heartbeat = 0;
+  int logPort = 6676;
+
+  auto arg = arguments.begin();
+  for (++arg; arg != arguments.end(); ++arg) {
+    if (*arg == "-h" ||
+        *arg == "--help") {
+        Usage(argv[0]);
+        return 0;
+    } else if (arg->startsWith("--host=")) {
+        host = arg->mid(strlen("--host="));
+    } else if (arg->startsWith("--mobile-port=")) {
+        if (!ParseInt(*arg, "--mobile-port=", &mobilePort)) return 1;
+    } else if (arg->startsWith("--hmi-port=")) {
+        if (!ParseInt(*arg, "--hmi-port=", &hmiPort)) return 1;
+    } else if (arg->startsWith("--mobile-api=")) {
+        mobileApi = arg->mid(strlen("--mobile-api="));
+    } else if (arg->startsWith("--hmi-api=")) {
+        hmiApi = arg->mid(strlen("--hmi-api="));
+    } else if (arg->startsWith("--latency=")) {
+        if (!ParseInt(*arg, "--latency=", &latency)) return 1;
+    } else if (arg->startsWith("--heartbeat=")) {
+        if (!ParseInt(*arg, "--heartbeat=", &heartbeat)) return 1;
+    } else if (arg->startsWith("--log-port=")) {
+        if (!ParseInt(*arg, "--log-port=", &logPort)) return 1;
+    } else {
+      std::cerr << "Unknown argument " << arg->toStdString() << std::endl;
+      return 1;
+    }
+  }
+
+  ApiSchema mobileSchema(false);
+  ApiSchema hmiSchema(true);
+  if (!mobileSchema.load(mobileApi)) {
+    std::cerr << mobileSchema.errorString().toStdString() << std::endl;
+    return 1;
+  }
+  if (!hmiSchema.load(hmiApi)) {
+    std::cerr << hmiSchema.errorString().toStdString() << std::endl;
+    return 1;
+  }
+
+  MobileServer mobile(mobileSchema, latency, heartbeat);
+  HmiServer hmi(hmiSchema, latency);
+  QObject::connect(&mobile, SIGNAL(appRegistered(QString,int)), &hmi, SLOT(onAppRegistered(QString,int)));
+  QObject::connect(&mobile, SIGNAL(appUnregistered(int)), &hmi, SLOT(onAppUnregistered(int)));
+
+  if (!hmi.listen(QHostAddress(host), hmiPort)) {
+    std::cerr << "HMI listen failed: " << hmi.errorString().toStdString() << std::endl;
+    return 1;
+  }
+  if (!mobile.listen(QHostAddress(host), mobilePort)) {
+    std::cerr << "Mobile listen failed: " << mobile.errorString().toStdString() << std::endl;
+    return 1;
+  }
+
+  // Mock writes no logs, the port is opened only to let sdl_logger connect
+  QTcpServer logs;
+  QObject::connect(&logs, &QTcpServer::newConnection, [&logs]() {
+      while (QTcpSocket *socket = logs.nextPendingConnection()) {
+        QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+      }
+    });
+  if (logPort > 0 && !logs.listen(QHostAddress(host), logPort)) {
+    std::cerr << "Log listen failed: " << logs.errorString().toStdString() << std::endl;
+    return 1;
+  }
+
+  // StopSDL.sh stops SDL with SIGINT
+  if (pipe2(quit_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+    std::cerr << "Pipe creation failed: " << strerror(errno) << std::endl;
+    return 1;
+  }
+  QSocketNotifier quitNotifier(quit_pipe[0], QSocketNotifier::Read);
+  QObject::connect(&quitNotifier, &QSocketNotifier::activated, [&app]() { app.exit(0); });
+  signal(SIGINT, quit_handler);
+  signal(SIGTERM, quit_handler);
+  return app.exec();
+}
@@ -0,0 +1,291 @@
+#include "mobile_server.h"
+#include "api_schema.h"
+
+#include <QJsonDocument>
+
+namespace {
+// Ford protocol values, see protocol_handler/ford_protocol_constants.lua
+const quint8 kControlFrame = 0x00;
+const quint8 kSingleFrame = 0x01;
+const quint8 kFirstFrame = 0x02;
+const quint8 kConsecutiveFrame = 0x03;
+
+const quint8 kControlService = 0x00;
+const quint8 kRpcService = 0x07;
+const quint8 kBulkService = 0x0F;
+
+const quint8 kHeartbeat = 0x00;
+const quint8 kStartService = 0x01;
+const quint8 kStartServiceAck = 0x02;
+const quint8 kEndService = 0x04;
+const quint8 kEndServiceAck = 0x05;
+const quint8 kHeartbeatAck = 0xFF;
+
+const quint8 kRequest = 0;
+const quint8 kResponse = 1;
+const quint8 kNotification = 2;
+
+const int kMaxPayloadSize = 1488;
+const int kRpcHeaderSize = 12;
+
+quint32 bytesToInt32(const char *p) {
+  const uchar *u = reinterpret_cast<const uchar*>(p);
+  return (quint32(u[0]) << 24) | (quint32(u[1]) << 16) |
+         (quint32(u[2]) << 8) | quint32(u[3]);
+}
+
+void appendInt32(QByteArray& out, quint32 value) {
+  out.append(char(value >> 24));
+  out.append(char(value >> 16));
+  out.append(char(value >> 8));
+  out.append(char(value));
+}
+}
+
+MobileConnection::MobileConnection(QTcpSocket *socket, int id, const ApiSchema& schema,
+                                   int latency_ms, int heartbeat_ms, QObject *parent)
+  : QObject(parent),
+    socket_(socket),
+    id_(id),
+    schema_(schema),
+    latency_ms_(latency_ms) {
+  socket_->setParent(this);
+  socket_->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+  connect(socket_, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+  connect(socket_, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+  if (heartbeat_ms > 0) {
+    connect(&heartbeat_, SIGNAL(timeout()), this, SLOT(onHeartbeat()));
+    heartbeat_.start(heartbeat_ms);
+  }
+}
+
+void MobileConnection::onReadyRead() {
+  buffer_.append(socket_->readAll());
+  int offset = 0;
+  const int kMinHeaderSize = 8;
+  while (buffer_.size() - offset >= kMinHeaderSize) {
+    const char *p = buffer_.constData() + offset;
+    Header header;
+    header.version = quint8(p[0]) >> 4;
+    header.frame_type = quint8(p[0]) & 0x07;
+    header.service_type = quint8(p[1]);
+    header.frame_info = quint8(p[2]);
+    header.session_id = quint8(p[3]);
+    header.size = bytesToInt32(p + 4);
+    const int header_size = header.version > 1 ? 12 : 8;
+    if (buffer_.size() - offset < header_size) break;
+    header.message_id = header.version > 1 ? bytesToInt32(p + 8) : 0;
+    if (quint32(buffer_.size() - offset - header_size) < header.size) break;
+    onFrame(header, buffer_.mid(offset + header_size, int(header.size)));
+    offset += header_size + int(header.size);
+  }
+  buffer_.remove(0, offset);
+}
+
+void MobileConnection::onDisconnected() {
+  for (int app_id : apps_) {
+    emit appUnregistered(app_id);
+  }
+  apps_.clear();
+  deleteLater();
+}
+
+void MobileConnection::onHeartbeat() {
+  for (auto it = sessions_.constBegin(); it != sessions_.constEnd(); ++it) {
+    if (it.value() > 2) {
+      sendFrame(it.value(), kControlFrame, kControlService, kHeartbeat, it.key(), ++message_id_, QByteArray());
+    }
+  }
+}
+
+void MobileConnection::onFrame(const Header& header, const QByteArray& payload) {
+  const quint32 key = (quint32(header.service_type) << 8) | header.session_id;
+  switch (header.frame_type) {
+    case kControlFrame:
+      onControlFrame(header);
+      break;
+    case kSingleFrame:
+      onMessage(header, payload);
+      break;
+    case kFirstFrame:
+      // Payload of first frame holds total size and number of frames only
+      assembly_[key].clear();
+      if (payload.size() >= 4) assembly_[key].reserve(int(bytesToInt32(payload.constData())));
+      break;
+    case kConsecutiveFrame: {
+      QByteArray& message = assembly_[key];
+      message.append(payload);
+      if (header.frame_info == 0) {
+        const QByteArray complete = message;
+        assembly_.remove(key);
+        onMessage(header, complete);
+      }
+      break;
+    }
+  }
+}
+
+void MobileConnection::onControlFrame(const Header& header) {
+  switch (header.frame_info) {
+    case kHeartbeat:
+      sendFrame(header.version, kControlFrame, kControlService, kHeartbeatAck,
+                header.session_id, header.message_id, QByteArray());
+      break;
+    case kStartService: {
+      quint8 session_id = header.session_id;
+      QByteArray hash;
+      if (header.service_type == kRpcService && session_id == 0) {
+        session_id = next_session_++;
+        if (next_session_ == 0) next_session_ = 1;
+        sessions_.insert(session_id, header.version);
+      }
+      if (header.version > 1) {
+        // Hash id is returned by mobile in EndService
+        appendInt32(hash, (quint32(id_) << 16) | (quint32(session_id) << 8) | header.service_type);
+      }
+      sendFrame(header.version, kControlFrame, header.service_type, kStartServiceAck,
+                session_id, header.message_id, hash);
+      break;
+    }
+    case kEndService:
+      if (header.service_type == kRpcService) {
+        sessions_.remove(header.session_id);
+        if (apps_.contains(header.session_id)) {
+          emit appUnregistered(apps_.take(header.session_id));
+        }
+      }
+      sendFrame(header.version, kControlFrame, header.service_type, kEndServiceAck,
+                header.session_id, header.message_id, QByteArray());
+      break;
+    default:
+      // Acknowledgements of mobile side need no answer
+      break;
+  }
+}
+
+void MobileConnection::onMessage(const Header& header, const QByteArray& message) {
+  if (header.service_type != kRpcService && header.service_type != kBulkService) return;
+  // Protocol version 1 has no binary header, so request can not be identified
+  if (header.version < 2 || message.size() < kRpcHeaderSize) return;
+  const char *p = message.constData();
+  const quint8 rpc_type = quint8(p[0]) >> 4;
+  const quint32 function_id = bytesToInt32(p) & 0x0FFFFFFF;
+  const quint32 correlation_id = bytesToInt32(p + 4);
+  const quint32 json_size = bytesToInt32(p + 8);
+  if (rpc_type != kRequest) return;
+  onRequest(header.session_id, header.version, function_id, correlation_id,
+            message.mid(kRpcHeaderSize, int(json_size)));
+}
+
+void MobileConnection::onRequest(quint8 session_id, quint8 version, quint32 function_id,
+                                 quint32 correlation_id, const QByteArray& json) {
+  const QString name = schema_.functionName(int(function_id));
+  QJsonObject params;
+  quint32 response_id = function_id;
+  if (!name.isEmpty() && schema_.hasFunction(name, "response")) {
+    params = schema_.params(name, "response");
+    params.insert("success", true);
+    params.insert("resultCode", QString("SUCCESS"));
+  } else {
+    response_id = quint32(schema_.functionId("GenericResponse"));
+    params = schema_.params("GenericResponse", "response");
+    params.insert("success", false);
+    params.insert("resultCode", QString("INVALID_ID"));
+  }
+
+  QString app_name;
+  if (name == "RegisterAppInterface") {
+    app_name = QJsonDocument::fromJson(json).object().value("appName").toString();
+  }
+  later([=]() {
+      sendRpc(session_id, version, kResponse, response_id, correlation_id, params);
+      if (name == "RegisterAppInterface") {
+        const int app_id = (id_ << 8) | session_id;
+        apps_.insert(session_id, app_id);
+        QJsonObject status = schema_.params("OnHMIStatus", "notification");
+        status.insert("hmiLevel", QString("NONE"));
+        status.insert("audioStreamingState", QString("NOT_AUDIBLE"));
+        status.insert("systemContext", QString("MAIN"));
+        sendRpc(session_id, version, kNotification,
+                quint32(schema_.functionId("OnHMIStatus")), 0, status);
+        emit appRegistered(app_name, app_id);
+      } else if (name == "UnregisterAppInterface" && apps_.contains(session_id)) {
+        emit appUnregistered(apps_.take(session_id));
+      }
+    });
+}
+
+void MobileConnection::sendRpc(quint8 session_id, quint8 version, quint8 rpc_type, quint32 function_id,
+                               quint32 correlation_id, const QJsonObject& params) {
+  const QByteArray json = QJsonDocument(params).toJson(QJsonDocument::Compact);
+  QByteArray payload;
+  payload.reserve(kRpcHeaderSize + json.size());
+  appendInt32(payload, (quint32(rpc_type) << 28) | (function_id & 0x0FFFFFFF));
+  appendInt32(payload, correlation_id);
+  appendInt32(payload, quint32(json.size()));
+  payload.append(json);
+  sendMessage(session_id, version, kRpcService, payload);
+}
+
+void MobileConnection::sendMessage(quint8 session_id, quint8 version, quint8 service_type,
+                                   const QByteArray& payload) {
+  const quint32 message_id = ++message_id_;
+  if (payload.size() <= kMaxPayloadSize) {
+    sendFrame(version, kSingleFrame, service_type, 0, session_id, message_id, payload);
+    return;
+  }
+  const int frames = (payload.size() + kMaxPayloadSize - 1) / kMaxPayloadSize;
+  QByteArray first;
+  appendInt32(first, quint32(payload.size()));
+  appendInt32(first, quint32(frames));
+  sendFrame(version, kFirstFrame, service_type, 0, session_id, message_id, first);
+  for (int i = 0; i < frames; ++i) {
+    // Frame number cycles through 1..255, zero marks the last frame
+    const quint8 frame_info = i == frames - 1 ? 0 : quint8(i % 255 + 1);
+    sendFrame(version, kConsecutiveFrame, service_type, frame_info, session_id, message_id,
+              payload.mid(i * kMaxPayloadSize, kMaxPayloadSize));
+  }
+}
+
+void MobileConnection::sendFrame(quint8 version, quint8 frame_type, quint8 service_type, quint8 frame_info,
+                                 quint8 session_id, quint32 message_id, const QByteArray& payload) {
+  QByteArray frame;
+  frame.reserve(12 + payload.size());
+  frame.append(char((version << 4) | frame_type));
+  frame.append(char(service_type));
+  frame.append(char(frame_info));
+  frame.append(char(session_id));
+  appendInt32(frame, quint32(payload.size()));
+  if (version > 1) appendInt32(frame, message_id);
+  frame.append(payload);
+  socket_->write(frame);
+}
+
+void MobileConnection::later(const std::function<void()>& action) {
+  if (latency_ms_ <= 0) {
+    action();
+    return;
+  }
+  QTimer::singleShot(latency_ms_, this, action);
+}
+
+MobileServer::MobileServer(const ApiSchema& schema, int latency_ms, int heartbeat_ms, QObject *parent)
+  : QObject(parent),
+    schema_(schema),
+    latency_ms_(latency_ms),
+    heartbeat_ms_(heartbeat_ms) {
+  connect(&server_, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+bool MobileServer::listen(const QHostAddress& address, quint16 port) {
+  return server_.listen(address, port);
+}
+
+void MobileServer::onNewConnection() {
+  while (QTcpSocket *socket = server_.nextPendingConnection()) {
+    MobileConnection *connection =
+      new MobileConnection(socket, ++connections_, schema_, latency_ms_, heartbeat_ms_, this);
+    connect(connection, SIGNAL(appRegistered(QString,int)), this, SIGNAL(appRegistered(QString,int)));
+    connect(connection, SIGNAL(appUnregistered(int)), this, SIGNAL(appUnregistered(int)));
+  }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <functional>
+
+class ApiSchema;
+
+// Mobile side of mock SDL: one connection of mobile application over Ford
+// protocol. Control frames (services, heartbeat) are answered immediately,
+// RPC requests get canned response after configured latency.
+class MobileConnection : public QObject {
+  Q_OBJECT
+ public:
+  MobileConnection(QTcpSocket *socket, int id, const ApiSchema& schema,
+                   int latency_ms, int heartbeat_ms, QObject *parent = 0);
+ signals:
+  void appRegistered(const QString& app_name, int app_id);
+  void appUnregistered(int app_id);
+ private slots:
+  void onReadyRead();
+  void onDisconnected();
+  void onHeartbeat();
+ private:
+  struct Header {
+    quint8 version;
+    quint8 frame_type;
+    quint8 service_type;
+    quint8 frame_info;
+    quint8 session_id;
+    quint32 size;
+    quint32 message_id;
+  };
+  void onFrame(const Header& header, const QByteArray& payload);
+  void onControlFrame(const Header& header);
+  void onMessage(const Header& header, const QByteArray& message);
+  void onRequest(quint8 session_id, quint8 version, quint32 function_id,
+                 quint32 correlation_id, const QByteArray& json);
+  void sendRpc(quint8 session_id, quint8 version, quint8 rpc_type, quint32 function_id,
+               quint32 correlation_id, const QJsonObject& params);
+  void sendMessage(quint8 session_id, quint8 version, quint8 service_type, const QByteArray& payload);
+  void sendFrame(quint8 version, quint8 frame_type, quint8 service_type, quint8 frame_info,
+                 quint8 session_id, quint32 message_id, const QByteArray& payload);
+  void later(const std::function<void()>& action);
+
+  QTcpSocket *socket_;
+  const int id_;
+  const ApiSchema& schema_;
+  const int latency_ms_;
+  QByteArray buffer_;
+  QHash<quint32, QByteArray> assembly_; // multi-frame messages by service and session
+  QHash<quint8, quint8> sessions_;      // session id -> protocol version
+  QHash<quint8, int> apps_;             // session id -> registered application id
+  quint8 next_session_ = 1;
+  quint32 message_id_ = 0;
+  QTimer heartbeat_;
+};
+
+// Listens for mobile connections
+class MobileServer : public QObject {
+  Q_OBJECT
+ public:
+  MobileServer(const ApiSchema& schema, int latency_ms, int heartbeat_ms, QObject *parent = 0);
+  bool listen(const QHostAddress& address, quint16 port);
+  QString errorString() const { return server_.errorString(); }
+ signals:
+  void appRegistered(const QString& app_name, int app_id);
+  void appUnregistered(int app_id);
+ private slots:
+  void onNewConnection();
+ private:
+  QTcpServer server_;
+  const ApiSchema& schema_;
+  const int latency_ms_;
+  const int heartbeat_ms_;
+  int connections_ = 0;
+};
@@ -1,20 +1,33 @@
 #line 12 "network.nw"
 #include "network.h"
+#include "log_sink.h"
+#include "heartbeat_service.h"
+#include "web_socket_receiver.h"
+#include "lua_json.h"
+#include "io_thread_socket.h"
+#include "socket_stats.h"
+#include "perf_log_client.h"
+#include "virtual_clock.h"
 
 #include <QAbstractSocket>
 #include <QTcpSocket>
 #include <QTcpServer>
 #include <QWebSocket>
+#include <QWebSocketServer>
+#include <QLocalSocket>
+#include <QLocalServer>
 #include <QEventLoop>
 #include <QString>
 #include <unistd.h>
 #include <errno.h>
 #include <cstring>
 #include <cstdio>
+#include <sys/socket.h>
 #line 22 "network.nw"
 // TcpClient functions/*{{{*/
 int network_tcp_client(lua_State *L) {/*{{{*/
   QTcpSocket  *tcpSocket = new QTcpSocket();
+  SocketStats::of(tcpSocket);
   QTcpSocket **p = static_cast<QTcpSocket**>(lua_newuserdata(L, sizeof(QTcpServer*)));
   *p = tcpSocket;
   luaL_getmetatable(L, "network.TcpSocket");
@@ -55,6 +68,11 @@ QTcpSocket *tcpSocket =
   int maxSize = luaL_checkinteger(L, 2);
   if(tcpSocket->isOpen()){
     QByteArray result = tcpSocket->read(maxSize);
+    if (!result.isEmpty()) {
+      SocketStats *stats = SocketStats::of(tcpSocket);
+      stats->received(result.size(), 1);
+      stats->dispatched();
+    }
     lua_pushlstring(L, result.data(), result.count());
   } else {
     fprintf(stderr, "Error: Socket not opened");
@@ -70,6 +88,11 @@ QTcpSocket *tcpSocket =
   *static_cast<QTcpSocket**>(luaL_checkudata(L, 1, "network.TcpSocket"));
 #line 40 "network.nw"
   QByteArray result = tcpSocket->readAll();
+  if (!result.isEmpty()) {
+    SocketStats *stats = SocketStats::of(tcpSocket);
+    stats->received(result.size(), 1);
+    stats->dispatched();
+  }
   lua_pushlstring(L, result.data(), result.count());
   return 1;
 }/*}}}*/
@@ -84,6 +107,7 @@ QTcpSocket *tcpSocket =
   const char* data = luaL_checklstring(L, 2, &size);
   if(tcpSocket->isOpen()) {
     int result = tcpSocket->write(data, size);
+    if (result > 0) SocketStats::of(tcpSocket)->sent(result, 1);
     lua_pushinteger(L, result);
   } else {
     fprintf(stderr, "Error: Socket not opened");
@@ -99,6 +123,12 @@ QTcpSocket *tcpSocket =
   tcpSocket->close();
   return 0;
 }/*}}}*/
+int tcp_socket_stats(lua_State *L) {/*{{{*/
+  QTcpSocket *tcpSocket =
+    *static_cast<QTcpSocket**>(luaL_checkudata(L, 1, "network.TcpSocket"));
+  SocketStats::of(tcpSocket)->push(L, tcpSocket->bytesToWrite());
+  return 1;
+}/*}}}*/
 int tcp_socket_delete(lua_State *L) {/*{{{*/
 
 #line 65 "network.nw"
@@ -142,6 +172,7 @@ QTcpServer *tcpServer =
 #line 91 "network.nw"
   QTcpSocket *tcpSocket = tcpServer->nextPendingConnection();
   if (tcpSocket) {
+    SocketStats::of(tcpSocket);
     QTcpSocket **p = static_cast<QTcpSocket**>(lua_newuserdata(L, sizeof(QTcpServer*)));
     *p = tcpSocket;
     luaL_getmetatable(L, "network.TcpSocket");
@@ -167,6 +198,7 @@ QTcpServer *tcpServer =
 // WebSocket functions/*{{{*/
 int network_web_socket(lua_State *L) {/*{{{*/
   QWebSocket *webSocket = new QWebSocket();
+  SocketStats::of(webSocket);
   QWebSocket **p = static_cast<QWebSocket**>(lua_newuserdata(L, sizeof(QWebSocket*)));
   *p = webSocket;
   luaL_getmetatable(L, "network.WebSocket");
@@ -218,9 +250,48 @@ QWebSocket *webSocket =
   const char* data = luaL_checklstring(L, 2, &size);
   QByteArray b(data, size);
   int res = webSocket->sendTextMessage(b);
+  SocketStats::of(webSocket)->sent(size, 1);
   lua_pushinteger(L, res);
   return 1;
 }/*}}}*/
+int web_socket_write_binary(lua_State *L) {/*{{{*/
+  QWebSocket *webSocket =
+    *static_cast<QWebSocket**>(luaL_checkudata(L, 1, "network.WebSocket"));
+  size_t size;
+  const char* data = luaL_checklstring(L, 2, &size);
+  SocketStats::of(webSocket)->sent(size, 1);
+  lua_pushinteger(L, webSocket->sendBinaryMessage(QByteArray::fromRawData(data, size)));
+  return 1;
+}/*}}}*/
+int web_socket_write_batch(lua_State *L) {/*{{{*/
+  // Sends array of text messages by one call, returns total number of bytes sent
+  QWebSocket *webSocket =
+    *static_cast<QWebSocket**>(luaL_checkudata(L, 1, "network.WebSocket"));
+  luaL_checktype(L, 2, LUA_TTABLE);
+  const bool binary = lua_toboolean(L, 3);
+  const int count = luaL_len(L, 2);
+  SocketStats *stats = SocketStats::of(webSocket);
+  qint64 total = 0;
+  for (int i = 1; i <= count; ++i) {
+    lua_rawgeti(L, 2, i);
+    size_t size;
+    const char* data = lua_tolstring(L, -1, &size);
+    if (!data) return luaL_error(L, "write_batch: message %d is not a string", i);
+    QByteArray b = QByteArray::fromRawData(data, size);
+    total += binary ? webSocket->sendBinaryMessage(b) : webSocket->sendTextMessage(b);
+    stats->sent(size, 1);
+    lua_pop(L, 1);
+  }
+  lua_pushnumber(L, total);
+  return 1;
+}/*}}}*/
+int web_socket_stats(lua_State *L) {/*{{{*/
+  // Qt does not expose write buffer of web socket, so write_queue is not reported
+  QWebSocket *webSocket =
+    *static_cast<QWebSocket**>(luaL_checkudata(L, 1, "network.WebSocket"));
+  SocketStats::of(webSocket)->push(L, -1);
+  return 1;
+}/*}}}*/
 
 int web_socket_delete(lua_State *L) {/*{{{*/
 
@@ -232,6 +303,500 @@ QWebSocket *webSocket =
   return 0;
 }/*}}}*/
 /*}}}*/
+// WebSocketServer functions/*{{{*/
+int network_web_socket_server(lua_State *L) {/*{{{*/
+  QWebSocketServer **p = static_cast<QWebSocketServer**>(lua_newuserdata(L, sizeof(QWebSocketServer*)));
+  *p = new QWebSocketServer("ATF", QWebSocketServer::NonSecureMode);
+  luaL_getmetatable(L, "network.WebSocketServer");
+  lua_setmetatable(L, -2);
+  return 1;
+}/*}}}*/
+int web_socket_server_listen(lua_State *L) {/*{{{*/
+  QWebSocketServer *server =
+    *static_cast<QWebSocketServer**>(luaL_checkudata(L, 1, "network.WebSocketServer"));
+  QHostAddress addr(QString(luaL_checkstring(L, 2)));
+  int port = luaL_checkinteger(L, 3);
+  lua_pushboolean(L, server->listen(addr, port));
+  return 1;
+}/*}}}*/
+int web_socket_server_get_connection(lua_State *L) {/*{{{*/
+  QWebSocketServer *server =
+    *static_cast<QWebSocketServer**>(luaL_checkudata(L, 1, "network.WebSocketServer"));
+  QWebSocket *webSocket = server->nextPendingConnection();
+  if (webSocket) {
+    SocketStats::of(webSocket);
+    QWebSocket **p = static_cast<QWebSocket**>(lua_newuserdata(L, sizeof(QWebSocket*)));
+    *p = webSocket;
+    luaL_getmetatable(L, "network.WebSocket");
+    lua_setmetatable(L, -2);
+  } else {
+    lua_pushnil(L);
+  }
+  return 1;
+}/*}}}*/
+int web_socket_server_delete(lua_State *L) {/*{{{*/
+  QWebSocketServer *server =
+    *static_cast<QWebSocketServer**>(luaL_checkudata(L, 1, "network.WebSocketServer"));
+  delete server;
+  return 0;
+}/*}}}*/
+/*}}}*/
+// WebSocketReceiver functions/*{{{*/
+int network_web_socket_receiver(lua_State *L) {/*{{{*/
+  QWebSocket *webSocket =
+    *static_cast<QWebSocket**>(luaL_checkudata(L, 1, "network.WebSocket"));
+  const bool parse_json = lua_toboolean(L, 2);
+  WebSocketReceiver **p = static_cast<WebSocketReceiver**>(lua_newuserdata(L, sizeof(WebSocketReceiver*)));
+  *p = new WebSocketReceiver(webSocket);
+  luaL_getmetatable(L, "network.WebSocketReceiver");
+  lua_setmetatable(L, -2);
+  // Mode is kept in uservalue, qtlua uses uservalue only for dynamic objects
+  lua_newtable(L);
+  lua_pushboolean(L, parse_json);
+  lua_setfield(L, -2, "parse_json");
+  lua_setuservalue(L, -2);
+  return 1;
+}/*}}}*/
+int web_socket_receiver_read_all(lua_State *L) {/*{{{*/
+  // Returns array of received texts and, if receiver parses JSON, array of
+  // decoded tables (false for texts which are not valid JSON)
+  WebSocketReceiver *receiver =
+    *static_cast<WebSocketReceiver**>(luaL_checkudata(L, 1, "network.WebSocketReceiver"));
+  lua_getuservalue(L, 1);
+  lua_getfield(L, -1, "parse_json");
+  const bool parse_json = lua_toboolean(L, -1);
+  lua_pop(L, 2);
+
+  QList<QByteArray> messages = receiver->takeMessages();
+  lua_createtable(L, messages.size(), 0);
+  if (parse_json) lua_createtable(L, messages.size(), 0);
+  const int texts = parse_json ? -2 : -1;
+  int i = 0;
+  for (const QByteArray& message : messages) {
+    ++i;
+    lua_pushlstring(L, message.constData(), message.size());
+    lua_rawseti(L, texts - 1, i);
+    if (parse_json) {
+      if (!lua_push_json(L, message)) lua_pushboolean(L, false);
+      lua_rawseti(L, -2, i);
+    }
+  }
+  return parse_json ? 2 : 1;
+}/*}}}*/
+int network_json_decode(lua_State *L) {/*{{{*/
+  // Decodes JSON text as WebSocketReceiver does, returns false if native decoder rejects it
+  size_t size;
+  const char* text = luaL_checklstring(L, 1, &size);
+  if (!lua_push_json(L, QByteArray::fromRawData(text, size))) lua_pushboolean(L, false);
+  return 1;
+}/*}}}*/
+int web_socket_receiver_pending(lua_State *L) {/*{{{*/
+  WebSocketReceiver *receiver =
+    *static_cast<WebSocketReceiver**>(luaL_checkudata(L, 1, "network.WebSocketReceiver"));
+  lua_pushinteger(L, receiver->pending());
+  return 1;
+}/*}}}*/
+int web_socket_receiver_delete(lua_State *L) {/*{{{*/
+  WebSocketReceiver *receiver =
+    *static_cast<WebSocketReceiver**>(luaL_checkudata(L, 1, "network.WebSocketReceiver"));
+  delete receiver;
+  return 0;
+}/*}}}*/
+/*}}}*/
+// ThreadedTcpSocket functions/*{{{*/
+int network_threaded_tcp_client(lua_State *L) {/*{{{*/
+  IoThreadSocket **p = static_cast<IoThreadSocket**>(lua_newuserdata(L, sizeof(IoThreadSocket*)));
+  *p = new IoThreadSocket();
+  SocketStats::of(*p);
+  luaL_getmetatable(L, "network.ThreadedTcpSocket");
+  lua_setmetatable(L, -2);
+  return 1;
+}/*}}}*/
+int threaded_tcp_socket_connect(lua_State *L) {/*{{{*/
+  IoThreadSocket *socket =
+    *static_cast<IoThreadSocket**>(luaL_checkudata(L, 1, "network.ThreadedTcpSocket"));
+  const char* host = luaL_checkstring(L, 2);
+  int         port = luaL_checkinteger(L, 3);
+  const int time_waiting_ms = 1000;
+  lua_pushboolean(L, socket->connect(host, port, time_waiting_ms));
+  return 1;
+}/*}}}*/
+int threaded_tcp_socket_read_all(lua_State *L) {/*{{{*/
+  // Returns array of complete frames received by I/O thread
+  IoThreadSocket *socket =
+    *static_cast<IoThreadSocket**>(luaL_checkudata(L, 1, "network.ThreadedTcpSocket"));
+  qint64 received_us = -1;
+  QList<QByteArray> frames = socket->takeFrames(&received_us);
+  lua_createtable(L, frames.size(), 0);
+  int i = 0;
+  qint64 bytes = 0;
+  for (const QByteArray& frame : frames) {
+    lua_pushlstring(L, frame.constData(), frame.size());
+    lua_rawseti(L, -2, ++i);
+    bytes += frame.size();
+  }
+  if (!frames.isEmpty()) {
+    SocketStats *stats = SocketStats::of(socket);
+    stats->received(bytes, frames.size());
+    stats->dispatched(received_us);
+  }
+  return 1;
+}/*}}}*/
+int threaded_tcp_socket_write(lua_State *L) {/*{{{*/
+  IoThreadSocket *socket =
+    *static_cast<IoThreadSocket**>(luaL_checkudata(L, 1, "network.ThreadedTcpSocket"));
+  size_t size;
+  const char* data = luaL_checklstring(L, 2, &size);
+  qint64 res = socket->write(QByteArray(data, size));
+  if (res < 0) fprintf(stderr, "Error: Socket not opened");
+  else SocketStats::of(socket)->sent(res, 1);
+  lua_pushinteger(L, res);
+  return 1;
+}/*}}}*/
+int threaded_tcp_socket_close(lua_State *L) {/*{{{*/
+  IoThreadSocket *socket =
+    *static_cast<IoThreadSocket**>(luaL_checkudata(L, 1, "network.ThreadedTcpSocket"));
+  socket->close();
+  return 0;
+}/*}}}*/
+int threaded_tcp_socket_stats(lua_State *L) {/*{{{*/
+  IoThreadSocket *socket =
+    *static_cast<IoThreadSocket**>(luaL_checkudata(L, 1, "network.ThreadedTcpSocket"));
+  SocketStats::of(socket)->push(L, socket->writeQueue(), socket->pendingSince());
+  return 1;
+}/*}}}*/
+int threaded_tcp_socket_delete(lua_State *L) {/*{{{*/
+  IoThreadSocket *socket =
+    *static_cast<IoThreadSocket**>(luaL_checkudata(L, 1, "network.ThreadedTcpSocket"));
+  delete socket;
+  return 0;
+}/*}}}*/
+/*}}}*/
+// LocalSocket functions/*{{{*/
+void push_local_socket(lua_State *L, QLocalSocket *localSocket) {/*{{{*/
+  SocketStats::of(localSocket);
+  QLocalSocket **p = static_cast<QLocalSocket**>(lua_newuserdata(L, sizeof(QLocalSocket*)));
+  *p = localSocket;
+  luaL_getmetatable(L, "network.LocalSocket");
+  lua_setmetatable(L, -2);
+}/*}}}*/
+int network_local_client(lua_State *L) {/*{{{*/
+  push_local_socket(L, new QLocalSocket());
+  return 1;
+}/*}}}*/
+int network_socketpair(lua_State *L) {/*{{{*/
+  // Both ends are connected already, no listening socket is involved
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+    fprintf(stderr, "Error: socketpair failed\n%s\n", strerror(errno));
+    lua_pushnil(L);
+    return 1;
+  }
+  for (int fd : fds) {
+    QLocalSocket *localSocket = new QLocalSocket();
+    localSocket->setSocketDescriptor(fd);
+    push_local_socket(L, localSocket);
+  }
+  return 2;
+}/*}}}*/
+int local_socket_connect(lua_State *L) {/*{{{*/
+  QLocalSocket *localSocket =
+    *static_cast<QLocalSocket**>(luaL_checkudata(L, 1, "network.LocalSocket"));
+  const char* name = luaL_checkstring(L, 2);
+
+  // Server may be not listening yet, so connection is retried as for TcpSocket
+  const int time_waiting_ms = 1000;
+  QTime timer;
+  timer.start();
+  localSocket->connectToServer(name);
+  while (!localSocket->waitForConnected(100)) {
+    if (timer.elapsed() > time_waiting_ms) {
+      fprintf(stderr, "%s\n%s\n", "Error: Connection not established",
+              localSocket->errorString().toUtf8().constData());
+      lua_pushboolean(L, false);
+      return 1;
+    }
+    localSocket->connectToServer(name);
+  }
+  lua_pushboolean(L, true);
+  return 1;
+}/*}}}*/
+int local_socket_read(lua_State *L) {/*{{{*/
+  QLocalSocket *localSocket =
+    *static_cast<QLocalSocket**>(luaL_checkudata(L, 1, "network.LocalSocket"));
+  int maxSize = luaL_checkinteger(L, 2);
+  QByteArray result = localSocket->read(maxSize);
+  if (!result.isEmpty()) {
+    SocketStats *stats = SocketStats::of(localSocket);
+    stats->received(result.size(), 1);
+    stats->dispatched();
+  }
+  lua_pushlstring(L, result.data(), result.count());
+  return 1;
+}/*}}}*/
+int local_socket_read_all(lua_State *L) {/*{{{*/
+  QLocalSocket *localSocket =
+    *static_cast<QLocalSocket**>(luaL_checkudata(L, 1, "network.LocalSocket"));
+  QByteArray result = localSocket->readAll();
+  if (!result.isEmpty()) {
+    SocketStats *stats = SocketStats::of(localSocket);
+    stats->received(result.size(), 1);
+    stats->dispatched();
+  }
+  lua_pushlstring(L, result.data(), result.count());
+  return 1;
+}/*}}}*/
+int local_socket_write(lua_State *L) {/*{{{*/
+  QLocalSocket *localSocket =
+    *static_cast<QLocalSocket**>(luaL_checkudata(L, 1, "network.LocalSocket"));
+  size_t size;
+  const char* data = luaL_checklstring(L, 2, &size);
+  if (localSocket->isOpen()) {
+    const qint64 res = localSocket->write(data, size);
+    if (res > 0) SocketStats::of(localSocket)->sent(res, 1);
+    lua_pushinteger(L, res);
+  } else {
+    fprintf(stderr, "Error: Socket not opened");
+    lua_pushinteger(L, -1);
+  }
+  return 1;
+}/*}}}*/
+int local_socket_close(lua_State *L) {/*{{{*/
+  QLocalSocket *localSocket =
+    *static_cast<QLocalSocket**>(luaL_checkudata(L, 1, "network.LocalSocket"));
+  localSocket->close();
+  return 0;
+}/*}}}*/
+int local_socket_stats(lua_State *L) {/*{{{*/
+  QLocalSocket *localSocket =
+    *static_cast<QLocalSocket**>(luaL_checkudata(L, 1, "network.LocalSocket"));
+  SocketStats::of(localSocket)->push(L, localSocket->bytesToWrite());
+  return 1;
+}/*}}}*/
+int local_socket_delete(lua_State *L) {/*{{{*/
+  QLocalSocket *localSocket =
+    *static_cast<QLocalSocket**>(luaL_checkudata(L, 1, "network.LocalSocket"));
+  delete localSocket;
+  return 0;
+}/*}}}*/
+/*}}}*/
+// LocalServer functions/*{{{*/
+int network_local_server(lua_State *L) {/*{{{*/
+  QLocalServer **p = static_cast<QLocalServer**>(lua_newuserdata(L, sizeof(QLocalServer*)));
+  *p = new QLocalServer();
+  luaL_getmetatable(L, "network.LocalServer");
+  lua_setmetatable(L, -2);
+  return 1;
+}/*}}}*/
+int local_server_listen(lua_State *L) {/*{{{*/
+  QLocalServer *localServer =
+    *static_cast<QLocalServer**>(luaL_checkudata(L, 1, "network.LocalServer"));
+  const char* name = luaL_checkstring(L, 2);
+  // Socket file left by crashed run is removed, there is nothing to wait for
+  QLocalServer::removeServer(name);
+  lua_pushboolean(L, localServer->listen(name));
+  return 1;
+}/*}}}*/
+int local_server_get_connection(lua_State *L) {/*{{{*/
+  QLocalServer *localServer =
+    *static_cast<QLocalServer**>(luaL_checkudata(L, 1, "network.LocalServer"));
+  QLocalSocket *localSocket = localServer->nextPendingConnection();
+  if (localSocket) {
+    // Socket is owned by Lua, not by server
+    localSocket->setParent(nullptr);
+    push_local_socket(L, localSocket);
+  } else {
+    lua_pushnil(L);
+  }
+  return 1;
+}/*}}}*/
+int local_server_close(lua_State *L) {/*{{{*/
+  QLocalServer *localServer =
+    *static_cast<QLocalServer**>(luaL_checkudata(L, 1, "network.LocalServer"));
+  localServer->close();
+  return 0;
+}/*}}}*/
+int local_server_delete(lua_State *L) {/*{{{*/
+  QLocalServer *localServer =
+    *static_cast<QLocalServer**>(luaL_checkudata(L, 1, "network.LocalServer"));
+  delete localServer;
+  return 0;
+}/*}}}*/
+/*}}}*/
+// LogSink functions/*{{{*/
+int network_log_sink(lua_State *L) {/*{{{*/
+  LogSink **p = static_cast<LogSink**>(lua_newuserdata(L, sizeof(LogSink*)));
+  *p = new LogSink();
+  luaL_getmetatable(L, "network.LogSink");
+  lua_setmetatable(L, -2);
+  return 1;
+}/*}}}*/
+int log_sink_connect(lua_State *L) {/*{{{*/
+  LogSink *sink = *static_cast<LogSink**>(luaL_checkudata(L, 1, "network.LogSink"));
+  const char* host = luaL_checkstring(L, 2);
+  int         port = luaL_checkinteger(L, 3);
+  const int time_waiting_ms = 1000;
+  lua_pushboolean(L, sink->connect(host, port, time_waiting_ms));
+  return 1;
+}/*}}}*/
+int log_sink_start(lua_State *L) {/*{{{*/
+  LogSink *sink = *static_cast<LogSink**>(luaL_checkudata(L, 1, "network.LogSink"));
+  const char* filename = luaL_checkstring(L, 2);
+  lua_pushboolean(L, sink->start(filename));
+  return 1;
+}/*}}}*/
+int log_sink_stop(lua_State *L) {/*{{{*/
+  LogSink *sink = *static_cast<LogSink**>(luaL_checkudata(L, 1, "network.LogSink"));
+  sink->stop();
+  lua_pushnumber(L, sink->bytes());
+  return 1;
+}/*}}}*/
+int log_sink_reopen(lua_State *L) {/*{{{*/
+  LogSink *sink = *static_cast<LogSink**>(luaL_checkudata(L, 1, "network.LogSink"));
+  const char* filename = luaL_checkstring(L, 2);
+  lua_pushboolean(L, sink->reopen(filename));
+  return 1;
+}/*}}}*/
+int log_sink_bytes(lua_State *L) {/*{{{*/
+  LogSink *sink = *static_cast<LogSink**>(luaL_checkudata(L, 1, "network.LogSink"));
+  lua_pushnumber(L, sink->bytes());
+  return 1;
+}/*}}}*/
+int log_sink_is_running(lua_State *L) {/*{{{*/
+  LogSink *sink = *static_cast<LogSink**>(luaL_checkudata(L, 1, "network.LogSink"));
+  lua_pushboolean(L, sink->isRunning());
+  return 1;
+}/*}}}*/
+int log_sink_delete(lua_State *L) {/*{{{*/
+  LogSink *sink = *static_cast<LogSink**>(luaL_checkudata(L, 1, "network.LogSink"));
+  delete sink;
+  return 0;
+}/*}}}*/
+/*}}}*/
+// PerfLogClient functions/*{{{*/
+int network_perf_log_client(lua_State *L) {/*{{{*/
+  PerfLogClient **p = static_cast<PerfLogClient**>(lua_newuserdata(L, sizeof(PerfLogClient*)));
+  *p = new PerfLogClient();
+  luaL_getmetatable(L, "network.PerfLogClient");
+  lua_setmetatable(L, -2);
+  return 1;
+}/*}}}*/
+int perf_log_client_connect(lua_State *L) {/*{{{*/
+  PerfLogClient *client =
+    *static_cast<PerfLogClient**>(luaL_checkudata(L, 1, "network.PerfLogClient"));
+  const char* host = luaL_checkstring(L, 2);
+  int         port = luaL_checkinteger(L, 3);
+  const int time_waiting_ms = 1000;
+  lua_pushboolean(L, client->connect(host, port, time_waiting_ms));
+  return 1;
+}/*}}}*/
+int perf_log_client_read_all(lua_State *L) {/*{{{*/
+  // Returns array of records, time of arrival is on clock of timestamp()
+  PerfLogClient *client =
+    *static_cast<PerfLogClient**>(luaL_checkudata(L, 1, "network.PerfLogClient"));
+  const QList<PerfLogClient::Record> records = client->takeRecords();
+  const qint64 offset = VirtualClock::offset();
+  lua_createtable(L, records.size(), 0);
+  int i = 0;
+  for (const PerfLogClient::Record& record : records) {
+    lua_createtable(L, 0, 5);
+    lua_pushnumber(L, record.sdl_us / 1000.0);
+    lua_setfield(L, -2, "sdl_time");
+    lua_pushnumber(L, record.received_us / 1000.0 + offset);
+    lua_setfield(L, -2, "received");
+    lua_pushstring(L, PerfLogClient::pointName(record.point));
+    lua_setfield(L, -2, "point");
+    lua_pushinteger(L, record.session);
+    lua_setfield(L, -2, "session");
+    lua_pushnumber(L, record.correlation_id);
+    lua_setfield(L, -2, "correlation_id");
+    lua_rawseti(L, -2, ++i);
+  }
+  return 1;
+}/*}}}*/
+int perf_log_client_dropped(lua_State *L) {/*{{{*/
+  PerfLogClient *client =
+    *static_cast<PerfLogClient**>(luaL_checkudata(L, 1, "network.PerfLogClient"));
+  lua_pushnumber(L, client->dropped());
+  return 1;
+}/*}}}*/
+int perf_log_client_is_connected(lua_State *L) {/*{{{*/
+  PerfLogClient *client =
+    *static_cast<PerfLogClient**>(luaL_checkudata(L, 1, "network.PerfLogClient"));
+  lua_pushboolean(L, client->isConnected());
+  return 1;
+}/*}}}*/
+int perf_log_client_close(lua_State *L) {/*{{{*/
+  PerfLogClient *client =
+    *static_cast<PerfLogClient**>(luaL_checkudata(L, 1, "network.PerfLogClient"));
+  client->close();
+  return 0;
+}/*}}}*/
+int perf_log_client_delete(lua_State *L) {/*{{{*/
+  PerfLogClient *client =
+    *static_cast<PerfLogClient**>(luaL_checkudata(L, 1, "network.PerfLogClient"));
+  delete client;
+  return 0;
+}/*}}}*/
+int network_heartbeat_service(lua_State *L) {/*{{{*/
+  // Socket of connection may be served by I/O thread
+  HeartbeatService *hb;
+  if (void *threaded = luaL_testudata(L, 1, "network.ThreadedTcpSocket")) {
+    hb = new HeartbeatService(*static_cast<IoThreadSocket**>(threaded));
+  } else {
+    hb = new HeartbeatService(*static_cast<QTcpSocket**>(luaL_checkudata(L, 1, "network.TcpSocket")));
+  }
+  HeartbeatService **p = static_cast<HeartbeatService**>(lua_newuserdata(L, sizeof(HeartbeatService*)));
+  *p = hb;
+  luaL_getmetatable(L, "network.HeartbeatService");
+  lua_setmetatable(L, -2);
+  return 1;
+}/*}}}*/
+int heartbeat_service_start(lua_State *L) {/*{{{*/
+  HeartbeatService *hb =
+    *static_cast<HeartbeatService**>(luaL_checkudata(L, 1, "network.HeartbeatService"));
+  int session_id = luaL_checkinteger(L, 2);
+  int version    = luaL_checkinteger(L, 3);
+  int interval   = luaL_checkinteger(L, 4);
+  int timeout    = luaL_checkinteger(L, 5);
+  hb->start(session_id, version, interval, timeout);
+  return 0;
+}/*}}}*/
+int heartbeat_service_stop(lua_State *L) {/*{{{*/
+  HeartbeatService *hb =
+    *static_cast<HeartbeatService**>(luaL_checkudata(L, 1, "network.HeartbeatService"));
+  hb->stop(luaL_checkinteger(L, 2));
+  return 0;
+}/*}}}*/
+int heartbeat_service_set_flags(lua_State *L) {/*{{{*/
+  HeartbeatService *hb =
+    *static_cast<HeartbeatService**>(luaL_checkudata(L, 1, "network.HeartbeatService"));
+  int session_id = luaL_checkinteger(L, 2);
+  hb->setFlags(session_id, lua_toboolean(L, 3), lua_toboolean(L, 4), lua_toboolean(L, 5));
+  return 0;
+}/*}}}*/
+int heartbeat_service_set_interval(lua_State *L) {/*{{{*/
+  HeartbeatService *hb =
+    *static_cast<HeartbeatService**>(luaL_checkudata(L, 1, "network.HeartbeatService"));
+  int session_id = luaL_checkinteger(L, 2);
+  int interval   = luaL_checkinteger(L, 3);
+  int timeout    = luaL_checkinteger(L, 4);
+  hb->setInterval(session_id, interval, timeout);
+  return 0;
+}/*}}}*/
+int heartbeat_service_sessions(lua_State *L) {/*{{{*/
+  HeartbeatService *hb =
+    *static_cast<HeartbeatService**>(luaL_checkudata(L, 1, "network.HeartbeatService"));
+  lua_pushinteger(L, hb->sessions());
+  return 1;
+}/*}}}*/
+int heartbeat_service_delete(lua_State *L) {/*{{{*/
+  HeartbeatService *hb =
+    *static_cast<HeartbeatService**>(luaL_checkudata(L, 1, "network.HeartbeatService"));
+  delete hb;
+  return 0;
+}/*}}}*/
+/*}}}*/
 #line 158 "network.nw"
 int luaopen_network(lua_State *L) {
   lua_newtable(L);
@@ -259,6 +824,7 @@ int luaopen_network(lua_State *L) {
     { "read_all", &tcp_socket_read_all },
     { "write", &tcp_socket_write },
     { "close", &tcp_socket_close },
+    { "stats", &tcp_socket_stats },
     { NULL, NULL }
   };
   luaL_setfuncs(L, tcp_socket_functions, 0);
@@ -273,17 +839,144 @@ int luaopen_network(lua_State *L) {
     { "open", &web_socket_open },
     { "close", &web_socket_close },
     { "write", &web_socket_write },
+    { "write_binary", &web_socket_write_binary },
+    { "write_batch", &web_socket_write_batch },
+    { "stats", &web_socket_stats },
     { NULL, NULL }
   };
   luaL_setfuncs(L, web_socket_functions, 0);
   lua_setfield(L, -2, "__index");
   lua_pushcfunction(L, web_socket_delete);
   lua_setfield(L, -2, "__gc");/*}}}*/
+  // WebSocketServer metatable/*{{{*/
+  luaL_newmetatable(L, "network.WebSocketServer");
+  lua_newtable(L);
+  luaL_Reg web_socket_server_functions[] = {
+    { "listen", &web_socket_server_listen },
+    { "get_connection", &web_socket_server_get_connection },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, web_socket_server_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, web_socket_server_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
+  // WebSocketReceiver metatable/*{{{*/
+  luaL_newmetatable(L, "network.WebSocketReceiver");
+  lua_newtable(L);
+  luaL_Reg web_socket_receiver_functions[] = {
+    { "read_all", &web_socket_receiver_read_all },
+    { "pending", &web_socket_receiver_pending },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, web_socket_receiver_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, web_socket_receiver_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
+  // ThreadedTcpSocket metatable/*{{{*/
+  luaL_newmetatable(L, "network.ThreadedTcpSocket");
+  lua_newtable(L);
+  luaL_Reg threaded_tcp_socket_functions[] = {
+    { "connect", &threaded_tcp_socket_connect },
+    { "read_all", &threaded_tcp_socket_read_all },
+    { "write", &threaded_tcp_socket_write },
+    { "close", &threaded_tcp_socket_close },
+    { "stats", &threaded_tcp_socket_stats },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, threaded_tcp_socket_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, threaded_tcp_socket_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
+  // LocalServer metatable/*{{{*/
+  luaL_newmetatable(L, "network.LocalServer");
+  lua_newtable(L);
+  luaL_Reg local_server_functions[] = {
+    { "listen", &local_server_listen },
+    { "get_connection", &local_server_get_connection },
+    { "close", &local_server_close },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, local_server_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, local_server_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
+  // LocalSocket metatable/*{{{*/
+  luaL_newmetatable(L, "network.LocalSocket");
+  lua_newtable(L);
+  luaL_Reg local_socket_functions[] = {
+    { "connect", &local_socket_connect },
+    { "read", &local_socket_read },
+    { "read_all", &local_socket_read_all },
+    { "write", &local_socket_write },
+    { "close", &local_socket_close },
+    { "stats", &local_socket_stats },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, local_socket_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, local_socket_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
+  // LogSink metatable/*{{{*/
+  luaL_newmetatable(L, "network.LogSink");
+  lua_newtable(L);
+  luaL_Reg log_sink_functions[] = {
+    { "connect", &log_sink_connect },
+    { "start", &log_sink_start },
+    { "stop", &log_sink_stop },
+    { "reopen", &log_sink_reopen },
+    { "bytes", &log_sink_bytes },
+    { "is_running", &log_sink_is_running },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, log_sink_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, log_sink_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
+  // PerfLogClient metatable/*{{{*/
+  luaL_newmetatable(L, "network.PerfLogClient");
+  lua_newtable(L);
+  luaL_Reg perf_log_client_functions[] = {
+    { "connect", &perf_log_client_connect },
+    { "read_all", &perf_log_client_read_all },
+    { "dropped", &perf_log_client_dropped },
+    { "is_connected", &perf_log_client_is_connected },
+    { "close", &perf_log_client_close },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, perf_log_client_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, perf_log_client_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
+  // HeartbeatService metatable/*{{{*/
+  luaL_newmetatable(L, "network.HeartbeatService");
+  lua_newtable(L);
+  luaL_Reg heartbeat_service_functions[] = {
+    { "start", &heartbeat_service_start },
+    { "stop", &heartbeat_service_stop },
+    { "setFlags", &heartbeat_service_set_flags },
+    { "setInterval", &heartbeat_service_set_interval },
+    { "sessions", &heartbeat_service_sessions },
+    { NULL, NULL }
+  };
+  luaL_setfuncs(L, heartbeat_service_functions, 0);
+  lua_setfield(L, -2, "__index");
+  lua_pushcfunction(L, heartbeat_service_delete);
+  lua_setfield(L, -2, "__gc");/*}}}*/
 
   luaL_Reg network_functions[] = {
     { "TcpClient", &network_tcp_client },
     { "TcpServer", &network_tcp_server },
+    { "ThreadedTcpClient", &network_threaded_tcp_client },
     { "WebSocket", &network_web_socket },
+    { "WebSocketServer", &network_web_socket_server },
+    { "WebSocketReceiver", &network_web_socket_receiver },
+    { "json_decode", &network_json_decode },
+    { "LocalClient", &network_local_client },
+    { "LocalServer", &network_local_server },
+    { "socketpair", &network_socketpair },
+    { "LogSink", &network_log_sink },
+    { "PerfLogClient", &network_perf_log_client },
+    { "HeartbeatService", &network_heartbeat_service },
     { NULL, NULL }
   };
   luaL_newlib(L, network_functions);
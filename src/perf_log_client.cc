@@ -0,0 +1,177 @@
+#include "perf_log_client.h"
+#include "socket_stats.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <initializer_list>
+
+namespace {
+const size_t kQueueCapacity = 4096;
+const size_t kChunkSize = 64 * 1024;
+const char kMarker[] = "PERF ";
+const char *kPointNames[] = { "mob_in", "hmi_out", "hmi_in", "mob_out" };
+
+qint64 now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<qint64>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+int connect_once(const char *host, int port) {
+  struct addrinfo hints, *addrs = NULL;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+  if (getaddrinfo(host, service, &hints, &addrs) != 0) {
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo *a = addrs; a; a = a->ai_next) {
+    fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+    if (fd < 0) continue;
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) break;
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addrs);
+  return fd;
+}
+
+// Parses fields of record following the marker, end points past the line
+bool parse_record(const char *p, const char *end, PerfLogClient::Record *record) {
+  char *next;
+  record->sdl_us = strtoll(p, &next, 10);
+  if (next == p || next >= end) return false;
+  while (next < end && *next == ' ') ++next;
+  record->point = -1;
+  for (int i = 0; i < PerfLogClient::kPointCount; ++i) {
+    const size_t len = strlen(kPointNames[i]);
+    if (next + len < end && strncmp(next, kPointNames[i], len) == 0 && next[len] == ' ') {
+      record->point = i;
+      next += len;
+      break;
+    }
+  }
+  if (record->point < 0) return false;
+  p = next;
+  record->session = strtol(p, &next, 10);
+  if (next == p || next >= end) return false;
+  p = next;
+  record->correlation_id = strtoll(p, &next, 10);
+  return next != p && next <= end;
+}
+}  // anonymous namespace
+
+PerfLogClient::PerfLogClient()
+  : running_(false),
+    dropped_(0),
+    records_(kQueueCapacity) {
+}
+
+PerfLogClient::~PerfLogClient() {
+  close();
+}
+
+const char *PerfLogClient::pointName(int point) {
+  return point >= 0 && point < kPointCount ? kPointNames[point] : "";
+}
+
+bool PerfLogClient::connect(const QByteArray& host, int port, int timeout_ms) {
+  close();
+  const qint64 start = now_ms();
+  while ((sock_fd_ = connect_once(host.constData(), port)) < 0) {
+    if (now_ms() - start > timeout_ms) {
+      fprintf(stderr, "%s\n%s\n", "Error: Connection not established", strerror(errno));
+      return false;
+    }
+    usleep(10000);
+  }
+  if (pipe2(stop_pipe_, O_CLOEXEC) != 0) {
+    ::close(sock_fd_);
+    sock_fd_ = -1;
+    return false;
+  }
+  running_ = true;
+  thread_ = std::thread(&PerfLogClient::run, this);
+  return true;
+}
+
+QList<PerfLogClient::Record> PerfLogClient::takeRecords() {
+  QList<Record> res;
+  Record record;
+  while (records_.pop(&record)) res.append(record);
+  return res;
+}
+
+void PerfLogClient::close() {
+  if (thread_.joinable()) {
+    // Wake up poll() in reading thread
+    char c = 0;
+    if (write(stop_pipe_[1], &c, 1) < 0) {
+      perror("PerfLogClient: close");
+    }
+    thread_.join();
+  }
+  for (int *fd : { &sock_fd_, &stop_pipe_[0], &stop_pipe_[1] }) {
+    if (*fd >= 0) {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+  input_.clear();
+  running_ = false;
+}
+
+void PerfLogClient::parseLines() {
+  const char *data = input_.constData();
+  const char *end = data + input_.size();
+  const char *line = data;
+  const qint64 received_us = SocketStats::now_us();
+  while (const char *eol = static_cast<const char*>(memchr(line, '\n', end - line))) {
+    const char *marker = static_cast<const char*>(
+      memmem(line, eol - line, kMarker, sizeof(kMarker) - 1));
+    Record record;
+    if (marker && parse_record(marker + sizeof(kMarker) - 1, eol, &record)) {
+      record.received_us = received_us;
+      if (!records_.push(record)) ++dropped_;
+    }
+    line = eol + 1;
+  }
+  input_.remove(0, line - data);
+}
+
+void PerfLogClient::run() {
+  char buffer[kChunkSize];
+  struct pollfd fds[2];
+  fds[0].fd = sock_fd_;
+  fds[0].events = POLLIN;
+  fds[1].fd = stop_pipe_[0];
+  fds[1].events = POLLIN;
+
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (fds[1].revents & POLLIN) break;
+    if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+    const ssize_t received = read(sock_fd_, buffer, sizeof(buffer));
+    if (received == 0) break;  // SDL closed performance log connection
+    if (received < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      break;
+    }
+    input_.append(buffer, received);
+    parseLines();
+  }
+  running_ = false;
+}
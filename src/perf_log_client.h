@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <atomic>
+#include <thread>
+#include "spsc_queue.h"
+
+// Client of SDL performance log. Dedicated thread reads the TCP stream,
+// picks timing records out of log lines and posts them to Lua thread through
+// lock-free queue, other lines are skipped without copying.
+// Record is a line containing
+//   PERF <sdl_time_us> <point> <session_id> <correlation_id>
+// where point is one of mob_in (SDL received mobile request), hmi_out
+// (SDL sent HMI request for it), hmi_in (SDL received HMI response) and
+// mob_out (SDL sent mobile response), so the marker may follow any prefix
+// added by SDL logger.
+class PerfLogClient {
+ public:
+  enum Point { kMobIn, kHmiOut, kHmiIn, kMobOut, kPointCount };
+  struct Record {
+    qint64 sdl_us;
+    // Monotonic time of arrival of the record
+    qint64 received_us;
+    int point;
+    int session;
+    qint64 correlation_id;
+  };
+
+  PerfLogClient();
+  ~PerfLogClient();
+  // Connects to host:port, retries during timeout_ms, starts reading thread
+  bool connect(const QByteArray& host, int port, int timeout_ms);
+  // Returns records received since previous call
+  QList<Record> takeRecords();
+  // Stops reading thread and closes connection
+  void close();
+  bool isConnected() const { return running_; }
+  // Records lost because Lua didn't take them in time
+  quint64 dropped() const { return dropped_; }
+  static const char *pointName(int point);
+ private:
+  void run();
+  void parseLines();
+
+  int sock_fd_ = -1;
+  int stop_pipe_[2] = { -1, -1 };
+  std::thread thread_;
+  std::atomic<bool> running_;
+  std::atomic<quint64> dropped_;
+  SpscQueue<Record> records_;
+  // Owned by reading thread: incomplete line
+  QByteArray input_;
+};
@@ -1,7 +1,8 @@
 #include "qdatetime.h"
+#include "virtual_clock.h"
 
 int qdatetime_get_datetime(lua_State* L) {
-  const QDateTime time(QDateTime::currentDateTime());
+  const QDateTime time(QDateTime::currentDateTime().addMSecs(VirtualClock::offset()));
   const char* const format_raw = luaL_checkstring(L, 1);
   const QString format(format_raw);
   const QString time_string(time.toString(format));
@@ -0,0 +1,92 @@
+#include "socket_stats.h"
+
+#include <time.h>
+#include <QIODevice>
+#include <QWebSocket>
+
+SocketStats* SocketStats::of(QObject *socket) {
+  SocketStats *stats = socket->findChild<SocketStats*>(QString(), Qt::FindDirectChildrenOnly);
+  return stats ? stats : new SocketStats(socket);
+}
+
+qint64 SocketStats::now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+SocketStats::SocketStats(QObject *socket)
+  : QObject(socket) {
+  // Counters of web socket are taken from its signals, other sockets are
+  // counted by read and write functions of network module
+  if (qobject_cast<QWebSocket*>(socket)) {
+    connect(socket, SIGNAL(textMessageReceived(QString)), this, SLOT(onTextMessage(QString)));
+    connect(socket, SIGNAL(binaryMessageReceived(QByteArray)), this, SLOT(onBinaryMessage(QByteArray)));
+  } else if (qobject_cast<QIODevice*>(socket)) {
+    connect(socket, SIGNAL(readyRead()), this, SLOT(ready()));
+  }
+}
+
+void SocketStats::received(qint64 bytes, qint64 frames) {
+  bytes_in_ += bytes;
+  frames_in_ += frames;
+}
+
+void SocketStats::sent(qint64 bytes, qint64 frames) {
+  bytes_out_ += bytes;
+  frames_out_ += frames;
+}
+
+void SocketStats::ready() {
+  if (ready_since_us_ < 0) ready_since_us_ = now_us();
+}
+
+void SocketStats::dispatched(qint64 since_us) {
+  if (since_us < 0) since_us = ready_since_us_;
+  ready_since_us_ = -1;
+  if (since_us < 0) return;
+  const qint64 latency = now_us() - since_us;
+  ++latency_count_;
+  latency_total_us_ += latency;
+  if (latency > latency_max_us_) latency_max_us_ = latency;
+}
+
+void SocketStats::onTextMessage(const QString& text) {
+  // Size of UTF-8 form is counted without conversion
+  qint64 bytes = 0;
+  for (const QChar& c : text) {
+    const ushort u = c.unicode();
+    // Surrogate pair is 4 bytes, 2 for each half
+    bytes += u < 0x80 ? 1 : (u < 0x800 || c.isSurrogate() ? 2 : 3);
+  }
+  received(bytes, 1);
+}
+
+void SocketStats::onBinaryMessage(const QByteArray& data) {
+  received(data.size(), 1);
+}
+
+void SocketStats::push(lua_State *L, qint64 write_queue, qint64 pending_since_us) const {
+  if (pending_since_us < 0) pending_since_us = ready_since_us_;
+  lua_createtable(L, 0, 9);
+  lua_pushnumber(L, bytes_in_);
+  lua_setfield(L, -2, "bytes_in");
+  lua_pushnumber(L, bytes_out_);
+  lua_setfield(L, -2, "bytes_out");
+  lua_pushnumber(L, frames_in_);
+  lua_setfield(L, -2, "frames_in");
+  lua_pushnumber(L, frames_out_);
+  lua_setfield(L, -2, "frames_out");
+  if (write_queue >= 0) {
+    lua_pushnumber(L, write_queue);
+    lua_setfield(L, -2, "write_queue");
+  }
+  lua_pushnumber(L, latency_count_);
+  lua_setfield(L, -2, "latency_count");
+  lua_pushnumber(L, latency_total_us_ / 1000.0);
+  lua_setfield(L, -2, "latency_total_ms");
+  lua_pushnumber(L, latency_max_us_ / 1000.0);
+  lua_setfield(L, -2, "latency_max_ms");
+  lua_pushnumber(L, pending_since_us < 0 ? 0 : (now_us() - pending_since_us) / 1000.0);
+  lua_setfield(L, -2, "pending_ms");
+}
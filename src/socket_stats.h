@@ -0,0 +1,51 @@
+#pragma once
+
+extern "C" {
+#include <lua5.2/lua.h>
+#include <lua5.2/lualib.h>
+#include <lua5.2/lauxlib.h>
+}
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+
+// Traffic counters of one socket, available in Lua by socket:stats().
+// Object is a child of the socket, so it is deleted together with the socket.
+// Frames are messages for web socket, protocol frames for threaded TCP socket
+// and chunks returned by read() for plain TCP and local sockets.
+// Dispatch latency is time between data arrival and its read by Lua.
+class SocketStats : public QObject {
+  Q_OBJECT
+ public:
+  // Returns counters of socket, creates them on the first call
+  static SocketStats* of(QObject *socket);
+  // Monotonic time in microseconds
+  static qint64 now_us();
+
+  void received(qint64 bytes, qint64 frames);
+  void sent(qint64 bytes, qint64 frames);
+  // Lua has read data which waited since since_us, -1 means since ready()
+  void dispatched(qint64 since_us = -1);
+  // Pushes table of counters. Negative write_queue (bytes not written to
+  // socket yet) is unknown and not reported, pending_since_us is time of the
+  // oldest data not read by Lua, -1 means since ready()
+  void push(lua_State *L, qint64 write_queue, qint64 pending_since_us = -1) const;
+ public slots:
+  // Data became available, waiting time is measured from the first call
+  void ready();
+ private slots:
+  void onTextMessage(const QString& text);
+  void onBinaryMessage(const QByteArray& data);
+ private:
+  explicit SocketStats(QObject *socket);
+
+  qint64 bytes_in_ = 0;
+  qint64 bytes_out_ = 0;
+  qint64 frames_in_ = 0;
+  qint64 frames_out_ = 0;
+  qint64 ready_since_us_ = -1;
+  qint64 latency_count_ = 0;
+  qint64 latency_total_us_ = 0;
+  qint64 latency_max_us_ = 0;
+};
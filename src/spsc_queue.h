@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity is rounded up to power of two. Items are moved out by
+// consumer, so slots do not keep references to delivered data.
+template <typename T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacity)
+    : mask_(roundUp(capacity) - 1),
+      slots_(mask_ + 1),
+      head_(0),
+      tail_(0) {
+  }
+  // Called by producer only. Returns false if queue is full
+  bool push(const T& item) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_) return false;
+    slots_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+  // Called by consumer only. Returns false if queue is empty
+  bool pop(T *item) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+    *item = std::move(slots_[head & mask_]);
+    slots_[head & mask_] = T();
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+ private:
+  static size_t roundUp(size_t n) {
+    size_t res = 1;
+    while (res < n) res <<= 1;
+    return res;
+  }
+
+  const size_t mask_;
+  std::vector<T> slots_;
+  // Padding keeps producer and consumer positions on separate cache lines
+  char pad0_[64];
+  std::atomic<size_t> head_;
+  char pad1_[64];
+  std::atomic<size_t> tail_;
+};
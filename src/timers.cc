@@ -1,9 +1,11 @@
 #include "timers.h"
+#include "virtual_clock.h"
 #include <QTimer>
 
 int timer_create(lua_State *L) {
   QTimer **p = static_cast<QTimer**>(lua_newuserdata(L, sizeof(QTimer*)));
   *p = new QTimer();
+  VirtualClock::instance()->registerTimer(*p);
   luaL_getmetatable(L, "timers.Timer");
   lua_setmetatable(L, -2);
   return 1;
@@ -18,6 +20,7 @@ int timer_start(lua_State *L) {
   } else {
     timer->start();
   }
+  VirtualClock::instance()->timerStarted(timer);
   return 0;
 }
 
@@ -33,6 +36,7 @@ int timer_reset(lua_State *L) {
 	*static_cast<QTimer**>(luaL_checkudata(L, 1, "timers.Timer"));
   timer->stop();
   timer->start();
+  VirtualClock::instance()->timerStarted(timer);
   return 0;
 }
 
@@ -48,6 +52,8 @@ int timer_set_interval(lua_State *L) {
     *static_cast<QTimer**>(luaL_checkudata(L, 1, "timers.Timer"));
   int msec = luaL_checknumber(L, 2);
   timer->setInterval(msec);
+  // Active timer restarts with new interval
+  if (timer->isActive()) VirtualClock::instance()->timerStarted(timer);
   return 0;
 }
 
@@ -62,10 +68,26 @@ int timer_set_single_shot(lua_State *L) {
 int timer_delete(lua_State *L) {
   QTimer *timer =
     *static_cast<QTimer**>(luaL_checkudata(L, 1, "timers.Timer"));
+  VirtualClock::instance()->unregisterTimer(timer);
   delete timer;
   return 0;
 }
 
+// virtual_time(enable, [idle_ms])
+// Timers fire on virtual clock which jumps to the next deadline when event
+// loop is quiet during idle_ms (10 by default)
+int timers_virtual_time(lua_State *L) {
+  const int idle_ms = luaL_optinteger(L, 2, 10);
+  VirtualClock::instance()->setEnabled(lua_toboolean(L, 1), idle_ms);
+  return 0;
+}
+
+// Returns milliseconds virtual clock is ahead of real one
+int timers_virtual_offset(lua_State *L) {
+  lua_pushnumber(L, VirtualClock::offset());
+  return 1;
+}
+
 int luaopen_timers(lua_State *L) {
   lua_newtable(L);
 
@@ -88,6 +110,8 @@ int luaopen_timers(lua_State *L) {
 
   luaL_Reg timers_functions[] = {
     { "Timer", &timer_create },
+    { "virtual_time", &timers_virtual_time },
+    { "virtual_offset", &timers_virtual_offset },
     { NULL, NULL }
   };
   luaL_newlib(L, timers_functions);
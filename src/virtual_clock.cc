@@ -0,0 +1,131 @@
+#include "virtual_clock.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QTimerEvent>
+#include <QVector>
+#include <algorithm>
+#include <time.h>
+
+qint64 VirtualClock::offset_ = 0;
+
+VirtualClock *VirtualClock::instance() {
+  static VirtualClock *clock = new VirtualClock;
+  return clock;
+}
+
+qint64 VirtualClock::now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<qint64>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000 + offset_;
+}
+
+VirtualClock::VirtualClock() {
+  connect(&idle_timer_, SIGNAL(timeout()), this, SLOT(onIdleCheck()));
+}
+
+void VirtualClock::registerTimer(QTimer *timer) {
+  Entry entry = { timer, 0 };
+  timers_.append(entry);
+}
+
+void VirtualClock::unregisterTimer(QTimer *timer) {
+  for (int i = timers_.size() - 1; i >= 0; --i) {
+    if (timers_[i].timer == timer) timers_.removeAt(i);
+  }
+}
+
+VirtualClock::Entry *VirtualClock::find(QObject *timer) {
+  for (Entry& entry : timers_) {
+    if (entry.timer == timer) return &entry;
+  }
+  return NULL;
+}
+
+void VirtualClock::timerStarted(QTimer *timer) {
+  Entry *entry = find(timer);
+  if (entry) entry->deadline = now() + timer->interval();
+}
+
+void VirtualClock::setEnabled(bool enabled, int idle_ms) {
+  if (enabled == enabled_) return;
+  enabled_ = enabled;
+  if (enabled) {
+    // Repeating timers could restart unnoticed while clock was disabled
+    for (Entry& entry : timers_) {
+      if (entry.timer && entry.timer->isActive()) {
+        entry.deadline = now() + entry.timer->remainingTime();
+      }
+    }
+    // All events of main thread pass through filter of application
+    QCoreApplication::instance()->installEventFilter(this);
+    activity_ = true;
+    idle_timer_.start(idle_ms);
+  } else {
+    QCoreApplication::instance()->removeEventFilter(this);
+    idle_timer_.stop();
+  }
+}
+
+bool VirtualClock::eventFilter(QObject *obj, QEvent *event) {
+  if (obj == &idle_timer_) return false;
+  activity_ = true;
+  if (event->type() == QEvent::Timer) {
+    // Repeating timer fired by real clock starts new period
+    Entry *entry = find(obj);
+    if (entry && !entry->timer->isSingleShot()) {
+      entry->deadline = now() + entry->timer->interval();
+    }
+  }
+  return false;
+}
+
+void VirtualClock::onIdleCheck() {
+  advance(!activity_);
+  activity_ = false;
+}
+
+void VirtualClock::advance(bool idle) {
+  for (int i = timers_.size() - 1; i >= 0; --i) {
+    if (timers_[i].timer.isNull()) timers_.removeAt(i);
+  }
+  bool any = false;
+  qint64 earliest = 0;
+  for (const Entry& entry : timers_) {
+    if (!entry.timer->isActive()) continue;
+    if (!any || entry.deadline < earliest) earliest = entry.deadline;
+    any = true;
+  }
+  if (!any) return;
+  const qint64 current = now();
+  if (earliest > current) {
+    // Nothing is overdue, jump only if event loop is quiet
+    if (!idle) return;
+    offset_ += earliest - current;
+  }
+  const qint64 limit = qMax(current, earliest);
+
+  // Handlers may stop, restart or delete timers, so due list is taken first
+  QVector<QPair<qint64, QPointer<QTimer> > > due;
+  for (const Entry& entry : timers_) {
+    if (entry.timer->isActive() && entry.deadline <= limit) {
+      due.append(qMakePair(entry.deadline, entry.timer));
+    }
+  }
+  std::stable_sort(due.begin(), due.end(),
+                   [](const QPair<qint64, QPointer<QTimer> >& a,
+                      const QPair<qint64, QPointer<QTimer> >& b) { return a.first < b.first; });
+  for (const auto& item : due) {
+    QTimer *timer = item.second;
+    if (!timer || !timer->isActive()) continue;
+    Entry *entry = find(timer);
+    if (!entry || entry->deadline > limit) continue;
+    // Repeating timer starts new period from virtual now
+    if (!timer->isSingleShot()) {
+      timer->start();
+      entry->deadline = now() + timer->interval();
+    }
+    QTimerEvent event(timer->timerId());
+    QCoreApplication::sendEvent(timer, &event);
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+
+// Virtual clock of interpreter.
+// Clock is monotonic time shifted by offset. Each registered timer keeps its
+// deadline on this clock. When virtual time is enabled and event loop stays
+// quiet during idle interval (no socket, timer or queued event was handled),
+// offset jumps to the earliest deadline and the timer fires at once. Timers
+// whose virtual deadline has passed fire by virtual deadline order, even if
+// their real interval is not over yet. So waiting for timeouts takes no real time.
+class VirtualClock : public QObject {
+  Q_OBJECT
+ public:
+  static VirtualClock *instance();
+  // Milliseconds of monotonic clock including virtual offset
+  static qint64 now();
+  static qint64 offset() { return offset_; }
+  // Timers which fire on virtual clock
+  void registerTimer(QTimer *timer);
+  void unregisterTimer(QTimer *timer);
+  // Must be called after registered timer was (re)started
+  void timerStarted(QTimer *timer);
+  void setEnabled(bool enabled, int idle_ms);
+  bool isEnabled() const { return enabled_; }
+ protected:
+  bool eventFilter(QObject *obj, QEvent *event);
+ private slots:
+  void onIdleCheck();
+ private:
+  struct Entry {
+    QPointer<QTimer> timer;
+    qint64 deadline;  // virtual time of next timeout
+  };
+
+  VirtualClock();
+  Entry *find(QObject *timer);
+  // Fires timers due by virtual clock, jumps to the next deadline if idle
+  void advance(bool idle);
+
+  static qint64 offset_;
+  bool enabled_ = false;
+  bool activity_ = false;
+  QTimer idle_timer_;
+  QList<Entry> timers_;
+};
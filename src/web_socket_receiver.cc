@@ -0,0 +1,43 @@
+#include "web_socket_receiver.h"
+
+#include <QMetaObject>
+#include "socket_stats.h"
+
+WebSocketReceiver::WebSocketReceiver(QWebSocket *socket, QObject *parent)
+  : QObject(parent),
+    socket_(socket) {
+  connect(socket, SIGNAL(textMessageReceived(QString)), this, SLOT(onTextMessage(QString)));
+  connect(socket, SIGNAL(binaryMessageReceived(QByteArray)), this, SLOT(onBinaryMessage(QByteArray)));
+}
+
+QList<QByteArray> WebSocketReceiver::takeMessages() {
+  if (socket_ && !messages_.isEmpty()) SocketStats::of(socket_)->dispatched();
+  QList<QByteArray> res;
+  res.swap(messages_);
+  return res;
+}
+
+void WebSocketReceiver::onTextMessage(const QString& text) {
+  // QWebSocket decodes text frames itself, so this is the only conversion left
+  append(text.toUtf8());
+}
+
+void WebSocketReceiver::onBinaryMessage(const QByteArray& data) {
+  append(data);
+}
+
+void WebSocketReceiver::append(const QByteArray& data) {
+  // Dispatch latency of the socket is measured from the oldest collected frame
+  if (socket_ && messages_.isEmpty()) SocketStats::of(socket_)->ready();
+  messages_.append(data);
+  if (!notified_) {
+    // All frames parsed from the same socket read are collected before Lua is called
+    notified_ = true;
+    QMetaObject::invokeMethod(this, "notify", Qt::QueuedConnection);
+  }
+}
+
+void WebSocketReceiver::notify() {
+  notified_ = false;
+  if (!messages_.isEmpty()) emit readyRead();
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QPointer>
+#include <QWebSocket>
+
+// Web socket receiver collects frames of web socket as UTF-8 bytes.
+// Lua is notified once per event loop iteration by readyRead() and takes all
+// collected frames at once, so frames read from one TCP segment are
+// delivered by a single slot call instead of a QString signal per frame.
+class WebSocketReceiver : public QObject {
+  Q_OBJECT
+ public:
+  explicit WebSocketReceiver(QWebSocket *socket, QObject *parent = 0);
+  // Returns collected frames and clears the queue
+  QList<QByteArray> takeMessages();
+  int pending() const { return messages_.size(); }
+ signals:
+  void readyRead();
+ private slots:
+  void onTextMessage(const QString& text);
+  void onBinaryMessage(const QByteArray& data);
+  void notify();
+ private:
+  void append(const QByteArray& data);
+
+  QPointer<QWebSocket> socket_;
+  QList<QByteArray> messages_;
+  bool notified_ = false;
+};
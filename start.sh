@@ -1,2 +1,6 @@
 #!/bin/sh
-./bin/interp modules/launch.lua $@ 2> ErrorLog.txt
\ No newline at end of file
+# Scripts are run by interpreter server if ATF_SERVE_SOCKET is socket of `interp --serve`
+if [ -n "$ATF_SERVE_SOCKET" ] && [ -S "$ATF_SERVE_SOCKET" ]; then
+  exec ./bin/interp --connect=$ATF_SERVE_SOCKET modules/launch.lua $@ 2> ErrorLog.txt
+fi
+./bin/interp ${ATF_BYTECODE_CACHE:+--bytecode-cache=$ATF_BYTECODE_CACHE} modules/launch.lua $@ 2> ErrorLog.txt
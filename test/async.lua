@@ -0,0 +1,97 @@
+local async = require('async')
+local expectations = require('expectations')
+
+--- Minimal test table of testbase: expectations of step and status check
+local test = { list = {} }
+function test:AddExpectation(e) table.insert(self.list, e) end
+
+--- Emulate occurence of expectation after delay
+local function occur(exp, ms, data)
+  local d = qt.dynamic()
+  local timer = timers.Timer()
+  function d.timeout()
+    exp.occurences = exp.occurences + 1
+    exp:Action(data)
+    exp:validate()
+    d.timer = nil
+  end
+  d.timer = timer
+  qt.connect(timer, "timeout()", d, "timeout()")
+  timer:setSingleShot(true)
+  timer:start(ms)
+end
+
+local function check(name, res, err)
+  if res then print("PASSED", name)
+  else print("FAILED", name, err) end
+end
+
+local steps = {}
+local results = {}
+
+function steps.Overlap()
+  return async.step(test, function()
+      local start = timestamp()
+      async.await(async.all(async.sleep(200), async.sleep(200)))
+      local elapsed = timestamp() - start
+      results.Overlap = { elapsed >= 200 and elapsed < 400, "independent waits should overlap, took " .. elapsed }
+
+      local log = {}
+      local response = expectations.Expectation("Response")
+      occur(response, 50, { result = "SUCCESS" })
+      local values = async.await(async.all(response, async.spawn(function()
+            async.await(async.sleep(10))
+            table.insert(log, "spawned")
+            return 5
+          end)))
+      table.insert(log, "main")
+      results.All = { values[1].result == "SUCCESS" and values[2] == 5 and table.concat(log, ",") == "spawned,main",
+        "all should collect values of expectation and task in order" }
+
+      local notification = expectations.Expectation("Notification")
+      occur(notification, 10, "data")
+      local value, index = async.await(async.race(async.sleep(100), notification))
+      results.Race = { value == "data" and index == 2, "race should return the first settled future" }
+
+      local failed = expectations.Expectation("Failed")
+      failed.ts = timestamp() - failed.timeout - 1
+      failed:validate()
+      local ok, err = pcall(async.await, failed)
+      results.Reject = { not ok and tostring(err):match("Timeout") ~= nil, "failed expectation should raise error" }
+    end)
+end
+
+function steps.Timeout()
+  return async.step(test, function()
+      async.await(async.Future())
+    end, 50)
+end
+
+local order = { "Overlap", "Timeout" }
+local current = 0
+local guard = nil
+
+local function nextStep()
+  current = current + 1
+  if not order[current] then
+    quit()
+    return
+  end
+  guard = steps[order[current]]()
+end
+
+function test.CheckStatus()
+  local name = order[current]
+  if name == "Overlap" then
+    check("Step", guard.status == expectations.SUCCESS, guard.errorMessage.Error)
+    for _, k in ipairs({ "Overlap", "All", "Race", "Reject" }) do
+      check(k, results[k] and results[k][1], results[k] and results[k][2])
+    end
+  elseif name == "Timeout" then
+    check("Timeout", guard.status == expectations.FAILED and guard.errorMessage.Error == "Timeout expired",
+      "step should fail by timeout")
+  end
+  nextStep()
+end
+
+nextStep()
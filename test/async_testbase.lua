@@ -0,0 +1,72 @@
+-- Async steps run by testbase: expectation which lost a race or whose error was caught by a task
+-- is removed from the step and from event dispatcher, uncaught error still fails the step
+local Test = require('testbase')
+local async = require('async')
+local events = require('events')
+local expectations = require('expectations')
+local fmt = require('format')
+
+--- Results are printed without duration, so output is stable
+function fmt.PrintCaseResult(_, name, success)
+  print(success and "PASSED" or "FAILED", name)
+end
+function print_stopscript() end
+
+--- Connection which delivers messages sent by test
+local connection = {}
+function connection:OnInputData(func) self.input = func end
+function connection:OnConnected() end
+function connection:OnDisconnected() end
+event_dispatcher:AddConnection(connection)
+
+local function expect(name, timeout)
+  local event = events.Event()
+  event.matches = function(_, data) return data.name == name end
+  local exp = expectations.Expectation(name, connection)
+  exp.event = event
+  exp:Timeout(timeout)
+  event_dispatcher:AddEvent(connection, event, exp)
+  Test:AddExpectation(exp)
+  return exp
+end
+
+local function send(name, ms)
+  async.spawn(function()
+      async.await(async.sleep(ms))
+      connection:input({ name = name })
+    end)
+end
+
+local function inStep(exp)
+  return Test.expectations_list:Any(function(e) return e == exp end)
+end
+
+function Test:RaceLoser()
+  async.step(self, function()
+      local winner = expect("Winner", 1000)
+      local loser = expect("Loser", 200)
+      send("Winner", 10)
+      local _, index = async.await(async.race(winner, loser))
+      -- loser would fail the step by timeout if it stayed in it
+      async.await(async.sleep(300))
+      if index ~= 1 or not inStep(winner) or inStep(loser) or loser.dispatcher then
+        error("loser of race should be removed from step and dispatcher")
+      end
+    end)
+end
+
+function Test:CaughtFailure()
+  async.step(self, function()
+      local missing = expect("Missing", 100)
+      local ok = pcall(async.await, missing)
+      if ok or inStep(missing) or missing.dispatcher then
+        error("caught expectation should be removed from step and dispatcher")
+      end
+    end)
+end
+
+function Test:UncaughtFailure()
+  async.step(self, function()
+      async.await(expect("Absent", 100))
+    end)
+end
@@ -0,0 +1,33 @@
+local filename = "test/out/atf_log.atflog"
+
+local w = assert(atf_log.open(filename, "test/atf_log.lua"))
+w:test_case("Step")
+w:mobile(atf_log.MOB_TO_SDL, { sessionId = 1, version = 3, frameType = 1, serviceType = 7, frameInfo = 0,
+    messageId = 5, rpcFunctionId = 99999, rpcCorrelationId = 1, encryption = false }, '{"appName":"Test"}')
+w:mobile(atf_log.SDL_TO_MOB, { sessionId = 2, version = 3, frameType = 0, serviceType = 7, frameInfo = 255,
+    messageId = 6 })
+w:hmi(atf_log.SDL_TO_HMI, '{"method":"BasicCommunication.OnAppRegistered"}')
+w:finish("00:01")
+w:close()
+
+-- Render log with atf_logcat, times differ from run to run
+local function logcat(...)
+  local out = "test/out/atf_log.txt"
+  argv = { "tools/atf_logcat.lua", filename, ... }
+  io.output(out)
+  dofile("tools/atf_logcat.lua")
+  io.close()
+  io.output(io.stdout)
+  for line in io.lines(out) do
+    line = line:gsub("%d%d %d%d %d%d%d%d %d%d:%d%d:%d%d, %d%d%d", "<time>"):gsub('"elapsed_ms":[%d%.]+', '"elapsed_ms":0')
+    if line ~= "" then print(line) end
+  end
+  os.remove(out)
+end
+
+logcat()
+logcat("--brief", "--session=2")
+logcat("--json", "--function=99999")
+os.remove(filename)
+
+quit()
@@ -0,0 +1,229 @@
+local expectations = require('expectations')
+local ed = require("event_dispatcher")
+local events = require("events")
+
+local SUCCESS = expectations.SUCCESS
+local FAILED = expectations.FAILED
+
+local now = 1000
+timestamp = function() return now end
+
+-- Connection which delivers messages in batches
+local function BatchConnection()
+  local conn = { }
+  function conn:OnInputData(func) self.on_input_data = func end
+  function conn:OnInputBatch(func) self.on_input_batch = func end
+  function conn:OnConnected(func) end
+  function conn:OnDisconnected(func) end
+  function conn:InputBatch(list) self.on_input_batch(self, list) end
+  return conn
+end
+
+local function Event(id)
+  local event = events.Event()
+  event.matches = function(_, data) return data.id == id end
+  return event
+end
+
+local function Dispatcher()
+  local dispatcher = ed.EventDispatcher()
+  dispatcher:EnableBatches(true)
+  return dispatcher
+end
+
+-- Dispatcher with pending check over expectations list as in testbase, counts validations
+local function StepDispatcher(list)
+  local dispatcher = Dispatcher()
+  dispatcher:SetPendingCheck(function() return list:HasPending() end)
+  dispatcher.validations = 0
+  local validateAll = dispatcher.validateAll
+  dispatcher.validateAll = function(self)
+    self.validations = self.validations + 1
+    return validateAll(self)
+  end
+  return dispatcher
+end
+
+local tests = {}
+
+function tests:BatchSubscription()
+  local conn = BatchConnection()
+  Dispatcher():AddConnection(conn)
+  if not conn.on_input_batch or conn.on_input_data then
+    return false, "dispatcher should subscribe on batches"
+  end
+  conn = BatchConnection()
+  ed.EventDispatcher():AddConnection(conn)
+  if conn.on_input_batch or not conn.on_input_data then
+    return false, "dispatcher should subscribe on single messages by default"
+  end
+  return true
+end
+
+function tests:StepBoundary()
+  -- The first message finishes step, the second one belongs to the next step
+  local conn = BatchConnection()
+  local dispatcher = Dispatcher()
+  dispatcher:AddConnection(conn)
+  local first = expectations.Expectation("first", conn):Times(1)
+  local second = expectations.Expectation("second", conn):Times(1)
+  local event = Event(1)
+  dispatcher:AddEvent(conn, event, first)
+  dispatcher:OnPostEvent(function()
+      if first.status and not second.dispatcher then
+        dispatcher:RemoveEvent(conn, event)
+        dispatcher:AddEvent(conn, event, second)
+      end
+    end)
+  conn:InputBatch({ { id = 1 }, { id = 1 } })
+  if first.status ~= SUCCESS or first.occurences ~= 1 then return false, "first step should get one message" end
+  if second.status ~= SUCCESS or second.occurences ~= 1 then return false, "second step should get one message" end
+  return true
+end
+
+function tests:UnmatchedPostEach()
+  -- Step without pending expectations is finished by status check after any message,
+  -- so the rest of batch goes to expectations of the next step
+  local conn = BatchConnection()
+  local dispatcher = Dispatcher()
+  dispatcher:AddConnection(conn)
+  local pre, post = 0, 0
+  local next_step = expectations.Expectation("next", conn):Times(1)
+  dispatcher:OnPreEvent(function() pre = pre + 1 end)
+  dispatcher:OnPostEvent(function()
+      post = post + 1
+      if post == 1 then dispatcher:AddEvent(conn, Event(3), next_step) end
+    end)
+  conn:InputBatch({ { id = 1 }, { id = 2 }, { id = 3 }, { id = 4 } })
+  if pre ~= 4 then return false, "pre event handler should be called for every message" end
+  if post ~= 4 then return false, "post event handler should be called for every message, got " .. post end
+  if next_step.occurences ~= 1 or next_step.status ~= SUCCESS then
+    return false, "next step should get message of the same batch"
+  end
+  return true
+end
+
+function tests:DeadlinePassed()
+  -- Passed deadline is applied before status check of matched message
+  local conn = BatchConnection()
+  local dispatcher = Dispatcher()
+  dispatcher:AddConnection(conn)
+  local timed = expectations.Expectation("timed", conn):Times(1):Timeout(100)
+  local other = expectations.Expectation("other", conn):Times(1)
+  dispatcher:AddEvent(conn, Event(1), timed)
+  dispatcher:AddEvent(conn, Event(2), other)
+  dispatcher:validateAll()
+  local statuses = { }
+  dispatcher:OnPostEvent(function()
+      table.insert(statuses, timed.status or "pending")
+    end)
+  now = now + 200
+  conn:InputBatch({ { id = 2 }, { id = 3 } })
+  now = now - 200
+  if statuses[1] ~= FAILED then return false, "timed out expectation should fail before the first status check" end
+  return true
+end
+
+function tests:ValidateOncePerBatch()
+  -- Batch which can't finish the step is validated once and checked by post handler once
+  local conn = BatchConnection()
+  local list = expectations.ExpectationsList()
+  local dispatcher = StepDispatcher(list)
+  dispatcher:AddConnection(conn)
+  local exp = expectations.Expectation("many", conn):Times(20)
+  list:Add(exp)
+  dispatcher:AddEvent(conn, Event(1), exp)
+  local post = 0
+  dispatcher:OnPostEvent(function() post = post + 1 end)
+  local batch = { }
+  for i = 1, 10 do batch[i] = { id = 1 } end
+  dispatcher.validations = 0
+  conn:InputBatch(batch)
+  if exp.occurences ~= 10 then return false, "all messages should be matched" end
+  if dispatcher.validations ~= 1 then
+    return false, "batch should be validated once, got " .. dispatcher.validations
+  end
+  if post ~= 1 then return false, "post event handler should be called once, got " .. post end
+  return true
+end
+
+function tests:PendingStepBoundary()
+  -- Message which completes the step is followed by post handler, the rest goes to the next step
+  local conn = BatchConnection()
+  local list = expectations.ExpectationsList()
+  local dispatcher = StepDispatcher(list)
+  dispatcher:AddConnection(conn)
+  local first = expectations.Expectation("first", conn):Times(2)
+  local second = expectations.Expectation("second", conn):Times(2)
+  local event = Event(1)
+  list:Add(first)
+  dispatcher:AddEvent(conn, event, first)
+  local post = 0
+  dispatcher:OnPostEvent(function()
+      post = post + 1
+      if not list:HasPending() and not second.dispatcher then
+        list:Clear()
+        dispatcher:RemoveEvent(conn, event)
+        list:Add(second)
+        dispatcher:AddEvent(conn, event, second)
+      end
+    end)
+  dispatcher.validations = 0
+  conn:InputBatch({ { id = 1 }, { id = 1 }, { id = 1 }, { id = 1 } })
+  if first.status ~= SUCCESS or first.occurences ~= 2 then return false, "first step should get two messages" end
+  if second.status ~= SUCCESS or second.occurences ~= 2 then return false, "second step should get two messages" end
+  if post ~= 2 or dispatcher.validations ~= 2 then
+    return false, "post handler and validation should follow each finished step, got " .. post .. " and "
+      .. dispatcher.validations
+  end
+  return true
+end
+
+function tests:PendingDeadlinePassed()
+  -- Passed deadline may finish the step, so it is applied before the first message is checked
+  local conn = BatchConnection()
+  local list = expectations.ExpectationsList()
+  local dispatcher = StepDispatcher(list)
+  dispatcher:AddConnection(conn)
+  local timed = expectations.Expectation("timed", conn):Times(1):Timeout(100)
+  list:Add(timed)
+  dispatcher:AddEvent(conn, Event(1), timed)
+  dispatcher:validateAll()
+  local statuses = { }
+  dispatcher:OnPostEvent(function()
+      table.insert(statuses, timed.status or "pending")
+    end)
+  now = now + 200
+  conn:InputBatch({ { id = 2 }, { id = 3 } })
+  now = now - 200
+  if statuses[1] ~= FAILED then return false, "timed out expectation should fail before the first status check" end
+  return true
+end
+
+function tests:OrderKept()
+  local conn = BatchConnection()
+  local dispatcher = Dispatcher()
+  dispatcher:AddConnection(conn)
+  local got = { }
+  local exp = expectations.Expectation("all", conn):Times(3)
+  exp:Do(function(_, data) table.insert(got, data.n) end)
+  local event = events.Event()
+  event.matches = function() return true end
+  dispatcher:AddEvent(conn, event, exp)
+  conn:InputBatch({ { n = 1 }, { n = 2 }, { n = 3 } })
+  if table.concat(got, ",") ~= "1,2,3" then return false, "messages should be handled in order" end
+  if exp.status ~= SUCCESS then return false, "expectation should succeed" end
+  conn:InputBatch({ { n = 4 } })
+  if exp.status ~= FAILED then return false, "extra occurence should fail expectation" end
+  return true
+end
+
+local names = { "BatchSubscription", "StepBoundary", "UnmatchedPostEach", "DeadlinePassed", "ValidateOncePerBatch",
+  "PendingStepBoundary", "PendingDeadlinePassed", "OrderKept" }
+for _, k in ipairs(names) do
+  local res, err = tests[k]()
+  if res then print("PASSED", k)
+  else print("FAILED", k, err) end
+end
+
+quit()
@@ -0,0 +1,68 @@
+config = { caseResources = true, excludeReport = true, caseResourcesFile = "test/out/case_resources.jsonl" }
+xmlReporter = { script_file_name = "test/case_resources.lua" }
+os.remove(config.caseResourcesFile)
+
+local case_resources = require('case_resources')
+local json = require('json')
+
+local tests = {}
+
+function tests:ConnectionCounters()
+  local name = case_resources.unique_name("mobile")
+  local counters = case_resources.connection(name)
+  if case_resources.connection(name) ~= counters then return false, "counters should be shared by name" end
+  if case_resources.unique_name("mobile") == name then return false, "name should be unique" end
+  case_resources.start()
+  counters.messages_sent = counters.messages_sent + 2
+  counters.bytes_sent = counters.bytes_sent + 100
+  counters.messages_received = counters.messages_received + 1
+  local res = case_resources.finish()
+  local c = res.connections[name]
+  if c.messages_sent ~= 2 or c.bytes_sent ~= 100 or c.messages_received ~= 1 or c.bytes_received ~= 0 then
+    return false, "counters should be reported as difference"
+  end
+  case_resources.start()
+  res = case_resources.finish()
+  if res.connections[name].messages_sent ~= 0 then return false, "idle step should have zero counters" end
+  return true
+end
+
+function tests:HeapAndGc()
+  case_resources.start()
+  local t = {}
+  for i = 1, 10000 do t[i] = { i } end
+  collectgarbage()
+  local res = case_resources.finish()
+  if res.heap_delta <= 0 then return false, "heap delta should be positive" end
+  if res.gc_cycles < 1 then return false, "gc cycle should be counted" end
+  if type(res.cpu_ms) ~= "number" then return false, "cpu time should be reported" end
+  if res.sdl_cpu_ms ~= nil then return false, "sdl usage should be absent without sdl.pid" end
+  return true
+end
+
+function tests:Summary()
+  case_resources.start()
+  local res = case_resources.finish()
+  local attributes = case_resources.attributes(res, { result = true })
+  if attributes.mobile1_messages_sent ~= 0 or attributes.connections ~= nil then
+    return false, "connections should be flattened into attributes"
+  end
+  case_resources.write_summary("Step", true, 5, res)
+  local f = io.open(config.caseResourcesFile)
+  local line = json.decode(f:read("*l"))
+  f:close()
+  if line.case ~= "Step" or line.duration_ms ~= 5 or line.script ~= "test/case_resources.lua" then
+    return false, "summary line should describe test step"
+  end
+  return true
+end
+
+local names = { "ConnectionCounters", "HeapAndGc", "Summary" }
+for _, k in ipairs(names) do
+  local res, err = tests[k]()
+  if res then print("PASSED", k)
+  else print("FAILED", k, err) end
+end
+
+os.remove(config.caseResourcesFile)
+quit()
@@ -0,0 +1,70 @@
+config = { connectionMetrics = true }
+local metrics_file = "test/out/connection_metrics.jsonl"
+
+local connection_metrics = require('connection_metrics')
+local json = require('json')
+
+local pair = qt.dynamic()
+pair.a, pair.b = network.socketpair()
+qt.connect(pair.b, "readyRead()", pair, "dataReady()")
+
+local tests = {}
+
+function tests:SocketStats()
+  local a, b = pair.a:stats(), pair.b:stats()
+  if a.bytes_out ~= 4 or a.frames_out ~= 1 then return false, "written data should be counted" end
+  if b.bytes_in ~= 4 or b.frames_in ~= 1 then return false, "read data should be counted" end
+  if b.latency_count ~= 1 or b.latency_max_ms < 0 then return false, "dispatch latency should be measured" end
+  if b.pending_ms ~= 0 then return false, "nothing should be pending after read" end
+  if type(a.write_queue) ~= "number" then return false, "write queue should be reported" end
+  return true
+end
+
+function tests:StepDifference()
+  -- Function of extra counters is referenced only by connection_metrics
+  collectgarbage()
+  local res = connection_metrics.finish()
+  if res.a.bytes_out ~= 4 or res.b.bytes_in ~= 4 then return false, "step counters should include traffic" end
+  if res.a.credit_blocked ~= 0 or res.a.credit_blocked_ms ~= 0 then
+    return false, "extra counters should be reported as difference"
+  end
+  if not res.b.latency_avg_ms then return false, "average latency of step should be reported" end
+  connection_metrics.start()
+  res = connection_metrics.finish()
+  if res.a.bytes_out ~= 0 or res.b.latency_avg_ms ~= nil then return false, "idle step should have zero counters" end
+  local attributes = connection_metrics.attributes(res, { result = true })
+  if attributes.a_bytes_out ~= 0 or attributes.b_frames_in ~= 0 then
+    return false, "counters should be flattened into attributes"
+  end
+  return true
+end
+
+function tests:Export()
+  connection_metrics.start_export(metrics_file, 1000)
+  connection_metrics.write("Step")
+  connection_metrics.stop_export()
+  local f = io.open(metrics_file)
+  local line = json.decode(f:read("*l"))
+  f:close()
+  if line.case ~= "Step" or line.connections.b.bytes_in ~= 4 or not line.time then
+    return false, "snapshot line should contain counters of connections"
+  end
+  return true
+end
+
+function pair.dataReady()
+  pair.b:read_all()
+  local names = { "SocketStats", "StepDifference", "Export" }
+  for _, k in ipairs(names) do
+    local res, err = tests[k]()
+    if res then print("PASSED", k)
+    else print("FAILED", k, err) end
+  end
+  os.remove(metrics_file)
+  quit()
+end
+
+connection_metrics.register("a", pair.a, function() return { credit_blocked = 1, credit_blocked_ms = 5 } end)
+connection_metrics.register("b", pair.b)
+connection_metrics.start()
+pair.a:write("Ping")
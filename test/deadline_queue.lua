@@ -0,0 +1,99 @@
+local dq = require('deadline_queue')
+local expectations = require('expectations')
+local ed = require("event_dispatcher")
+local events = require("events")
+local connection = require("test/dummy_connection")
+
+local SUCCESS = expectations.SUCCESS
+local FAILED = expectations.FAILED
+
+-- Controllable clock for expectations and event dispatcher
+local now = 1000
+timestamp = function() return now end
+
+local tests = {}
+
+function tests:QueueOrder()
+  local q = dq.DeadlineQueue()
+  local values = { 5, 3, 8, 1, 9, 2, 7, 3, 6, 4 }
+  for i, v in ipairs(values) do q:push(v, "item" .. i) end
+  local prev = 0
+  for _ = 1, #values do
+    local deadline = q:pop()
+    if deadline < prev then return false, "deadlines are popped out of order" end
+    prev = deadline
+  end
+  if not q:empty() or q:pop() ~= nil then return false, "queue should be empty" end
+  return true
+end
+
+function tests:QueueEarliest()
+  local q = dq.DeadlineQueue()
+  if not q:push(10, "a") then return false, "first item should be the earliest" end
+  if q:push(20, "b") then return false, "later item should not be the earliest" end
+  if not q:push(5, "c") then return false, "earlier item should be the earliest" end
+  local deadline, item = q:peek()
+  if deadline ~= 5 or item ~= "c" then return false, "peek should return the earliest item" end
+  return true
+end
+
+function tests:TimeoutExpired()
+  local dispatcher = ed.EventDispatcher()
+  dispatcher:AddConnection(connection)
+  local armed
+  dispatcher:OnDeadline(function(deadline) armed = deadline end)
+  local event = events.Event()
+  event.matches = function() return false end
+  local exp = expectations.Expectation("Timeout expectation", connection)
+  dispatcher:AddEvent(connection, event, exp)
+  exp:Timeout(100)
+  if armed ~= now + 100 then return false, "deadline handler should get the earliest deadline" end
+  now = now + 50
+  dispatcher:validateAll()
+  if exp.status then return false, "expectation should be pending before deadline" end
+  now = now + 51
+  dispatcher:validateAll()
+  if exp.status ~= FAILED then return false, "expectation should fail after deadline" end
+  return true
+end
+
+function tests:RemovedNotValidated()
+  local dispatcher = ed.EventDispatcher()
+  dispatcher:AddConnection(connection)
+  local event = events.Event()
+  event.matches = function() return false end
+  local exp = expectations.Expectation("Removed expectation", connection):Timeout(10)
+  dispatcher:AddEvent(connection, event, exp)
+  dispatcher:RemoveEvent(connection, event)
+  now = now + 20
+  dispatcher:validateAll()
+  if exp.status then return false, "removed expectation should not be validated" end
+  return true
+end
+
+function tests:PendingCursor()
+  local list = expectations.ExpectationsList()
+  local a = expectations.Expectation("a", connection)
+  local b = expectations.Expectation("b", connection)
+  list:Add(a)
+  list:Add(b)
+  if not list:HasPending() then return false, "list should have pending expectations" end
+  a.status = SUCCESS
+  b.status = FAILED
+  if list:HasPending() then return false, "list should not have pending expectations" end
+  local c = expectations.Expectation("c", connection)
+  list:Add(c)
+  if not list:HasPending() then return false, "added expectation should be pending" end
+  list:Clear()
+  if list:HasPending() then return false, "cleared list should not have pending expectations" end
+  return true
+end
+
+local names = { "QueueOrder", "QueueEarliest", "TimeoutExpired", "RemovedNotValidated", "PendingCursor" }
+for _, k in ipairs(names) do
+  local res, err = tests[k]()
+  if res then print("PASSED", k)
+  else print("FAILED", k, err) end
+end
+
+quit()
@@ -0,0 +1,108 @@
+-- Native heartbeat service answers heartbeat of SDL, sends its own heartbeat,
+-- applies flags changed by setFlags() and reports silence of SDL by heartbeatTimeout().
+-- Client socket is served by I/O thread if `heartbeat_threaded` is set (heartbeat_service_threaded.lua)
+local interval = 100
+local timeout = 400
+local server = network.TcpServer()
+local client = heartbeat_threaded and network.ThreadedTcpClient() or network.TcpClient()
+local hb = network.HeartbeatService(client)
+local proxy = qt.dynamic()
+local d = qt.dynamic()
+local received = { acks = 0, heartbeats = 0, last_heartbeat = 0 }
+local flags_changed, last_sdl_frame, timed_out
+local buffer = ""
+
+function proxy:inputData() end
+
+local function heartbeat()
+  -- Protocol version 3 control frame of session 1 with empty payload
+  return string.char(0x30, 0, 0x00, 1, 0, 0, 0, 0, 0, 0, 0, 1)
+end
+
+local function check(name, res)
+  if res then print("PASSED", name)
+  else print("FAILED", name) end
+end
+
+function d.report()
+  check("Timeout", timed_out ~= nil and timed_out - last_sdl_frame >= timeout - 10)
+  hb:stop(1)
+  check("Stopped", hb:sessions() == 0)
+  quit()
+end
+
+function d.heartbeatTimeout(sessionId)
+  if sessionId == 1 then timed_out = timestamp() end
+  d.report()
+end
+
+function d.checkFlags()
+  check("FlagsApplied", received.acks == 0 and received.last_heartbeat < flags_changed + interval / 2)
+end
+
+local function sendHeartbeat()
+  last_sdl_frame = timestamp()
+  d.socket:write(heartbeat())
+end
+
+function d.newConnection()
+  d.socket = server:get_connection()
+  qt.connect(d.socket, "readyRead()", d, "serverReadyRead()")
+end
+
+function d.serverReadyRead()
+  buffer = buffer .. d.socket:read(100000)
+  while #buffer >= 12 do
+    local frame_info = buffer:byte(3)
+    if frame_info == 0xFF then received.acks = received.acks + 1
+    elseif frame_info == 0x00 then
+      received.heartbeats = received.heartbeats + 1
+      received.last_heartbeat = timestamp()
+    end
+    buffer = buffer:sub(13)
+  end
+  if received.heartbeats > 0 and not received.answered and received.acks == 0 then
+    -- Session is surely started when its first heartbeat is received
+    if not received.sent then
+      received.sent = true
+      check("Send", true)
+      sendHeartbeat()
+    end
+  elseif received.acks == 1 and not flags_changed then
+    check("Answer", true)
+    received.answered = true
+    -- Neither heartbeat nor ACK are sent after flags are reset
+    hb:setFlags(1, false, false, false)
+    flags_changed = timestamp()
+    received.acks = 0
+    sendHeartbeat()
+    local timer = timers.Timer()
+    d.timer = timer
+    timer:setSingleShot(true)
+    qt.connect(timer, "timeout()", d, "checkFlags()")
+    timer:start(interval * 3)
+  end
+end
+
+function d.connected()
+  hb:start(1, 3, interval, timeout)
+end
+
+function proxy.readyRead()
+  if heartbeat_threaded then
+    proxy:inputData(table.concat(client:read_all()))
+  else
+    proxy:inputData(client:read(100000))
+  end
+end
+
+if not server:listen("127.0.0.1", 5206) then
+  print("Listen failed")
+  quit(1)
+end
+qt.connect(server, "newConnection()", d, "newConnection()")
+qt.connect(client, "connected()", d, "connected()")
+qt.connect(client, "readyRead()", proxy, "readyRead()")
+qt.connect(proxy, "inputData(QByteArray)", hb, "input(QByteArray)")
+qt.connect(hb, "heartbeatTimeout(int)", d, "heartbeatTimeout(int)")
+client:connect("127.0.0.1", 5206)
@@ -0,0 +1,3 @@
+-- Native heartbeat service test for connection served by I/O thread
+heartbeat_threaded = true
+dofile("test/heartbeat_service.lua")
@@ -0,0 +1,60 @@
+-- Script run by interpreter server sees warm state, which is rebuilt when a module loaded by warm-up changes
+local dir = os.tmpname()
+os.remove(dir)
+os.execute("mkdir -p " .. dir)
+local socket = dir .. "/serve.sock"
+local warmup = dir .. "/warmup.lua"
+local probe = dir .. "/serve_probe.lua"
+local script = dir .. "/script.lua"
+
+local function write(path, text)
+  local f = io.open(path, "w")
+  f:write(text)
+  f:close()
+end
+
+local function check(name, res)
+  if res then print("PASSED", name)
+  else print("FAILED", name) end
+end
+
+local function run()
+  local p = io.popen("./interp --connect=" .. socket .. " " .. script .. " 2>&1")
+  local output = p:read("*a")
+  local ok = p:close()
+  return ok, output
+end
+
+write(probe, "return { value = 1 }\n")
+write(warmup, "package.path = '" .. dir .. "/?.lua;' .. package.path\n" ..
+  "probe = require('serve_probe')\n" ..
+  "return dofile('modules/atf/serve.lua')\n")
+write(script, "print('probe', probe.value, package.loaded['atf.util'] ~= nil)\nquit()\n")
+
+os.execute("./interp --serve=" .. socket .. " " .. warmup .. " > " .. dir .. "/serve.log 2>&1 & echo $! > "
+  .. dir .. "/serve.pid")
+local started = false
+for _ = 1, 100 do
+  if os.execute("test -S " .. socket) then
+    started = true
+    break
+  end
+  os.execute("sleep 0.1")
+end
+check("Serving", started)
+
+local ok, output = run()
+check("WarmState", ok and output == "probe\t1\ttrue\n")
+
+-- Size differs as well, so change is seen within mtime resolution
+write(probe, "return { value = 22 }\n")
+ok, output = run()
+check("ReloadedModule", ok and output == "probe\t22\ttrue\n")
+
+local f = io.open(dir .. "/serve.pid")
+local pid = f and f:read("*l")
+if f then f:close() end
+if pid then os.execute("kill " .. pid .. " 2> /dev/null") end
+os.execute("sleep 0.1")
+os.execute("rm -rf " .. dir)
+quit()
@@ -0,0 +1,74 @@
+config = { latencyStats = true, latencyStatsFile = "test/out/latency_stats.json" }
+local messages = {}
+xmlReporter = {
+  script_file_name = "test/latency_stats.lua",
+  AddCase = function(name) table.insert(messages, name) end,
+  AddMessage = function(name, attributes) table.insert(messages, attributes) end
+}
+-- Clock of test controls measured latencies
+local now = 0
+function timestamp() return now end
+
+local latency_stats = require('latency_stats')
+local json = require('json')
+
+local tests = {}
+
+function tests:Histogram()
+  local h = latency_stats.Histogram()
+  for i = 1, 100 do latency_stats.record(h, i) end
+  local s = latency_stats.summary(h)
+  if s.count ~= 100 or s.max ~= 100 or s.mean ~= 50.5 then return false, "count, max and mean should be exact" end
+  if s.p50 ~= 50 then return false, "values below 64 should be exact, p50 is " .. tostring(s.p50) end
+  if s.p90 < 90 or s.p90 > 90 * 33 / 32 then return false, "p90 should be within bucket precision" end
+  if s.p99 < 99 or s.p99 > 100 then return false, "p99 should not exceed max" end
+  latency_stats.record(h, 1000000)
+  if latency_stats.percentile(h, 100) ~= 1000000 then return false, "the highest percentile should be max" end
+  if latency_stats.summary(latency_stats.Histogram()).p50 ~= nil then return false, "empty histogram has no percentiles" end
+  return true
+end
+
+function tests:Matching()
+  latency_stats.start()
+  latency_stats.request("mobile1", "1:1", "RegisterAppInterface")
+  latency_stats.request("hmi1", 1, "BasicCommunication.GetSystemInfo")
+  latency_stats.request("hmi1", 2, "UI.GetCapabilities")
+  now = 20
+  if latency_stats.response("hmi1", 1) ~= 20 then return false, "latency of HMI response should be measured" end
+  if latency_stats.response("hmi1", 1) ~= nil then return false, "response should be matched once" end
+  if latency_stats.response("hmi1", 3) ~= nil then return false, "unknown response should be ignored" end
+  now = 35
+  if latency_stats.response("mobile1", "1:1") ~= 35 then return false, "latency of mobile response should be measured" end
+  local res = latency_stats.finish()
+  if res.hmi1.count ~= 1 or res.hmi1.max ~= 20 or res.mobile1.p99 ~= 35 then
+    return false, "step summary should contain latencies by connections"
+  end
+  local attributes = latency_stats.attributes(res, { result = true })
+  if attributes.latency_mobile1_p50 ~= 35 or attributes.latency_hmi1_count ~= 1 then
+    return false, "summaries should be flattened into attributes"
+  end
+  return true
+end
+
+function tests:Report()
+  latency_stats.report()
+  local f = io.open(config.latencyStatsFile)
+  local summary = json.decode(f:read("*a"))
+  f:close()
+  local hmi = summary.connections.hmi1
+  if hmi.unanswered ~= 1 or hmi.functions["BasicCommunication.GetSystemInfo"].max ~= 20 then
+    return false, "JSON summary should contain latencies by functions and unanswered requests"
+  end
+  if messages[1] ~= "LatencyStats" or messages[2].FunctionName ~= "RegisterAppInterface" or messages[2].p50 ~= "35" then
+    return false, "xml report should contain latencies by functions"
+  end
+  return true
+end
+
+for _, k in ipairs({ "Histogram", "Matching", "Report" }) do
+  local res, err = tests[k]()
+  if res then print("PASSED", k)
+  else print("FAILED", k, err) end
+end
+os.remove(config.latencyStatsFile)
+quit()
@@ -0,0 +1,64 @@
+config = require('config')
+local ph = require('protocol_handler/protocol_handler')
+
+local messages = {
+  { name = "control frame", message = { version = 3, frameType = 0, serviceType = 0, frameInfo = 0xFF,
+      sessionId = 1, messageId = 7 } },
+  { name = "single frame rpc", message = { version = 2, frameType = 1, serviceType = 7, frameInfo = 0,
+      sessionId = 2, messageId = 8, rpcType = 1, rpcFunctionId = 12, rpcCorrelationId = 34,
+      payload = '{"appName":"Test"}' } },
+  { name = "encrypted binary", message = { version = 3, encryption = true, frameType = 1, serviceType = 15,
+      frameInfo = 0, sessionId = 3, messageId = 9, binaryData = string.rep("b", 1000) } },
+  { name = "multi frame rpc", message = { version = 3, frameType = 1, serviceType = 15, frameInfo = 0,
+      sessionId = 4, messageId = 10, rpcType = 0, rpcFunctionId = 32, rpcCorrelationId = 56,
+      payload = '{"syncFileName":"icon.png"}', binaryData = string.rep("0123456789", 6000) } }
+}
+
+local fields = { "version", "frameType", "encryption", "serviceType", "frameInfo", "sessionId",
+  "messageId", "rpcType", "rpcFunctionId", "rpcCorrelationId", "rpcJsonSize", "binaryData", "rawPayload" }
+
+local function equal(a, b)
+  if type(a) ~= "table" or type(b) ~= "table" then return a == b end
+  for k, v in pairs(a) do if not equal(v, b[k]) then return false end end
+  for k in pairs(b) do if a[k] == nil then return false end end
+  return true
+end
+
+local function parse(frames, lazy)
+  config.lazyMessages = lazy
+  local handler = ph.ProtocolHandler()
+  local res = {}
+  -- Frames are delivered in two chunks to check buffering of incomplete frame
+  local stream = table.concat(frames)
+  local half = math.floor(#stream / 2)
+  for _, chunk in ipairs({ string.sub(stream, 1, half), string.sub(stream, half + 1) }) do
+    for _, msg in ipairs(handler:Parse(chunk)) do table.insert(res, msg) end
+  end
+  return res
+end
+
+for _, m in ipairs(messages) do
+  local frames = ph.ProtocolHandler():Compose(m.message)
+  local eager = parse(frames, false)[1]
+  local lazy = parse(frames, true)[1]
+  local mismatch = {}
+  for _, f in ipairs(fields) do
+    if eager[f] ~= lazy[f] then table.insert(mismatch, f) end
+  end
+  if not equal(eager.payload, lazy.payload) then table.insert(mismatch, "payload") end
+  print(m.name, type(lazy), #mismatch == 0 and "OK" or "MISMATCH " .. table.concat(mismatch, ","))
+end
+
+config.lazyMessages = true
+local msg = parse(ph.ProtocolHandler():Compose(messages[2].message), true)[1]
+print("raw payload", msg.rawPayload)
+print("payload is cached", msg.payload == msg.payload)
+msg.payload = nil
+print("payload is assignable", msg.payload == nil)
+msg.custom = "value"
+local snapshot = {}
+for k, v in pairs(msg) do snapshot[k] = v end
+print("pairs", snapshot.rpcFunctionId, snapshot.custom, snapshot.payload)
+config.lazyMessages = false
+
+quit()
@@ -0,0 +1,56 @@
+local server = network.LocalServer()--{{{
+local client = network.LocalClient()
+local name = "/tmp/atf_local_network_test"
+
+local input = qt.dynamic()
+local output = qt.dynamic()
+
+qt.connect(client, "connected()", input, "connected()")
+qt.connect(client, "readyRead()", input, "dataReady()")
+
+function input.connected()
+  print("Client connected")
+  client:write("Hello")
+end
+
+function input.dataReady()
+  local data = client:read(5000)
+  print("Client received: ", data)
+  client:close()
+  input.pair()
+end
+
+if not server:listen(name) then
+  print("Listen failed")
+  quit(1)
+end
+
+qt.connect(server, "newConnection()", output, "newConnection()")
+
+function output.newConnection()
+  output.socket = server:get_connection()
+  if not output.socket then
+    print("server.get_connection returns nil")
+    quit(1)
+  end
+  qt.connect(output.socket, "readyRead()", output, "dataReady()")
+end
+function output.dataReady()
+  local data = output.socket:read(5000)
+  print("Server received: ", data)
+  output.socket:write("Response")
+end
+
+local pair = qt.dynamic()
+function input.pair()
+  pair.a, pair.b = network.socketpair()
+  qt.connect(pair.b, "readyRead()", pair, "dataReady()")
+  pair.a:write("Ping")
+end
+function pair.dataReady()
+  print("Pair received: ", pair.b:read_all())
+  server:close()
+  quit()
+end
+
+client:connect(name)--}}}
@@ -0,0 +1,61 @@
+local memory = require('memory')
+
+local tests = {}
+
+function tests:Counters()
+  local before = memory.stats()
+  local t = {}
+  for i = 1, 1000 do t[i] = { i, tostring(i) } end
+  local after = memory.stats()
+  if after.allocations - before.allocations < 1000 then return false, "allocations are not counted" end
+  if after.live_bytes <= before.live_bytes then return false, "live bytes should grow" end
+  if after.peak_bytes < after.live_bytes then return false, "peak should not be less than live bytes" end
+  if after.pooled == 0 or after.slab_bytes == 0 then return false, "small objects should be pooled" end
+  t = nil
+  collectgarbage()
+  local collected = memory.stats()
+  if collected.live_bytes >= after.live_bytes then return false, "live bytes should drop after collection" end
+  if collected.frees <= after.frees then return false, "frees are not counted" end
+  return true
+end
+
+function tests:PeakReset()
+  local big = string.rep("x", 1000000)
+  big = nil
+  collectgarbage()
+  local stats = memory.stats()
+  if stats.peak_bytes < 1000000 then return false, "peak should include freed string" end
+  memory.reset_peak()
+  if memory.stats().peak_bytes >= 1000000 then return false, "peak should be reset" end
+  return true
+end
+
+function tests:Tags()
+  local previous = memory.tag("first")
+  if previous ~= "untagged" then return false, "default tag should be untagged" end
+  local t = {}
+  for i = 1, 100 do t[i] = {} end
+  if memory.tag() ~= "first" then return false, "tag should return previous tag" end
+  local res = memory.tagged("second", function(n)
+      local s = {}
+      for i = 1, n do s[i] = {} end
+      return #s
+    end, 50)
+  if res ~= 50 then return false, "tagged should return result of function" end
+  local tags = memory.tags()
+  if tags.first.allocations < 100 then return false, "allocations of first tag are not counted" end
+  if tags.second.allocations < 50 then return false, "allocations of second tag are not counted" end
+  local ok = pcall(memory.tagged, "third", error, "failure")
+  if ok then return false, "error should be propagated" end
+  if memory.tag() ~= "untagged" then return false, "tag should be restored after error" end
+  return true
+end
+
+local names = { "Counters", "PeakReset", "Tags" }
+for _, k in ipairs(names) do
+  local res, err = tests[k]()
+  if res then print("PASSED", k)
+  else print("FAILED", k, err) end
+end
+
+quit()
@@ -0,0 +1,99 @@
+-- Native JSON decoder gives the same tables as json4lua, WebSocket batches are received in order
+local json = require("json")
+
+local function equal(a, b)
+  if type(a) ~= type(b) then return false end
+  if type(a) ~= "table" then return a == b end
+  for k, v in pairs(a) do
+    if not equal(v, b[k]) then return false end
+  end
+  for k in pairs(b) do
+    if a[k] == nil then return false end
+  end
+  return true
+end
+
+local function check(name, res)
+  if res then print("PASSED", name)
+  else print("FAILED", name) end
+end
+
+local texts = {
+  plain = '{"a":1,"b":"x","c":true,"d":false}',
+  nulls = '{"a":null,"b":1,"c":{"d":null}}',
+  holes = '[1,null,3,null]',
+  empty = '{"list":[],"obj":{},"nested":[[],{}]}',
+  numbers = '[0,7,1.5,-2.25,1e3,1E-2,2.5e+2,12345678901234,0.1]',
+  strings = '{"s":"\\u00e9\\n\\"q\\" \\/","k\\u00e9y":""}',
+  deep = '[{"a":[1,[2,[3,{"b":[4]}]]]}]'
+}
+local names = { "plain", "nulls", "holes", "empty", "numbers", "strings", "deep" }
+for _, name in ipairs(names) do
+  check("SameAsJson4lua " .. name, equal(network.json_decode(texts[name]), json.decode(texts[name])))
+end
+
+local nulls = network.json_decode(texts.nulls)
+check("NullsOmitted", nulls.a == nil and nulls.b == 1 and next(nulls.c) == nil)
+local holes = network.json_decode(texts.holes)
+check("Holes", holes[1] == 1 and holes[2] == nil and holes[3] == 3 and holes[4] == nil)
+local empty = network.json_decode(texts.empty)
+check("EmptyArraysAndObjects", next(empty.list) == nil and next(empty.obj) == nil and #empty.nested == 2)
+local numbers = network.json_decode(texts.numbers)
+local expected = json.decode(texts.numbers)
+local formatted, same = { }, true
+for i = 1, #expected do
+  formatted[i] = tostring(numbers[i])
+  same = same and formatted[i] == tostring(expected[i])
+end
+check("NumberFormatting", same and #numbers == #expected)
+print("Numbers", table.concat(formatted, " "))
+for _, text in ipairs({ '{"a":', '{"a":1}x', "nul", "1", "'a'" }) do
+  check("Invalid " .. text, network.json_decode(text) == false)
+end
+
+-- Batched send and receive over WebSocket pair
+local messages = { texts.plain, texts.holes, "not json", texts.deep }
+local received = { texts = { }, data = { }, calls = 0 }
+local server = network.WebSocketServer()
+local d = qt.dynamic()
+local peer, receiver
+
+function d.newConnection()
+  peer = server:get_connection()
+  receiver = network.WebSocketReceiver(peer, true)
+  qt.connect(receiver, "readyRead()", d, "readyRead()")
+end
+
+function d.readyRead()
+  received.calls = received.calls + 1
+  local t, data = receiver:read_all()
+  for i, text in ipairs(t) do
+    table.insert(received.texts, text)
+    received.data[#received.texts] = data[i]
+  end
+  if #received.texts < #messages + 2 then return end
+  check("BatchOrder", equal({ table.unpack(received.texts, 1, #messages) }, messages))
+  check("BatchDecoded", equal(received.data[1], json.decode(texts.plain))
+    and equal(received.data[2], json.decode(texts.holes))
+    and received.data[3] == false
+    and equal(received.data[4], json.decode(texts.deep)))
+  check("BinaryFrames", received.texts[5] == "[5]" and received.data[5][1] == 5
+    and received.texts[6] == "bin\0ary" and received.data[6] == false)
+  check("PendingEmpty", receiver:pending() == 0)
+  quit()
+end
+
+if not server:listen("127.0.0.1", 5203) then
+  print("Listen failed")
+  quit(1)
+end
+qt.connect(server, "newConnection()", d, "newConnection()")
+
+local client = network.WebSocket()
+client:open("ws://127.0.0.1", 5203)
+local sent = client:write_batch(messages)
+local total = 0
+for _, m in ipairs(messages) do total = total + #m end
+check("BatchSize", sent == total)
+client:write_batch({ "[5]" }, true)
+client:write_binary("bin\0ary")
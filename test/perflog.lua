@@ -0,0 +1,128 @@
+config = {}
+local messages = {}
+xmlReporter = { AddMessage = function(name, attributes) table.insert(messages, attributes) end }
+local now = 0
+function timestamp() return now end
+
+local perflog = require('perflog')
+
+--- Native client which returns records queued by test
+local queued = {}
+network = { PerfLogClient = function()
+  return {
+    connect = function() return true end,
+    read_all = function() local res = queued; queued = {}; return res end,
+    close = function() end
+  }
+end }
+
+local tests = {}
+
+--- SDL clock is 1000 ms behind ATF clock
+local function sdl(point, time, correlation_id)
+  perflog.record({ point = point, sdl_time = time - 1000, received = time + 1,
+    session = 1, correlation_id = correlation_id })
+end
+
+function tests:Breakdown()
+  perflog.start()
+  -- transport takes 1 ms each way, SDL spends 3 ms, HMI answers in 4 ms
+  perflog.response("mobile1", "1:1", "Show", 100, 110)
+  sdl("mob_in", 101, 1)
+  sdl("hmi_out", 102, 1)
+  sdl("hmi_in", 106, 1)
+  sdl("mob_out", 109, 1)
+  local res = perflog.finish()
+  if res.rpcs ~= 1 then return false, "complete RPC should be split" end
+  if res.transport_in ~= 1 or res.sdl ~= 4 or res.hmi ~= 4 or res.transport_out ~= 1 then
+    return false, "time should be split into transport, SDL and HMI"
+  end
+  if res.clock_offset ~= 1000 then return false, "SDL clock should be aligned on ATF clock" end
+  local m = messages[1]
+  if m.FunctionName ~= "Show" or m.Id ~= "1:1" or m.total ~= "10" then
+    return false, "breakdown of RPC should be added to report"
+  end
+  return true
+end
+
+function tests:Alignment()
+  perflog.start()
+  -- slow transport doesn't move offset estimated by faster RPC
+  perflog.response("mobile1", "1:2", "Alert", 200, 230)
+  sdl("mob_in", 210, 2)
+  sdl("mob_out", 215, 2)
+  -- records of RPC answered later are kept until response
+  sdl("mob_in", 301, 3)
+  local res = perflog.finish()
+  if res.clock_offset ~= 1000 or res.transport_in ~= 10 or res.transport_out ~= 15 or res.hmi ~= 0 then
+    return false, "RPC with the least transport delay should define offset"
+  end
+  perflog.start()
+  perflog.response("mobile1", "1:3", "Speak", 300, 305)
+  sdl("mob_out", 304, 3)
+  res = perflog.finish()
+  if res.rpcs ~= 1 or res.sdl ~= 3 then return false, "records should wait for response" end
+  local attributes = perflog.attributes(res, { result = true })
+  if attributes.perflog_rpcs ~= 1 or attributes.perflog_sdl ~= 3 then
+    return false, "breakdown should be flattened into attributes"
+  end
+  return true
+end
+
+function tests:Unmatched()
+  perflog.start()
+  perflog.response("mobile1", "1:4", "Slider", 400, 410)
+  perflog.response("hmi1", 4, "UI.Show", 400, 410)
+  now = 20000
+  local res = perflog.finish()
+  if res.rpcs ~= 0 or res.unmatched ~= 1 then return false, "RPC without records should be dropped" end
+  return true
+end
+
+function tests:LateRecords()
+  now = 500
+  perflog.start("Step1")
+  perflog.response("mobile1", "1:5", "Show", 500, 510)
+  sdl("mob_in", 501, 5)
+  local res = perflog.finish()
+  if res.rpcs ~= 0 or res.pending ~= 1 then return false, "RPC without records should be pending" end
+  perflog.start("Step2")
+  sdl("mob_out", 509, 5)
+  messages = {}
+  res = perflog.finish()
+  if res.rpcs ~= 0 or res.pending ~= 0 then
+    return false, "RPC should not be summed into step after the one it was answered in"
+  end
+  if not messages[1] or messages[1].Id ~= "1:5" or messages[1].Step ~= "Step1" then
+    return false, "RPC should be reported with step it was answered in"
+  end
+  return true
+end
+
+function tests:Close()
+  if not perflog.connect("127.0.0.1", 5300) then return false, "client should be connected" end
+  perflog.start("Step3")
+  perflog.response("mobile1", "1:6", "Alert", 600, 610)
+  perflog.finish()
+  -- records of the last step are taken when connection is closed
+  local function queue(point, time)
+    table.insert(queued, { point = point, sdl_time = time - 1000, received = time + 1,
+      session = 1, correlation_id = 6 })
+  end
+  queue("mob_in", 601)
+  queue("mob_out", 609)
+  messages = {}
+  perflog.close()
+  if perflog.connected() then return false, "client should be closed" end
+  if not messages[1] or messages[1].Id ~= "1:6" or messages[1].Step ~= "Step3" then
+    return false, "RPCs of the last step should be reported on close"
+  end
+  return true
+end
+
+for _, k in ipairs({ "Breakdown", "Alignment", "Unmatched", "LateRecords", "Close" }) do
+  local res, err = tests[k]()
+  if res then print("PASSED", k)
+  else print("FAILED", k, err) end
+end
+quit()
@@ -0,0 +1,47 @@
+config = require('config')
+local ph = require('protocol_handler/protocol_handler')
+
+local native = ford_protocol
+
+local messages = {
+  { name = "control frame", message = { version = 3, frameType = 0, serviceType = 0, frameInfo = 0xFF,
+      sessionId = 1, messageId = 7 } },
+  { name = "single frame rpc", message = { version = 2, frameType = 1, serviceType = 7, frameInfo = 0,
+      sessionId = 2, messageId = 8, rpcType = 0, rpcFunctionId = 12, rpcCorrelationId = 34,
+      payload = '{"appName":"Test"}' } },
+  { name = "encrypted binary", message = { version = 3, encryption = true, frameType = 1, serviceType = 15,
+      frameInfo = 0, sessionId = 3, messageId = 9, binaryData = string.rep("b", 1000) } },
+  { name = "multi frame rpc", message = { version = 3, frameType = 1, serviceType = 15, frameInfo = 0,
+      sessionId = 4, messageId = 10, rpcType = 0, rpcFunctionId = 32, rpcCorrelationId = 56,
+      payload = '{"syncFileName":"icon.png"}', binaryData = string.rep("0123456789", 60000) } },
+  { name = "exact frame size", message = { version = 2, frameType = 1, serviceType = 15, frameInfo = 0,
+      sessionId = 5, messageId = 11, binaryData = string.rep("x", 1488 * 2) } }
+}
+
+local function compose(message)
+  return ph.ProtocolHandler():Compose(message)
+end
+
+for _, m in ipairs(messages) do
+  ford_protocol = nil
+  local expected = compose(m.message)
+  ford_protocol = native
+  local actual = compose(m.message)
+  local equal = #expected == #actual
+  for i = 1, #expected do
+    if expected[i] ~= actual[i] then equal = false end
+  end
+  print(m.name, #expected, equal and "OK" or "MISMATCH")
+end
+
+config.maxProtocolPayloadSize = { [3] = 100000 }
+ford_protocol = nil
+print("max payload size of version 3", #compose(messages[4].message))
+ford_protocol = native
+print("max payload size of version 3 (native)", #compose(messages[4].message))
+
+for _, size in ipairs({ 0, -1 }) do
+  print("max payload size " .. size, (pcall(native.compose, messages[2].message, size)) and "accepted" or "rejected")
+end
+
+quit()
@@ -1,4 +1,6 @@
 #! /bin/bash
+# Extra interpreter options can be passed in INTERP_FLAGS,
+# e.g. INTERP_FLAGS=--epoll-dispatcher make test
 
 run_test()
 {
@@ -7,7 +9,7 @@ run_test()
   test_name=$2
   timeout_delay=$3s
   echo -n "Running $title..."
-  timeout $timeout_delay ./interp $4 test/$test_name.lua $5> test/out/$test_name.out 2>&1
+  timeout $timeout_delay ./interp $INTERP_FLAGS $4 test/$test_name.lua $5> test/out/$test_name.out 2>&1
   RES=$?
   if [ $RES ] && diff test/out/$test_name.out test/out/$test_name.success > /dev/null; then
     echo "OK"
@@ -21,9 +23,30 @@ run_test "Dynamic object test" dynamic 3
 run_test "Signal-Slot mechanism example" signal_slot 3
 run_test "Qt Connect test" connect 3
 run_test "Network test" network 3
+run_test "Local network test" local_network 3
+run_test "Threaded TCP client test" threaded_tcp 3
+run_test "Native heartbeat test" heartbeat_service 3
+run_test "Native heartbeat test (I/O thread)" heartbeat_service_threaded 3
 run_test "Xml test" xmltest 3
 run_test "Validation test" validationTest 3
 run_test "Report test" reportTest 3
+run_test "Deadline queue test" deadline_queue 3
+run_test "Protocol compose test" protocol_compose 3
+run_test "Lazy messages test" lazy_messages 3
+run_test "Memory test" memory 3
+run_test "Case resources test" case_resources 3
+run_test "ATF log test" atf_log 3
+run_test "Batch delivery test" batch_delivery 3
+run_test "Virtual time test" virtual_time 3
+run_test "Connection metrics test" connection_metrics 3
+run_test "Latency statistics test" latency_stats 3
+run_test "Performance log test" perflog 3
+run_test "Native JSON test" native_json 3
+run_test "Zero timer test" zero_timer 3
+run_test "Zero timer test (epoll)" zero_timer 3 --epoll-dispatcher
+run_test "Async steps test" async 3
+run_test "Async steps in testbase test" async_testbase 5 ./modules/launch.lua
+run_test "Interpreter server test" interp_server 20
 run_test "SDL log test: " SDLLogTest  3 ./modules/launch.lua "--storeFullSDLLogs"
 #../interp testbase.lua
 #../interp dynamic.lua
@@ -0,0 +1,83 @@
+-- Frames received by I/O thread of ThreadedTcpClient are delivered in order, all of them before disconnected()
+local count = 10000
+local server = network.TcpServer()
+local client = network.ThreadedTcpClient()
+local d = qt.dynamic()
+local received = { frames = 0, ordered = true, after_disconnect = 0, disconnected = false }
+
+local function int32(n)
+  return string.char(math.floor(n / 16777216) % 256, math.floor(n / 65536) % 256,
+    math.floor(n / 256) % 256, n % 256)
+end
+
+-- Odd frames have protocol version 1 header without message id
+local function frame(i)
+  local payload = "frame" .. i
+  if i % 2 == 1 then
+    return string.char(0x11, 7, 0, 1) .. int32(#payload) .. payload
+  end
+  return string.char(0x21, 7, 0, 1) .. int32(#payload) .. int32(i) .. payload
+end
+
+local function payload(data)
+  local version = math.floor(data:byte(1) / 16)
+  return data:sub(version == 1 and 9 or 13)
+end
+
+function d.report()
+  local function check(name, res)
+    if res then print("PASSED", name)
+    else print("FAILED", name) end
+  end
+  check("AllFrames", received.frames == count)
+  check("Order", received.ordered)
+  check("Disconnected", received.disconnected)
+  check("NoFramesAfterDisconnect", received.after_disconnect == 0 and #client:read_all() == 0)
+  check("ServerReceived", received.ping == "ping")
+  quit()
+end
+
+function d.newConnection()
+  d.socket = server:get_connection()
+  qt.connect(d.socket, "readyRead()", d, "serverReadyRead()")
+end
+
+function d.serverReadyRead()
+  received.ping = d.socket:read(100)
+  local frames = { }
+  for i = 1, count do frames[i] = frame(i) end
+  local data = table.concat(frames)
+  -- Frame header is split between two writes
+  local split = #frame(1) + 5
+  d.socket:write(data:sub(1, split))
+  d.socket:write(data:sub(split + 1))
+  d.socket:close()
+end
+
+function d.readyRead()
+  if received.disconnected then received.after_disconnect = received.after_disconnect + 1 end
+  for _, data in ipairs(client:read_all()) do
+    received.frames = received.frames + 1
+    if payload(data) ~= "frame" .. received.frames then received.ordered = false end
+  end
+end
+
+function d.disconnected()
+  received.disconnected = true
+  -- Wait for signals which must not come after disconnection
+  local timer = timers.Timer()
+  d.timer = timer
+  timer:setSingleShot(true)
+  qt.connect(timer, "timeout()", d, "report()")
+  timer:start(100)
+end
+
+if not server:listen("127.0.0.1", 5204) then
+  print("Listen failed")
+  quit(1)
+end
+qt.connect(server, "newConnection()", d, "newConnection()")
+qt.connect(client, "readyRead()", d, "readyRead()")
+qt.connect(client, "disconnected()", d, "disconnected()")
+client:connect("127.0.0.1", 5204)
+client:write("ping")
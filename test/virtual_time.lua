@@ -0,0 +1,68 @@
+-- Timers fire on virtual clock which jumps over idle time
+local real_start = os.time()
+local start = timestamp()
+local fired = { }
+local elapsed = { }
+local ticks = 0
+local ticks_at = { }
+
+timers.virtual_time(true, 5)
+
+local function SingleShot()
+  local timer = timers.Timer()
+  timer:setSingleShot(true)
+  return timer
+end
+local short = SingleShot()
+local long = SingleShot()
+local longer = SingleShot()
+local repeating = timers.Timer()
+
+-- Each timer fires exactly at its virtual deadline, few ms of real time are allowed
+local function CheckElapsed(name, expected)
+  local value = elapsed[name]
+  return value and value >= expected and value < expected + 100
+end
+
+local d = qt.dynamic()
+local function Fired(name)
+  table.insert(fired, name)
+  elapsed[name] = timestamp() - start
+  ticks_at[name] = ticks
+end
+function d:tick()
+  ticks = ticks + 1
+end
+function d:shortTimeout() Fired("short") end
+function d:longTimeout() Fired("long") end
+function d:longerTimeout()
+  Fired("longer")
+  if CheckElapsed("short", 30000) and CheckElapsed("long", 60000) and CheckElapsed("longer", 90000) then
+    print("PASSED", "VirtualElapsed")
+  else
+    print("FAILED", "VirtualElapsed", elapsed.short, elapsed.long, elapsed.longer)
+  end
+  -- Repeating timer ticks every 7 s: 28 s, 56 s and 84 s are the last ticks before each single shot
+  if ticks_at.short == 4 and ticks_at.long == 8 and ticks_at.longer == 12 then
+    print("PASSED", "Repeating")
+  else
+    print("FAILED", "Repeating", ticks_at.short, ticks_at.long, ticks_at.longer)
+  end
+  if os.time() - real_start <= 2 then print("PASSED", "RealElapsed")
+  else print("FAILED", "RealElapsed", os.time() - real_start) end
+  if table.concat(fired, ",") == "short,long,longer" then print("PASSED", "Order")
+  else print("FAILED", "Order", table.concat(fired, ",")) end
+  if timers.virtual_offset() > 0 then print("PASSED", "Offset")
+  else print("FAILED", "Offset") end
+  timers.virtual_time(false)
+  quit()
+end
+qt.connect(repeating, "timeout()", d, "tick()")
+qt.connect(short, "timeout()", d, "shortTimeout()")
+qt.connect(long, "timeout()", d, "longTimeout()")
+qt.connect(longer, "timeout()", d, "longerTimeout()")
+
+longer:start(90000)
+long:start(60000)
+short:start(30000)
+repeating:start(7000)
@@ -40,6 +40,20 @@ local s = f:read("*all")
 print(s)
 f:close()
 
+local writer = xml.writer("test_stream.xml")
+writer:startElement("test")
+for i = 1, 3 do
+  writer:startElement("hello"):attr("a", i):text("Hi & bye"):endElement()
+end
+writer:startElement("bye"):attr("until", "Friday")
+writer:flush()
+writer:close()
+writer:close()
+
+f = io.open("test_stream.xml", "r")
+print(f:read("*all"))
+f:close()
+
 local broken_file_name = "broken.xml"
 local broken_file = io.open(broken_file_name, "w")
 broken_file:write("<test>  <hello>Hi</hello###>  </test>")
@@ -0,0 +1,34 @@
+-- Timers with zero interval fire once per event loop iteration and don't starve the loop
+local single_fired = 0
+local repeated_fired = 0
+
+local single = timers.Timer()
+single:setSingleShot(true)
+local repeated = timers.Timer()
+local guard = timers.Timer()
+guard:setSingleShot(true)
+
+local d = qt.dynamic()
+function d:singleTimeout()
+  single_fired = single_fired + 1
+end
+function d:repeatedTimeout()
+  repeated_fired = repeated_fired + 1
+  if repeated_fired == 100 then
+    repeated:stop()
+    guard:start(50)
+  end
+end
+function d:guardTimeout()
+  if single_fired == 1 then print("PASSED", "SingleShot")
+  else print("FAILED", "SingleShot", single_fired) end
+  if repeated_fired == 100 then print("PASSED", "Repeated")
+  else print("FAILED", "Repeated", repeated_fired) end
+  quit()
+end
+qt.connect(single, "timeout()", d, "singleTimeout()")
+qt.connect(repeated, "timeout()", d, "repeatedTimeout()")
+qt.connect(guard, "timeout()", d, "guardTimeout()")
+
+single:start(0)
+repeated:start(0)
@@ -0,0 +1,210 @@
+--- Render binary ATF log (see config.binaryATFLogs) to text or JSON
+--
+-- Usage: interp tools/atf_logcat.lua <log.atflog> [options]
+--
+-- Options:
+--   --json              one JSON object per record instead of text of ATF log
+--   --brief             only records of normal ATF log (full log by default)
+--   --session=<id>      only mobile messages of session
+--   --function=<name>   only mobile messages of function (name or id)
+--   --from=<ms>         only records since <ms> from start of script
+--   --to=<ms>           only records before <ms> from start of script
+--
+-- Should be run from ATF folder, function names are taken from data/MOBILE_API.xml
+
+local MAGIC = "ATFLOG1\n"
+local HEADER_SIZE = 32
+local RECORD = { START = 1, MOBILE = 2, HMI = 3, CASE = 4, FINISH = 5 }
+local DIRECTIONS = { [0] = "MOB->SDL ", [1] = "SDL->MOB", [2] = "HMI->SDL", [3] = "SDL->HMI" }
+local FIELDS = { "sessionId", "version", "frameType", "serviceType", "frameInfo", "encryption",
+  "messageId", "rpcFunctionId", "payload" }
+
+-- Same as Logger.mobile_log_format and Logger.hmi_log_format of atf_logger
+local mobile_log_format = "%s (%s) [rpcFunction: %s, sessionId: %s, version: %s, frameType: %s, "
+      .. "encryption: %s, serviceType: %s, frameInfo: %s, messageId: %s] : %s \n"
+local hmi_log_format = "%s (%s) : %s \n"
+
+local CONTROL_FRAME = 0x00
+local SERVICE_PCM = 0x0A
+local SERVICE_VIDEO = 0x0B
+
+local function usage()
+  print("Usage: interp tools/atf_logcat.lua <log.atflog> [--json] [--brief] [--session=<id>]"
+    .. " [--function=<name>] [--from=<ms>] [--to=<ms>]")
+end
+
+local function uint(s, offset, size)
+  local res = 0
+  for i = offset + size - 1, offset, -1 do
+    res = res * 256 + string.byte(s, i)
+  end
+  return res
+end
+
+local function load_function_names()
+  local names, ids = { }, { }
+  local ok, function_id = pcall(function()
+      config = config or require('config')
+      return require('function_id')
+    end)
+  if ok and type(function_id) == "table" then
+    for name, id in pairs(function_id) do
+      names[id] = name
+      ids[name] = id
+    end
+  end
+  return names, ids
+end
+
+local function parse_args(args)
+  local opts = { }
+  for i = 2, #args do
+    local a = args[i]
+    local key, value = a:match("^%-%-([%w-]+)=(.*)$")
+    if key then
+      opts[key] = value
+    elseif a:match("^%-%-") then
+      opts[a:sub(3)] = true
+    elseif not opts.file then
+      opts.file = a
+    else
+      return nil
+    end
+  end
+  if not opts.file then return nil end
+  return opts
+end
+
+local function escape(s)
+  return '"' .. s:gsub('[%c"\\]', function(c)
+      local special = { ['"'] = '\\"', ['\\'] = '\\\\', ['\n'] = '\\n', ['\r'] = '\\r', ['\t'] = '\\t' }
+      return special[c] or string.format("\\u%04x", string.byte(c))
+    end) .. '"'
+end
+
+local function format_time(realtime_ms)
+  local sec = math.floor(realtime_ms / 1000)
+  return os.date("%d %m %Y %H:%M:%S", sec) .. string.format(", %03d", realtime_ms % 1000)
+end
+
+local function read_record(f)
+  local header = f:read(HEADER_SIZE)
+  if not header or #header < HEADER_SIZE then return nil end
+  local rec = {
+    type = string.byte(header, 1),
+    direction = string.byte(header, 2),
+    present = uint(header, 3, 2),
+    time_us = uint(header, 9, 8)
+  }
+  local size = uint(header, 5, 4)
+  rec.data = size > 0 and f:read(size) or ""
+  if rec.type == RECORD.START then
+    rec.realtime_ms = uint(header, 17, 8)
+  elseif rec.type == RECORD.MOBILE then
+    local values = {
+      string.byte(header, 17), string.byte(header, 18), string.byte(header, 19), string.byte(header, 20),
+      string.byte(header, 21), string.byte(header, 22) == 1, uint(header, 25, 4), uint(header, 29, 4),
+      rec.data
+    }
+    for i, name in ipairs(FIELDS) do
+      if bit32.btest(rec.present, bit32.lshift(1, i - 1)) then rec[name] = values[i] end
+    end
+  end
+  return rec
+end
+
+local function in_brief_log(rec)
+  return rec.type ~= RECORD.MOBILE or (rec.frameType ~= CONTROL_FRAME and
+    rec.serviceType ~= SERVICE_PCM and rec.serviceType ~= SERVICE_VIDEO)
+end
+
+local function render_text(rec, names, time)
+  if rec.type == RECORD.MOBILE then
+    return string.format(mobile_log_format, DIRECTIONS[rec.direction], time,
+      names[rec.rpcFunctionId] or "nil", rec.sessionId, rec.version, rec.frameType, rec.encryption,
+      rec.serviceType, rec.frameInfo, rec.messageId, rec.payload)
+  elseif rec.type == RECORD.HMI then
+    return string.format(hmi_log_format, DIRECTIONS[rec.direction], time, rec.data)
+  elseif rec.type == RECORD.CASE then
+    return string.format("\n\n===== %s : \n", rec.data)
+  elseif rec.type == RECORD.FINISH then
+    return string.format("\n\n===== Total executing time is %s =====\n", rec.data)
+  end
+  return ""
+end
+
+local function render_json(rec, names, time, elapsed_ms)
+  local kinds = { [RECORD.START] = "start", [RECORD.MOBILE] = "mobile", [RECORD.HMI] = "hmi",
+    [RECORD.CASE] = "case", [RECORD.FINISH] = "finish" }
+  local parts = { '"type":' .. escape(kinds[rec.type] or tostring(rec.type)),
+    '"time":' .. escape(time), '"elapsed_ms":' .. string.format("%.3f", elapsed_ms) }
+  if rec.type == RECORD.MOBILE or rec.type == RECORD.HMI then
+    table.insert(parts, '"direction":' .. escape(DIRECTIONS[rec.direction]:gsub(" ", "")))
+  end
+  if rec.type == RECORD.MOBILE then
+    for _, name in ipairs(FIELDS) do
+      local v = rec[name]
+      if name ~= "payload" and v ~= nil then
+        table.insert(parts, escape(name) .. ":" .. tostring(v))
+      end
+    end
+    if rec.rpcFunctionId and names[rec.rpcFunctionId] then
+      table.insert(parts, '"function":' .. escape(names[rec.rpcFunctionId]))
+    end
+    -- Payload is JSON text already
+    if rec.payload and rec.payload ~= "" then table.insert(parts, '"payload":' .. rec.payload) end
+  elseif rec.type == RECORD.HMI then
+    table.insert(parts, '"message":' .. rec.data)
+  else
+    table.insert(parts, '"text":' .. escape(rec.data))
+  end
+  return "{" .. table.concat(parts, ",") .. "}\n"
+end
+
+local opts = parse_args(argv)
+if not opts then
+  usage()
+  quit(1)
+  return
+end
+
+local f = io.open(opts.file, "rb")
+if not f or f:read(#MAGIC) ~= MAGIC then
+  print("Not a binary ATF log: " .. tostring(opts.file))
+  quit(1)
+  return
+end
+
+local names, ids = load_function_names()
+local session = tonumber(opts.session)
+local function_id = opts["function"] and (tonumber(opts["function"]) or ids[opts["function"]] or -1)
+local from, to = tonumber(opts.from), tonumber(opts.to)
+local mobile_only = session or function_id
+
+local start_us, start_ms = 0, 0
+while true do
+  local rec = read_record(f)
+  if not rec then break end
+  if rec.type == RECORD.START then
+    start_us, start_ms = rec.time_us, rec.realtime_ms
+  end
+  local elapsed_ms = (rec.time_us - start_us) / 1000
+  local show = rec.type ~= RECORD.START or opts.json
+  if opts.brief and not in_brief_log(rec) then show = false end
+  if mobile_only and rec.type ~= RECORD.CASE and rec.type ~= RECORD.FINISH then
+    show = show and rec.type == RECORD.MOBILE and (not session or rec.sessionId == session)
+      and (not function_id or rec.rpcFunctionId == function_id)
+  end
+  if from and elapsed_ms < from then show = false end
+  if to and elapsed_ms >= to then show = false end
+  if show then
+    local time = format_time(start_ms + math.floor(elapsed_ms))
+    if opts.json then
+      io.write(render_json(rec, names, time, elapsed_ms))
+    else
+      io.write(render_text(rec, names, time))
+    end
+  end
+end
+f:close()
+quit()
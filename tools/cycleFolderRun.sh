@@ -1,11 +1,33 @@
 #!/bin/bash
 
+# Cycle runs load Lua modules from bytecode cache, set ATF_BYTECODE_CACHE= to disable
+export ATF_BYTECODE_CACHE=${ATF_BYTECODE_CACHE-.luacache}
+
+# Set ATF_REUSE_SDL=1 to run all scripts by one ATF process which keeps SDL and HMI connection between them
+reuse_sdl=${ATF_REUSE_SDL:+--reuse-sdl}
+
+# Set ATF_SERVE=1 to run scripts by interpreter server, modules are loaded once
+if [ -n "$ATF_SERVE" ]; then
+   export ATF_SERVE_SOCKET=${ATF_SERVE_SOCKET-.atf_serve.sock}
+   rm -f "$ATF_SERVE_SOCKET"
+   ./bin/interp ${ATF_BYTECODE_CACHE:+--bytecode-cache=$ATF_BYTECODE_CACHE} --serve=$ATF_SERVE_SOCKET > /dev/null &
+   serve_pid=$!
+   while [ ! -S "$ATF_SERVE_SOCKET" ] && kill -0 $serve_pid 2> /dev/null; do sleep 0.1; done
+fi
+
 scripts=`ls $1/*.lua`
-for f in $scripts
-do
-   echo "$f" >> "$2_test.log"
-   ./start.sh $f 2>&1>> "$2_test.log"
-   echo " " >> "$2_test.log"
-done
+if [ -n "$reuse_sdl" ]; then
+   ./start.sh $scripts $reuse_sdl 2>&1>> "$2_test.log"
+else
+   for f in $scripts
+   do
+      echo "$f" >> "$2_test.log"
+      ./start.sh $f 2>&1>> "$2_test.log"
+      echo " " >> "$2_test.log"
+   done
+fi
+if [ -n "$ATF_SERVE" ]; then
+   kill $serve_pid
+fi
 fails=`cat "$2_test.log" | grep FAIL | wc -l`
 echo "FAILS - $fails"
\ No newline at end of file